@@ -0,0 +1,46 @@
+# Generates a header embedding compiled SPIR-V blobs as constexpr uint32_t arrays.
+# Run in script mode:
+#   cmake -DOUTPUT=<header> -DSHADERS="<a.vert.spv;b.frag.spv>" -P EmbedShaders.cmake
+# Each blob is registered under its file name without the .spv suffix, e.g. "hello.vert".
+# Only meant to be included through shader_registry.h, which declares EmbeddedShader.
+# OUTPUT is always rewritten, the build copies it over the real header only when it differs.
+
+if (NOT DEFINED OUTPUT OR NOT DEFINED SHADERS)
+    message(FATAL_ERROR "EmbedShaders.cmake needs OUTPUT and SHADERS")
+endif()
+
+set(CONTENT "// Generated by cmake/EmbedShaders.cmake, do not edit.\n#pragma once\n\n")
+set(TABLE "")
+
+foreach(SPV IN LISTS SHADERS)
+    get_filename_component(NAME ${SPV} NAME)   # e.g. foo.vert.spv
+    string(REGEX REPLACE "\\.spv$" "" NAME ${NAME})
+    string(MAKE_C_IDENTIFIER "k_spv_${NAME}" IDENTIFIER)
+
+    file(READ ${SPV} HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+    if (HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${SPV} is not a SPIR-V module (size is not a multiple of 4 bytes)")
+    endif()
+
+    # SPIR-V is a stream of little-endian words, swap each group of 4 bytes into a uint32_t literal
+    string(REGEX MATCHALL "........" BYTES_WORDS "${HEX}")
+    set(WORDS "")
+    set(COLUMN 0)
+    foreach(WORD IN LISTS BYTES_WORDS)
+        string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," WORD ${WORD})
+        if (COLUMN EQUAL 8)
+            string(APPEND WORDS "\n   ")
+            set(COLUMN 0)
+        endif()
+        string(APPEND WORDS " ${WORD}")
+        math(EXPR COLUMN "${COLUMN} + 1")
+    endforeach()
+
+    string(APPEND CONTENT "alignas(4) inline constexpr uint32_t ${IDENTIFIER}[] = {\n   ${WORDS}\n};\n\n")
+    string(APPEND TABLE "    {\"${NAME}\", ${IDENTIFIER}, sizeof(${IDENTIFIER})},\n")
+endforeach()
+
+string(APPEND CONTENT "inline constexpr EmbeddedShader k_embedded_shaders[] = {\n${TABLE}};\n")
+file(WRITE ${OUTPUT} "${CONTENT}")
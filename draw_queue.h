@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include "vk_dispatch.h"
+#include "vulkan/vulkan.h"
+
+//summed over every range recorded since Init
+struct DrawQueueStats {
+  uint64_t un_packets = 0;
+  uint64_t un_binds = 0;             //pipeline, descriptor set, vertex and index buffer binds recorded
+  uint64_t un_binds_eliminated = 0;  //binds skipped because the previous packet had already bound the same state
+
+  void WriteJson(std::ostream& out) const {
+    out << "{\"packets\": " << un_packets << ", \"binds\": " << un_binds
+        << ", \"binds_eliminated\": " << un_binds_eliminated << "}";
+  }
+};
+
+//the frame's draws as packets, each one naming the pipeline, material (descriptor set) and geometry (vertex and
+//index buffers) it needs by their slot in this frame's tables. Sort orders the packets by a 64-bit key, from the most
+//significant bits down: pass, pipeline, material, depth. draws sharing state end up next to each other, and Record
+//only binds what differs from the packet before it. the sort is stable, so packets with equal keys keep their
+//submission order.
+//Reset, the Add functions, Submit and Sort belong to the render thread. Record may then run on several threads at
+//once over disjoint ranges, each into its own command buffer
+class DrawQueue : VkDeviceDispatch {
+ public:
+  static const uint32_t PASS_BITS = 4;
+  static const uint32_t PIPELINE_BITS = 12;
+  static const uint32_t MATERIAL_BITS = 16;
+  static const uint32_t DEPTH_BITS = 32;
+  static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + DEPTH_BITS == 64);
+
+  static const uint32_t MAX_VERTEX_BINDINGS = 4;
+  static const uint32_t NO_GEOMETRY = UINT32_MAX;
+
+  //a descriptor set with its dynamic offset. every pipeline of the queue shares the layout, so a bound set stays
+  //valid across pipeline changes
+  struct Material {
+    VkPipelineLayout vklayout;
+    VkDescriptorSet vkdescriptor_set;
+    uint32_t un_dynamic_offset;
+  };
+
+  //un_binding_count vertex buffers bound from binding 0, and an index buffer unless vkindex_buffer is null
+  struct Geometry {
+    uint32_t un_binding_count;
+    std::array<VkBuffer, MAX_VERTEX_BINDINGS> vkvertex_buffers;
+    std::array<VkDeviceSize, MAX_VERTEX_BINDINGS> vertex_offsets;
+    VkBuffer vkindex_buffer;
+    VkIndexType index_type;
+  };
+
+  enum class DrawKind {
+    kDraw,                      //command.indexCount vertices from command.firstIndex, vertexOffset is ignored
+    kDrawIndexed,               //command as it is
+    kDrawIndexedIndirectCount,  //commands and count read from the buffers, command is ignored
+  };
+
+  struct Packet {
+    uint32_t un_pipeline;
+    uint32_t un_material;
+    uint32_t un_geometry;  //NO_GEOMETRY for draws that fetch nothing
+    DrawKind kind;
+    VkDrawIndexedIndirectCommand command;
+    VkBuffer vkindirect_buffer;
+    VkBuffer vkcount_buffer;
+    uint32_t un_max_draw_count;
+    const void* p_push_constants;  //vertex stage, pushed for every packet that has them. must outlive Record
+    uint32_t un_push_constant_size;
+  };
+
+  void Init(const VkDeviceDispatch& dispatch) { SetDeviceDispatch(dispatch); }
+
+  //drops the previous frame's tables and packets
+  void Reset() {
+    mv_vkpipelines.clear();
+    mv_materials.clear();
+    mv_geometries.clear();
+    mv_packets.clear();
+    mv_sorted.clear();
+  }
+
+  //the slot of the pipeline, the same one for a pipeline added twice
+  uint32_t AddPipeline(VkPipeline vkpipeline) {
+    auto it = std::find(mv_vkpipelines.begin(), mv_vkpipelines.end(), vkpipeline);
+    if (it != mv_vkpipelines.end()) {
+      return static_cast<uint32_t>(it - mv_vkpipelines.begin());
+    }
+    mv_vkpipelines.push_back(vkpipeline);
+    return static_cast<uint32_t>(mv_vkpipelines.size() - 1);
+  }
+
+  uint32_t AddMaterial(const Material& material) {
+    mv_materials.push_back(material);
+    return static_cast<uint32_t>(mv_materials.size() - 1);
+  }
+
+  uint32_t AddGeometry(const Geometry& geometry) {
+    mv_geometries.push_back(geometry);
+    return static_cast<uint32_t>(mv_geometries.size() - 1);
+  }
+
+  //passes draw in increasing order, within a pass f_depth sorts increasing, so front to back for opaque draws.
+  //slots beyond the key's bits still draw correctly, they only sort together with the slots they alias
+  void Submit(uint32_t un_pass, float f_depth, const Packet& packet) {
+    mv_sorted.push_back({
+        .un_key = MakeKey(un_pass, packet.un_pipeline, packet.un_material, f_depth),
+        .un_packet = static_cast<uint32_t>(mv_packets.size()),
+    });
+    mv_packets.push_back(packet);
+  }
+
+  //least significant digit first radix sort, a byte per pass. a byte every key shares needs no pass, so a frame with
+  //a handful of passes, pipelines and materials and a constant depth usually only pays for the histograms
+  void Sort() {
+    const size_t un_count = mv_sorted.size();
+    mv_sort_scratch.resize(un_count);
+
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+    for (const SortEntry& entry : mv_sorted) {
+      for (uint32_t un_byte = 0; un_byte < 8; un_byte++) {
+        histograms[un_byte][(entry.un_key >> (8 * un_byte)) & 0xff]++;
+      }
+    }
+
+    for (uint32_t un_byte = 0; un_byte < 8; un_byte++) {
+      std::array<uint32_t, 256>& histogram = histograms[un_byte];
+      if (un_count == 0 || histogram[(mv_sorted[0].un_key >> (8 * un_byte)) & 0xff] == un_count) {
+        continue;
+      }
+
+      uint32_t un_offset = 0;
+      for (uint32_t& un_bucket : histogram) {
+        uint32_t un_size = un_bucket;
+        un_bucket = un_offset;
+        un_offset += un_size;
+      }
+      for (const SortEntry& entry : mv_sorted) {
+        mv_sort_scratch[histogram[(entry.un_key >> (8 * un_byte)) & 0xff]++] = entry;
+      }
+      std::swap(mv_sorted, mv_sort_scratch);
+    }
+  }
+
+  uint32_t GetPacketCount() const { return static_cast<uint32_t>(mv_packets.size()); }
+
+  //records the sorted packets [un_first, un_end). nothing is assumed to be bound on entry, so every range starts
+  //with a full set of binds
+  void Record(VkCommandBuffer vkcommand_buffer, uint32_t un_first, uint32_t un_end) {
+    uint32_t un_bound_pipeline = UINT32_MAX, un_bound_material = UINT32_MAX, un_bound_geometry = NO_GEOMETRY;
+    uint64_t un_binds = 0, un_eliminated = 0;
+
+    for (uint32_t i = un_first; i < un_end; i++) {
+      const Packet& packet = mv_packets[mv_sorted[i].un_packet];
+
+      if (packet.un_pipeline != un_bound_pipeline) {
+        vkCmdBindPipeline(vkcommand_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mv_vkpipelines[packet.un_pipeline]);
+        un_bound_pipeline = packet.un_pipeline;
+        un_binds++;
+      } else {
+        un_eliminated++;
+      }
+
+      const Material& material = mv_materials[packet.un_material];
+      if (packet.un_material != un_bound_material) {
+        vkCmdBindDescriptorSets(vkcommand_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.vklayout, 0, 1,
+                                &material.vkdescriptor_set, 1, &material.un_dynamic_offset);
+        un_bound_material = packet.un_material;
+        un_binds++;
+      } else {
+        un_eliminated++;
+      }
+
+      if (packet.un_geometry != NO_GEOMETRY) {
+        const Geometry& geometry = mv_geometries[packet.un_geometry];
+        uint32_t un_geometry_binds =
+            (geometry.un_binding_count > 0 ? 1 : 0) + (geometry.vkindex_buffer != VK_NULL_HANDLE ? 1 : 0);
+        if (packet.un_geometry != un_bound_geometry) {
+          if (geometry.un_binding_count > 0) {
+            vkCmdBindVertexBuffers(vkcommand_buffer, 0, geometry.un_binding_count, geometry.vkvertex_buffers.data(),
+                                   geometry.vertex_offsets.data());
+          }
+          if (geometry.vkindex_buffer != VK_NULL_HANDLE) {
+            vkCmdBindIndexBuffer(vkcommand_buffer, geometry.vkindex_buffer, 0, geometry.index_type);
+          }
+          un_bound_geometry = packet.un_geometry;
+          un_binds += un_geometry_binds;
+        } else {
+          un_eliminated += un_geometry_binds;
+        }
+      }
+
+      if (packet.p_push_constants != nullptr) {
+        vkCmdPushConstants(vkcommand_buffer, material.vklayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                           packet.un_push_constant_size, packet.p_push_constants);
+      }
+
+      const VkDrawIndexedIndirectCommand& command = packet.command;
+      switch (packet.kind) {
+        case DrawKind::kDraw:
+          vkCmdDraw(vkcommand_buffer, command.indexCount, command.instanceCount, command.firstIndex,
+                    command.firstInstance);
+          break;
+        case DrawKind::kDrawIndexed:
+          vkCmdDrawIndexed(vkcommand_buffer, command.indexCount, command.instanceCount, command.firstIndex,
+                           command.vertexOffset, command.firstInstance);
+          break;
+        case DrawKind::kDrawIndexedIndirectCount:
+          vkCmdDrawIndexedIndirectCount(vkcommand_buffer, packet.vkindirect_buffer, 0, packet.vkcount_buffer, 0,
+                                        packet.un_max_draw_count, sizeof(VkDrawIndexedIndirectCommand));
+          break;
+      }
+    }
+
+    m_unpackets.fetch_add(un_end - un_first, std::memory_order_relaxed);
+    m_unbinds.fetch_add(un_binds, std::memory_order_relaxed);
+    m_unbinds_eliminated.fetch_add(un_eliminated, std::memory_order_relaxed);
+  }
+
+  DrawQueueStats GetStats() const {
+    return {
+        .un_packets = m_unpackets.load(std::memory_order_relaxed),
+        .un_binds = m_unbinds.load(std::memory_order_relaxed),
+        .un_binds_eliminated = m_unbinds_eliminated.load(std::memory_order_relaxed),
+    };
+  }
+
+ private:
+  struct SortEntry {
+    uint64_t un_key;
+    uint32_t un_packet;
+  };
+
+  static uint64_t MakeKey(uint32_t un_pass, uint32_t un_pipeline, uint32_t un_material, float f_depth) {
+    //the bits of a non-negative float order the same way as its value
+    uint32_t un_depth;
+    float f_clamped = std::max(f_depth, 0.f);
+    std::memcpy(&un_depth, &f_clamped, sizeof(un_depth));
+
+    return (uint64_t{un_pass} & ((1u << PASS_BITS) - 1)) << (PIPELINE_BITS + MATERIAL_BITS + DEPTH_BITS) |
+           (uint64_t{un_pipeline} & ((1u << PIPELINE_BITS) - 1)) << (MATERIAL_BITS + DEPTH_BITS) |
+           (uint64_t{un_material} & ((1u << MATERIAL_BITS) - 1)) << DEPTH_BITS | un_depth;
+  }
+
+  std::vector<VkPipeline> mv_vkpipelines;
+  std::vector<Material> mv_materials;
+  std::vector<Geometry> mv_geometries;
+  std::vector<Packet> mv_packets;
+  std::vector<SortEntry> mv_sorted;  //sorted by Sort, the order Record walks
+  std::vector<SortEntry> mv_sort_scratch;
+
+  std::atomic<uint64_t> m_unpackets{0};
+  std::atomic<uint64_t> m_unbinds{0};
+  std::atomic<uint64_t> m_unbinds_eliminated{0};
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memory_arena.h"
+#include "trace.h"
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
+#include "vulkan/vulkan.h"
+
+enum class ReadbackFormat {
+  kRawRgba,  //tightly packed R8G8B8A8 frames back to back, no header
+  kY4m,      //YUV4MPEG2 with full-resolution 4:4:4 planes, readable by ffmpeg and most encoders
+};
+
+struct ReadbackStats {
+  uint64_t un_frames_written = 0;
+  uint64_t un_bytes_written = 0;
+  uint32_t un_stalls = 0;    //frames that found every slot still queued for the writer
+  float f_stall_ms = 0.f;   //time the render thread spent waiting for a slot
+  float f_writer_ms = 0.f;  //time the writer spent converting and writing, excluding waits for the GPU
+
+  void WriteJson(std::ostream& out) const {
+    out << "{\"frames_written\": " << un_frames_written << ", \"bytes_written\": " << un_bytes_written
+        << ", \"stalls\": " << un_stalls << ", \"stall_ms\": " << f_stall_ms << ", \"writer_ms\": " << f_writer_ms
+        << ", \"writer_mb_per_s\": "
+        << (f_writer_ms > 0.f ? un_bytes_written / (1024.0 * 1024.0) / (f_writer_ms / 1000.0) : 0.0) << "}";
+  }
+};
+
+//streams rendered frames to a file or named pipe without stalling the render loop. each frame is copied with
+//vkCmdCopyImageToBuffer into the next slot of a ring of persistently mapped, preferably host-cached buffers and handed
+//to a writer thread together with the frame's timeline value. the writer waits for that value itself, so the render
+//thread never waits on the GPU for a readback, and raw frames go from the mapping straight to the file. the render
+//thread only blocks when the writer has fallen a whole ring behind, which is counted as a stall.
+//the copy itself is recorded by a render graph pass, which also makes the transfer writes visible to the host
+class FrameReadback : VkDeviceDispatch {
+ public:
+  static constexpr uint32_t DEFAULT_SLOT_COUNT = 8;
+
+  //vktimeline is the semaphore whose values RecordCopy's frames signal. the image has to be R8G8B8A8
+  bool Init(VkDevice vkdevice, const VkDeviceDispatch& dispatch, DeviceMemoryArena& memory_arena,
+            VkSemaphore vktimeline, VkExtent2D extent, const std::string& s_path, ReadbackFormat format,
+            uint32_t un_fps, uint32_t un_slot_count = DEFAULT_SLOT_COUNT) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    mp_memory_arena = &memory_arena;
+    m_vktimeline = vktimeline;
+    m_extent = extent;
+    m_format = format;
+    m_frame_size = VkDeviceSize{extent.width} * extent.height * 4;
+
+    m_file.open(s_path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+      std::cerr << "[FrameReadback] Could not open " << s_path << std::endl;
+      return false;
+    }
+
+    if (m_format == ReadbackFormat::kY4m) {
+      m_file << "YUV4MPEG2 W" << extent.width << " H" << extent.height << " F" << std::max(un_fps, 1u)
+             << ":1 Ip A1:1 C444 XYSCSS=444\n";
+      mv_yuv_planes.resize(3 * size_t{extent.width} * extent.height);
+    }
+
+    mv_slots.resize(un_slot_count);
+    for (Slot& slot : mv_slots) {
+      VkBufferCreateInfo buffer_create_info = {
+          .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .size = m_frame_size,
+          .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 0,
+          .pQueueFamilyIndices = nullptr,
+      };
+      //cached memory makes the writer's reads run at normal memory speed instead of uncached bus reads
+      if (!memory_arena.CreateBuffer(buffer_create_info, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_CACHED_BIT, slot.vkbuffer, slot.allocation)) {
+        return false;
+      }
+    }
+
+    m_thread = std::thread([this]() { WriterLoop(); });
+    return true;
+  }
+
+  //writes every committed frame, joins the writer and frees the ring. the frames must have been submitted
+  void Destroy() {
+    if (m_thread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bstopping = true;
+      }
+      m_cv.notify_all();
+      m_thread.join();
+    }
+
+    for (Slot& slot : mv_slots) {
+      mp_memory_arena->DestroyBuffer(slot.vkbuffer, slot.allocation);
+    }
+    mv_slots.clear();
+    m_file.close();
+  }
+
+  //the buffer the frame being recorded copies into, blocking while the writer still owns it. call once per frame
+  //before recording, a frame that is never committed leaves the slot to the next one
+  VkBuffer AcquireSlot() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_uncommitted - m_unwritten == mv_slots.size()) {
+      TRACE_SCOPE("ReadbackStall");
+      auto stall_start = std::chrono::steady_clock::now();
+      m_cv.wait(lock, [this]() { return m_uncommitted - m_unwritten < mv_slots.size(); });
+      m_stats.un_stalls++;
+      m_stats.f_stall_ms +=
+          std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - stall_start).count();
+    }
+    return mv_slots[m_uncommitted % mv_slots.size()].vkbuffer;
+  }
+
+  //copies the whole of vkimage, which must be in TRANSFER_SRC_OPTIMAL, into the acquired slot
+  void RecordCopy(VkCommandBuffer vkcommand_buffer, VkImage vkimage) {
+    VkBufferImageCopy buffer_image_copy = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {m_extent.width, m_extent.height, 1},
+    };
+    vkCmdCopyImageToBuffer(vkcommand_buffer, vkimage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           mv_slots[m_uncommitted % mv_slots.size()].vkbuffer, 1, &buffer_image_copy);
+  }
+
+  //hands the acquired slot to the writer once the frame that copied into it has been submitted
+  void Commit(uint64_t un_frame_value) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      mv_slots[m_uncommitted % mv_slots.size()].un_frame_value = un_frame_value;
+      m_uncommitted++;
+    }
+    m_cv.notify_all();
+  }
+
+  //blocks until the writer has written every committed frame, the frames must have been submitted
+  void WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return m_unwritten == m_uncommitted; });
+  }
+
+  //only read after WaitIdle or Destroy
+  const ReadbackStats& GetStats() const { return m_stats; }
+
+ private:
+  struct Slot {
+    VkBuffer vkbuffer = VK_NULL_HANDLE;
+    MemoryAllocation allocation{};
+    uint64_t un_frame_value = 0;
+  };
+
+  void WriterLoop() {
+    Tracer::Get().SetThreadName("Readback writer");
+
+    while (true) {
+      Slot* p_slot;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_unwritten < m_uncommitted || m_bstopping; });
+        if (m_unwritten == m_uncommitted) {
+          return;
+        }
+        p_slot = &mv_slots[m_unwritten % mv_slots.size()];
+      }
+
+      //the render thread does not touch a committed slot, so the rest runs without the lock
+      VkSemaphoreWaitInfo semaphore_wait_info = {
+          .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .semaphoreCount = 1,
+          .pSemaphores = &m_vktimeline,
+          .pValues = &p_slot->un_frame_value,
+      };
+      if (vkWaitSemaphores(m_vkdevice, &semaphore_wait_info, UINT64_MAX) == VK_SUCCESS) {
+        TRACE_SCOPE("WriteFrame");
+        auto write_start = std::chrono::steady_clock::now();
+
+        mp_memory_arena->Invalidate(p_slot->allocation, 0, m_frame_size);
+        WriteFrame(static_cast<const uint8_t*>(p_slot->allocation.p_mapped));
+
+        m_stats.f_writer_ms +=
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+      } else {
+        std::cerr << "[FrameReadback] Waiting for a frame failed, it is skipped" << std::endl;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_unwritten++;
+      }
+      m_cv.notify_all();
+    }
+  }
+
+  void WriteFrame(const uint8_t* p_rgba) {
+    if (m_bwrite_failed) {
+      return;
+    }
+
+    uint64_t un_bytes;
+    if (m_format == ReadbackFormat::kRawRgba) {
+      m_file.write(reinterpret_cast<const char*>(p_rgba), static_cast<std::streamsize>(m_frame_size));
+      un_bytes = m_frame_size;
+    } else {
+      //BT.601 limited range in 8.8 fixed point, the colorimetry y4m players assume without a tag
+      size_t un_pixels = size_t{m_extent.width} * m_extent.height;
+      uint8_t* p_y = mv_yuv_planes.data();
+      uint8_t* p_u = p_y + un_pixels;
+      uint8_t* p_v = p_u + un_pixels;
+      for (size_t i = 0; i < un_pixels; i++) {
+        int32_t n_r = p_rgba[4 * i], n_g = p_rgba[4 * i + 1], n_b = p_rgba[4 * i + 2];
+        p_y[i] = static_cast<uint8_t>(((66 * n_r + 129 * n_g + 25 * n_b + 128) >> 8) + 16);
+        p_u[i] = static_cast<uint8_t>(((-38 * n_r - 74 * n_g + 112 * n_b + 128) >> 8) + 128);
+        p_v[i] = static_cast<uint8_t>(((112 * n_r - 94 * n_g - 18 * n_b + 128) >> 8) + 128);
+      }
+
+      m_file << "FRAME\n";
+      m_file.write(reinterpret_cast<const char*>(mv_yuv_planes.data()),
+                   static_cast<std::streamsize>(mv_yuv_planes.size()));
+      un_bytes = 6 + mv_yuv_planes.size();
+    }
+
+    if (!m_file.good()) {
+      std::cerr << "[FrameReadback] Writing the output failed, later frames are dropped" << std::endl;
+      m_bwrite_failed = true;
+      return;
+    }
+    m_stats.un_frames_written++;
+    m_stats.un_bytes_written += un_bytes;
+  }
+
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  DeviceMemoryArena* mp_memory_arena = nullptr;
+  VkSemaphore m_vktimeline = VK_NULL_HANDLE;
+  VkExtent2D m_extent{};
+  VkDeviceSize m_frame_size = 0;
+  ReadbackFormat m_format = ReadbackFormat::kRawRgba;
+
+  std::vector<Slot> mv_slots;
+
+  //slot i % size belongs to the render thread while i >= m_uncommitted, to the writer while it is below
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  uint64_t m_uncommitted = 0;
+  uint64_t m_unwritten = 0;
+  bool m_bstopping = false;
+  std::thread m_thread;
+
+  //writer thread only
+  std::ofstream m_file;
+  std::vector<uint8_t> mv_yuv_planes;
+  bool m_bwrite_failed = false;
+
+  ReadbackStats m_stats{};  //stall fields are written by the render thread, the rest by the writer
+};
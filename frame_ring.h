@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "memory_arena.h"
+#include "vulkan/vulkan.h"
+
+//one persistently mapped buffer split into a region per frame in flight. a frame only writes the region of its own
+//slot, which the GPU finished reading when that slot's last frame completed, so updates need no map/unmap, no
+//allocation and no synchronisation beyond the frame slot wait Tick already does. shaders read it through dynamic
+//offsets.
+class FrameRing {
+ public:
+  struct Slice {
+    void* p_data;
+    VkDeviceSize offset;  //from the start of the buffer. narrow it to a 32-bit dynamic offset only after a range check
+  };
+
+  //un_min_alignment is minUniformBufferOffsetAlignment or minStorageBufferOffsetAlignment, depending on usage
+  bool Init(DeviceMemoryArena& memory_arena, VkDeviceSize region_size, uint32_t un_frame_count,
+            VkBufferUsageFlags usage, VkDeviceSize min_alignment) {
+    mp_memory_arena = &memory_arena;
+
+    //regions also start on a non-coherent atom so flushing one never touches bytes of another
+    m_alignment = std::max(min_alignment, memory_arena.GetNonCoherentAtomSize());
+    m_region_size = AlignUp(region_size, m_alignment);
+
+    VkBufferCreateInfo buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .size = m_region_size * un_frame_count,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+    };
+    if (!memory_arena.CreateBuffer(buffer_create_info, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_vkbuffer, m_allocation)) {
+      return false;
+    }
+
+    mv_region_heads.assign(un_frame_count, 0);
+    return true;
+  }
+
+  void Destroy() {
+    if (m_vkbuffer != VK_NULL_HANDLE) {
+      mp_memory_arena->DestroyBuffer(m_vkbuffer, m_allocation);
+      m_vkbuffer = VK_NULL_HANDLE;
+    }
+  }
+
+  //only call once the frame that last used un_frame has completed
+  void BeginFrame(uint32_t un_frame) {
+    m_uncurrent_frame = un_frame;
+    mv_region_heads[un_frame] = 0;
+  }
+
+  //bump-allocates from the current frame's region, nullopt once the region is full
+  std::optional<Slice> Allocate(VkDeviceSize size) {
+    VkDeviceSize head = AlignUp(mv_region_heads[m_uncurrent_frame], m_alignment);
+    if (head + size > m_region_size) {
+      return std::nullopt;
+    }
+    mv_region_heads[m_uncurrent_frame] = head + size;
+
+    VkDeviceSize offset = m_region_size * m_uncurrent_frame + head;
+    return Slice{
+        .p_data = static_cast<char*>(m_allocation.p_mapped) + offset,
+        .offset = offset,
+    };
+  }
+
+  //makes this frame's writes visible to the device before submit, a no-op on host-coherent memory
+  bool Flush() {
+    if (mv_region_heads[m_uncurrent_frame] == 0) {
+      return true;
+    }
+
+    return mp_memory_arena->Flush(m_allocation, m_region_size * m_uncurrent_frame, mv_region_heads[m_uncurrent_frame]);
+  }
+
+  VkBuffer GetBuffer() const { return m_vkbuffer; }
+
+ private:
+  static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  DeviceMemoryArena* mp_memory_arena = nullptr;
+  VkBuffer m_vkbuffer = VK_NULL_HANDLE;
+  MemoryAllocation m_allocation{};
+
+  VkDeviceSize m_alignment = 1;
+  VkDeviceSize m_region_size = 0;
+  std::vector<VkDeviceSize> mv_region_heads;
+  uint32_t m_uncurrent_frame = 0;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
+#include "vulkan/vulkan.h"
+
+//paces the render loop with one timeline semaphore counting completed frames. frame N (from 1) signals value N when
+//its submit has finished on the GPU, so that single value says which frame slots, command pools and ring regions are
+//free again and which retired objects can be destroyed. frame N reuses the slot of frame N - frames in flight, so the
+//CPU only blocks when it really is that many frames ahead. frames abandoned before submit do not take a value, their
+//slot is simply used again by the next attempt
+class FrameScheduler : VkDeviceDispatch {
+ public:
+  bool Init(VkDevice vkdevice, const VkDeviceDispatch& dispatch, uint32_t un_frames_in_flight) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    m_unframes_in_flight = un_frames_in_flight;
+
+    VkSemaphoreTypeCreateInfo semaphore_type_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo semaphore_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphore_type_create_info,
+        .flags = 0,
+    };
+    b_qualify_vk(vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &m_vktimeline));
+
+    return true;
+  }
+
+  //waits for every submitted frame and runs what is still deferred
+  void Destroy() {
+    if (m_vktimeline == VK_NULL_HANDLE) {
+      return;
+    }
+
+    Wait(m_unsubmitted_value);
+    m_uncompleted_value = m_unsubmitted_value;
+    CollectGarbage();
+
+    vkDestroySemaphore(m_vkdevice, m_vktimeline, nullptr);
+    m_vktimeline = VK_NULL_HANDLE;
+  }
+
+  //blocks until the GPU has finished the frame that last used the next frame's slot
+  bool WaitForFrameSlot() {
+    uint64_t un_next_value = m_unsubmitted_value + 1;
+    if (un_next_value <= m_unframes_in_flight) {
+      return true;
+    }
+    return Wait(un_next_value - m_unframes_in_flight);
+  }
+
+  //slot of the frame about to be recorded, in [0, frames in flight)
+  uint32_t GetFrameSlot() const { return static_cast<uint32_t>(m_unsubmitted_value % m_unframes_in_flight); }
+
+  //the next submit signals GetTimelineSemaphore() to GetSignalValue(), then calls OnSubmitted
+  VkSemaphore GetTimelineSemaphore() const { return m_vktimeline; }
+  uint64_t GetSignalValue() const { return m_unsubmitted_value + 1; }
+  void OnSubmitted() { m_unsubmitted_value++; }
+
+  uint64_t GetSubmittedValue() const { return m_unsubmitted_value; }
+
+  //frames up to and including the returned one have completed on the GPU
+  uint64_t GetCompletedValue() {
+    uint64_t un_value = 0;
+    if (vkGetSemaphoreCounterValue(m_vkdevice, m_vktimeline, &un_value) == VK_SUCCESS) {
+      m_uncompleted_value = un_value;
+    }
+    return m_uncompleted_value;
+  }
+
+  bool Wait(uint64_t un_value) {
+    if (un_value <= m_uncompleted_value) {
+      return true;
+    }
+
+    VkSemaphoreWaitInfo semaphore_wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_vktimeline,
+        .pValues = &un_value,
+    };
+    b_qualify_vk(vkWaitSemaphores(m_vkdevice, &semaphore_wait_info, UINT64_MAX));
+    m_uncompleted_value = un_value;
+    return true;
+  }
+
+  //runs fn once every frame submitted so far has completed, for objects those frames may still be using
+  void Defer(std::function<void()> fn) { mdq_deferred.push_back({m_unsubmitted_value, std::move(fn)}); }
+
+  //runs the deferred functions whose frames have completed, in the order they were deferred
+  void CollectGarbage() {
+    while (!mdq_deferred.empty() && mdq_deferred.front().first <= m_uncompleted_value) {
+      std::function<void()> fn = std::move(mdq_deferred.front().second);
+      mdq_deferred.pop_front();
+      fn();
+    }
+  }
+
+ private:
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  VkSemaphore m_vktimeline = VK_NULL_HANDLE;
+  uint32_t m_unframes_in_flight = 1;
+
+  uint64_t m_unsubmitted_value = 0;
+  uint64_t m_uncompleted_value = 0;  //last value read back, the GPU may be further along
+
+  std::deque<std::pair<uint64_t, std::function<void()>>> mdq_deferred;  //frame value, fn
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//per-frame timings reported by Program::Tick, all in milliseconds
+struct FrameTiming {
+  float f_frame_ms = 0.f;  //time since the previous Tick started
+  float f_wait_ms = 0.f;   //waiting for the GPU to finish the frame that last used this slot
+  float f_acquire_ms = 0.f;
+  float f_record_ms = 0.f;
+  float f_submit_ms = 0.f;
+  float f_present_ms = 0.f;
+
+  //GPU time of the render pass of the frame that last used this slot, only known once that frame has completed
+  std::optional<float> opt_gpu_ms;
+
+  //from input being polled to vkQueuePresentKHR returning, windowed only
+  std::optional<float> opt_input_to_present_ms;
+
+  //from input being polled to the image reaching the display, for every earlier frame that got there since the
+  //previous Tick. needs VK_KHR_present_wait
+  std::vector<float> v_input_to_display_ms;
+};
+
+//collects named samples and reports percentile statistics as JSON
+class FrameStats {
+ public:
+  void Add(const std::string& s_name, float f_value) {
+    for (auto& [s_metric_name, v_samples] : mv_metrics) {
+      if (s_metric_name == s_name) {
+        v_samples.push_back(f_value);
+        return;
+      }
+    }
+
+    mv_metrics.push_back({s_name, {f_value}});
+  }
+
+  void Add(const FrameTiming& timing) {
+    Add("frame_ms", timing.f_frame_ms);
+    Add("wait_ms", timing.f_wait_ms);
+    Add("acquire_ms", timing.f_acquire_ms);
+    Add("record_ms", timing.f_record_ms);
+    Add("submit_ms", timing.f_submit_ms);
+    Add("present_ms", timing.f_present_ms);
+
+    if (timing.opt_gpu_ms.has_value()) {
+      Add("gpu_ms", timing.opt_gpu_ms.value());
+    }
+
+    if (timing.opt_input_to_present_ms.has_value()) {
+      Add("input_to_present_ms", timing.opt_input_to_present_ms.value());
+    }
+
+    for (float f_latency_ms : timing.v_input_to_display_ms) {
+      Add("input_to_display_ms", f_latency_ms);
+    }
+  }
+
+  //writes {"name": {"count", "mean", "min", "p50", "p95", "p99", "max"}, ...}
+  void WriteJson(std::ostream& out, int n_indent = 2) const {
+    std::string s_pad(n_indent, ' ');
+
+    out << "{";
+    for (size_t i = 0; i < mv_metrics.size(); i++) {
+      std::vector<float> v_sorted = mv_metrics[i].second;
+      std::sort(v_sorted.begin(), v_sorted.end());
+
+      double f_sum = 0.0;
+      for (float f_value : v_sorted) {
+        f_sum += f_value;
+      }
+
+      out << (i == 0 ? "\n" : ",\n") << s_pad << "  \"" << mv_metrics[i].first << "\": {"
+          << "\"count\": " << v_sorted.size() << ", \"mean\": " << f_sum / v_sorted.size()
+          << ", \"min\": " << v_sorted.front() << ", \"p50\": " << Percentile(v_sorted, 50.f)
+          << ", \"p95\": " << Percentile(v_sorted, 95.f) << ", \"p99\": " << Percentile(v_sorted, 99.f)
+          << ", \"max\": " << v_sorted.back() << "}";
+    }
+    out << "\n" << s_pad << "}";
+  }
+
+ private:
+  //nearest-rank percentile of an ascending, non-empty sample set
+  static float Percentile(const std::vector<float>& v_sorted, float f_percentile) {
+    size_t n_rank = static_cast<size_t>(std::ceil(f_percentile / 100.0 * v_sorted.size()));
+    n_rank = std::clamp<size_t>(n_rank, 1, v_sorted.size());
+    return v_sorted[n_rank - 1];
+  }
+
+  std::vector<std::pair<std::string, std::vector<float>>> mv_metrics;
+};
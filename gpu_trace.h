@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include "trace.h"
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
+#include "vulkan/vulkan.h"
+
+//GPU ranges of one queue, measured with timestamp queries and wrapped in debug utils labels so captures in RenderDoc
+//or Nsight show the same names. results are read back once a frame slot's last frame has completed and land on their
+//own track of the Tracer, converted to the CPU clock with VK_EXT_calibrated_timestamps when the device supports
+//CLOCK_MONOTONIC calibration. without it a frame's first range is placed at the CPU time of its submit.
+//the first range of each frame spans the whole frame, its duration is also kept for the benchmark's GPU time
+class GpuTracer : VkDeviceDispatch {
+ public:
+  //timestamp pairs each frame slot can hold, ranges beyond that are only labelled
+  static constexpr uint32_t MAX_RANGES_PER_FRAME = 32;
+
+  //the label functions may be null when debug utils is unavailable. b_calibrated_timestamps means
+  //VK_EXT_calibrated_timestamps is enabled and supports the device and CLOCK_MONOTONIC domains. b_time_frames times
+  //each frame's first range even while tracing is off
+  bool Init(VkDevice vkdevice, const VkDeviceDispatch& dispatch, const char* p_track_name, uint32_t un_frame_count,
+            uint32_t un_timestamp_valid_bits, float f_timestamp_period,
+            PFN_vkCmdBeginDebugUtilsLabelEXT pfn_begin_label, PFN_vkCmdEndDebugUtilsLabelEXT pfn_end_label,
+            bool b_calibrated_timestamps, bool b_time_frames) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    vkCmdBeginDebugUtilsLabelEXT = pfn_begin_label;
+    vkCmdEndDebugUtilsLabelEXT = pfn_end_label;
+    m_bcalibrated_timestamps = b_calibrated_timestamps;
+    m_ftimestamp_period = f_timestamp_period;
+    m_untimestamp_mask = un_timestamp_valid_bits >= 64 ? UINT64_MAX : (uint64_t{1} << un_timestamp_valid_bits) - 1;
+
+    m_unranges_per_frame = Tracer::Get().IsEnabled() ? MAX_RANGES_PER_FRAME : b_time_frames ? 1 : 0;
+    if (m_unranges_per_frame == 0 || un_timestamp_valid_bits == 0) {
+      return true;
+    }
+
+    VkQueryPoolCreateInfo query_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2 * m_unranges_per_frame * un_frame_count,
+        .pipelineStatistics = 0,
+    };
+    b_qualify_vk(vkCreateQueryPool(m_vkdevice, &query_pool_create_info, nullptr, &m_vkquery_pool));
+
+    if (Tracer::Get().IsEnabled()) {
+      mp_track = &Tracer::Get().CreateTrack(p_track_name);
+    }
+    mv_frames.resize(un_frame_count);
+
+    return true;
+  }
+
+  void Destroy() {
+    if (m_vkquery_pool != VK_NULL_HANDLE) {
+      vkDestroyQueryPool(m_vkdevice, m_vkquery_pool, nullptr);
+      m_vkquery_pool = VK_NULL_HANDLE;
+    }
+  }
+
+  //hands the ranges the slot recorded last time to the tracer. only call once that frame has completed
+  void Collect(uint32_t un_frame) {
+    m_opt_frame_ms.reset();
+    if (m_vkquery_pool == VK_NULL_HANDLE || mv_frames[un_frame].v_ranges.empty()) {
+      return;
+    }
+    FrameRanges& frame = mv_frames[un_frame];
+
+    std::vector<uint64_t> v_timestamps(2 * frame.v_ranges.size());
+    if (vkGetQueryPoolResults(m_vkdevice, m_vkquery_pool, 2 * m_unranges_per_frame * un_frame,
+                              static_cast<uint32_t>(v_timestamps.size()), v_timestamps.size() * sizeof(uint64_t),
+                              v_timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+      frame.v_ranges.clear();
+      return;
+    }
+
+    uint64_t un_frame_ticks = (v_timestamps[1] - v_timestamps[0]) & m_untimestamp_mask;
+    m_opt_frame_ms = static_cast<float>(static_cast<double>(un_frame_ticks) * m_ftimestamp_period / 1e6);
+
+    if (mp_track == nullptr) {
+      frame.v_ranges.clear();
+      return;
+    }
+
+    //a GPU tick un_gpu_anchor happened at un_cpu_anchor_ns on the steady clock
+    uint64_t un_gpu_anchor = v_timestamps[0];
+    uint64_t un_cpu_anchor_ns = frame.un_submit_ns;
+    if (m_bcalibrated_timestamps) {
+      VkCalibratedTimestampInfoEXT calibrated_timestamp_infos[] = {
+          {
+              .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+              .pNext = nullptr,
+              .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT,
+          },
+          {
+              .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+              .pNext = nullptr,
+              .timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT,
+          },
+      };
+      uint64_t un_calibrated[2];
+      uint64_t un_max_deviation;
+      if (vkGetCalibratedTimestampsEXT(m_vkdevice, 2, calibrated_timestamp_infos, un_calibrated,
+                                       &un_max_deviation) == VK_SUCCESS) {
+        un_gpu_anchor = un_calibrated[0];
+        un_cpu_anchor_ns = un_calibrated[1];
+      }
+    }
+
+    auto ToCpuNs = [&](uint64_t un_timestamp) {
+      //the anchor is usually later than the timestamp, the masked difference handles both and counter wrap
+      uint64_t un_ticks_before = (un_gpu_anchor - un_timestamp) & m_untimestamp_mask;
+      if (un_ticks_before <= m_untimestamp_mask / 2) {
+        return un_cpu_anchor_ns - static_cast<uint64_t>(static_cast<double>(un_ticks_before) * m_ftimestamp_period);
+      }
+      uint64_t un_ticks_after = (un_timestamp - un_gpu_anchor) & m_untimestamp_mask;
+      return un_cpu_anchor_ns + static_cast<uint64_t>(static_cast<double>(un_ticks_after) * m_ftimestamp_period);
+    };
+
+    for (size_t i = 0; i < frame.v_ranges.size(); i++) {
+      Tracer::Get().Record(*mp_track, frame.v_ranges[i], ToCpuNs(v_timestamps[2 * i]),
+                           ToCpuNs(v_timestamps[2 * i + 1]));
+    }
+    frame.v_ranges.clear();
+  }
+
+  //resets the slot's queries, record before any range of the frame
+  void BeginFrame(VkCommandBuffer vkcommand_buffer, uint32_t un_frame) {
+    m_uncurrent_frame = un_frame;
+    mv_open_queries.clear();  //a frame abandoned halfway through recording may have left ranges open
+    if (m_vkquery_pool != VK_NULL_HANDLE) {
+      mv_frames[un_frame].v_ranges.clear();
+      vkCmdResetQueryPool(vkcommand_buffer, m_vkquery_pool, 2 * m_unranges_per_frame * un_frame,
+                          2 * m_unranges_per_frame);
+    }
+  }
+
+  //call right before the frame's command buffer is submitted
+  void EndFrame() {
+    if (m_vkquery_pool != VK_NULL_HANDLE) {
+      mv_frames[m_uncurrent_frame].un_submit_ns = Tracer::NowNs();
+    }
+  }
+
+  //ranges nest, every BeginRange needs an EndRange in the same command buffer. p_name must outlive the tracer
+  void BeginRange(VkCommandBuffer vkcommand_buffer, const char* p_name) {
+    if (vkCmdBeginDebugUtilsLabelEXT != nullptr) {
+      VkDebugUtilsLabelEXT label = {
+          .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+          .pNext = nullptr,
+          .pLabelName = p_name,
+          .color = {0.f, 0.f, 0.f, 0.f},
+      };
+      vkCmdBeginDebugUtilsLabelEXT(vkcommand_buffer, &label);
+    }
+
+    uint32_t un_query = UINT32_MAX;
+    if (m_vkquery_pool != VK_NULL_HANDLE && mv_frames[m_uncurrent_frame].v_ranges.size() < m_unranges_per_frame) {
+      FrameRanges& frame = mv_frames[m_uncurrent_frame];
+      un_query = 2 * (m_unranges_per_frame * m_uncurrent_frame + static_cast<uint32_t>(frame.v_ranges.size()));
+      frame.v_ranges.push_back(p_name);
+      vkCmdWriteTimestamp(vkcommand_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_vkquery_pool, un_query);
+    }
+    mv_open_queries.push_back(un_query);
+  }
+
+  void EndRange(VkCommandBuffer vkcommand_buffer) {
+    uint32_t un_query = mv_open_queries.back();
+    mv_open_queries.pop_back();
+    if (un_query != UINT32_MAX) {
+      vkCmdWriteTimestamp(vkcommand_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_vkquery_pool, un_query + 1);
+    }
+
+    if (vkCmdEndDebugUtilsLabelEXT != nullptr) {
+      vkCmdEndDebugUtilsLabelEXT(vkcommand_buffer);
+    }
+  }
+
+  //GPU time of the first range of the frame the last Collect read back, empty when it had no timestamps
+  std::optional<float> GetFrameMs() const { return m_opt_frame_ms; }
+
+ private:
+  struct FrameRanges {
+    std::vector<const char*> v_ranges;  //range i owns queries 2i and 2i + 1 of the slot
+    uint64_t un_submit_ns = 0;
+  };
+
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  VkQueryPool m_vkquery_pool = VK_NULL_HANDLE;
+  Tracer::Track* mp_track = nullptr;
+
+  double m_ftimestamp_period = 1.0;  //nanoseconds per tick, double so large tick counts keep their precision
+  bool m_bcalibrated_timestamps = false;
+  uint64_t m_untimestamp_mask = UINT64_MAX;
+  uint32_t m_unranges_per_frame = 0;  //timestamp pairs per frame slot
+  std::optional<float> m_opt_frame_ms;
+
+  std::vector<FrameRanges> mv_frames;
+  uint32_t m_uncurrent_frame = 0;
+  std::vector<uint32_t> mv_open_queries;
+
+  PFN_vkCmdBeginDebugUtilsLabelEXT vkCmdBeginDebugUtilsLabelEXT = nullptr;
+  PFN_vkCmdEndDebugUtilsLabelEXT vkCmdEndDebugUtilsLabelEXT = nullptr;
+};
+
+//labels and times the enclosing scope on the GPU
+class GpuTraceScope {
+ public:
+  GpuTraceScope(GpuTracer& gpu_tracer, VkCommandBuffer vkcommand_buffer, const char* p_name)
+      : m_gpu_tracer(gpu_tracer), m_vkcommand_buffer(vkcommand_buffer) {
+    m_gpu_tracer.BeginRange(m_vkcommand_buffer, p_name);
+  }
+  ~GpuTraceScope() { m_gpu_tracer.EndRange(m_vkcommand_buffer); }
+
+  GpuTraceScope(const GpuTraceScope&) = delete;
+  GpuTraceScope& operator=(const GpuTraceScope&) = delete;
+
+ private:
+  GpuTracer& m_gpu_tracer;
+  VkCommandBuffer m_vkcommand_buffer;
+};
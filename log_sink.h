@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+//takes messages from any thread without locking or blocking and prints them from a background thread.
+//Push copies the text into a slot of a bounded queue (Vyukov's sequence-numbered ring), so a driver thread calling the
+//validation callback only pays for a memcpy. when the queue is full the message is dropped and counted instead of
+//waiting. the printing thread allows MAX_PER_ID_PER_SECOND messages per message id per second and reports how many
+//it suppressed once the id's window closes
+class LogSink {
+ public:
+  static constexpr uint32_t QUEUE_CAPACITY = 1024;  //power of two
+  static constexpr size_t MAX_MESSAGE_LENGTH = 1024;
+  static constexpr uint32_t MAX_PER_ID_PER_SECOND = 5;
+
+  void Init(const char* p_prefix) {
+    mp_prefix = p_prefix;
+    mp_slots = std::make_unique<Slot[]>(QUEUE_CAPACITY);
+    for (uint32_t i = 0; i < QUEUE_CAPACITY; i++) {
+      mp_slots[i].un_sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_thread = std::thread([this]() { DrainLoop(); });
+  }
+
+  //prints everything still queued and joins the thread
+  void Destroy() {
+    if (!m_thread.joinable()) {
+      return;
+    }
+
+    m_bstopping.store(true, std::memory_order_release);
+    m_unpending.fetch_add(1, std::memory_order_release);
+    m_unpending.notify_one();
+    m_thread.join();
+
+    uint64_t un_dropped = m_undropped.load(std::memory_order_relaxed);
+    if (un_dropped > 0) {
+      std::cerr << mp_prefix << " " << un_dropped << " messages dropped, the log queue was full" << std::endl;
+    }
+  }
+
+  //safe from any thread, never blocks. messages that do not fit in the queue are dropped
+  void Push(bool b_error, int32_t n_message_id, const char* p_message) {
+    uint64_t un_position = m_unenqueue_position.load(std::memory_order_relaxed);
+    Slot* p_slot;
+    while (true) {
+      p_slot = &mp_slots[un_position & (QUEUE_CAPACITY - 1)];
+      uint64_t un_sequence = p_slot->un_sequence.load(std::memory_order_acquire);
+
+      if (un_sequence == un_position) {
+        if (m_unenqueue_position.compare_exchange_weak(un_position, un_position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (un_sequence < un_position) {
+        //the consumer has not freed this slot yet, the queue is full
+        m_undropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else {
+        un_position = m_unenqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+
+    p_slot->b_error = b_error;
+    p_slot->n_message_id = n_message_id;
+    size_t n_length = std::min(strlen(p_message), MAX_MESSAGE_LENGTH - 1);
+    memcpy(p_slot->s_message, p_message, n_length);
+    p_slot->s_message[n_length] = '\0';
+    p_slot->un_sequence.store(un_position + 1, std::memory_order_release);
+
+    m_unpending.fetch_add(1, std::memory_order_release);
+    m_unpending.notify_one();
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> un_sequence;  //== position when free, position + 1 once written
+    bool b_error;
+    int32_t n_message_id;
+    char s_message[MAX_MESSAGE_LENGTH];
+  };
+
+  struct RateWindow {
+    std::chrono::steady_clock::time_point start;
+    uint32_t un_printed = 0;
+    uint32_t un_suppressed = 0;
+  };
+
+  void DrainLoop() {
+    while (true) {
+      m_unpending.wait(0, std::memory_order_acquire);
+
+      //a push counted after the exchange leaves the counter non-zero, so the next wait returns straight away
+      m_unpending.exchange(0, std::memory_order_acquire);
+      Drain();
+
+      if (m_bstopping.load(std::memory_order_acquire)) {
+        Drain();
+        FlushSuppressed(true);
+        return;
+      }
+
+      FlushSuppressed(false);
+    }
+  }
+
+  void Drain() {
+    bool b_printed = false;
+    while (true) {
+      Slot& slot = mp_slots[m_undequeue_position & (QUEUE_CAPACITY - 1)];
+      if (slot.un_sequence.load(std::memory_order_acquire) != m_undequeue_position + 1) {
+        break;
+      }
+
+      if (Allow(slot.n_message_id)) {
+        (slot.b_error ? std::cerr : std::cout) << mp_prefix << " " << slot.s_message << '\n';
+        b_printed = true;
+      }
+
+      slot.un_sequence.store(m_undequeue_position + QUEUE_CAPACITY, std::memory_order_release);
+      m_undequeue_position++;
+    }
+
+    if (b_printed) {
+      std::cout.flush();
+      std::cerr.flush();
+    }
+  }
+
+  bool Allow(int32_t n_message_id) {
+    auto now = std::chrono::steady_clock::now();
+    RateWindow& window = m_rate_windows[n_message_id];
+    if (now - window.start >= std::chrono::seconds(1)) {
+      ReportSuppressed(n_message_id, window);
+      window = {.start = now};
+    }
+
+    if (window.un_printed >= MAX_PER_ID_PER_SECOND) {
+      window.un_suppressed++;
+      return false;
+    }
+
+    window.un_printed++;
+    return true;
+  }
+
+  //reports ids whose window has closed, or all of them on shutdown
+  void FlushSuppressed(bool b_all) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& [n_message_id, window] : m_rate_windows) {
+      if (b_all || now - window.start >= std::chrono::seconds(1)) {
+        ReportSuppressed(n_message_id, window);
+      }
+    }
+  }
+
+  void ReportSuppressed(int32_t n_message_id, RateWindow& window) {
+    if (window.un_suppressed > 0) {
+      std::cerr << mp_prefix << " Suppressed " << window.un_suppressed << " more messages with id 0x" << std::hex
+                << static_cast<uint32_t>(n_message_id) << std::dec << std::endl;
+      window.un_suppressed = 0;
+    }
+  }
+
+  const char* mp_prefix = "";
+  std::unique_ptr<Slot[]> mp_slots;
+  std::atomic<uint64_t> m_unenqueue_position{0};
+  std::atomic<uint64_t> m_undropped{0};
+  std::atomic<uint32_t> m_unpending{0};
+  std::atomic<bool> m_bstopping{false};
+  std::thread m_thread;
+
+  //drain thread only
+  uint64_t m_undequeue_position = 0;
+  std::unordered_map<int32_t, RateWindow> m_rate_windows;
+};
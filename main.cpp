@@ -1,76 +1,440 @@
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <vector>
 
-#define VK_USE_PLATFORM_WIN32_KHR
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
-#define GLFW_EXPOSE_NATIVE_WIN32
-#include <GLFW/glfw3native.h>
 
 #include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
 #include <fstream>
+#include <latch>
+#include <memory>
 #include <optional>
 #include <set>
-
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "draw_queue.h"
+#include "frame_readback.h"
+#include "frame_ring.h"
+#include "frame_scheduler.h"
+#include "frame_stats.h"
 #include "glm/glm.hpp"
+#include "gpu_trace.h"
+#include "log_sink.h"
+#include "memory_arena.h"
+#include "mesh_file.h"
+#include "pipeline_manager.h"
+#include "render_graph.h"
+#include "scene_core.h"
+#include "shader_registry.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "transfer_uploader.h"
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
 #include "vulkan/vulkan.h"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
-
-#define b_qualify_vk(x)                                                          \
-  do {                                                                           \
-    VkResult ret = x;                                                            \
-    if (ret != VK_SUCCESS) {                                                     \
-      std::cout << "[QualifyVK] " << #x << " failed with: " << ret << std::endl; \
-      return false;                                                              \
-    }                                                                            \
-  } while (0)
-
-#define v_qualify_vk(x)                                                          \
-  do {                                                                           \
-    VkResult ret = x;                                                            \
-    if (ret != VK_SUCCESS) {                                                     \
-      std::cout << "[QualifyVK] " << #x << " failed with: " << ret << std::endl; \
-      return;                                                                    \
-    }                                                                            \
-  } while (0)
-
-#define d_qualify_vk(x)                                                          \
-  do {                                                                           \
-    VkResult ret = x;                                                            \
-    if (ret != VK_SUCCESS) {                                                     \
-      std::cout << "[QualifyVK] " << #x << " failed with: " << ret << std::endl; \
-      return {};                                                                 \
-    }                                                                            \
-  } while (0)
-
-#define vk_get_proc(instance, name)                            \
-  do {                                                         \
-    name = (PFN_##name)vkGetInstanceProcAddr(instance, #name); \
-  } while (0)
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+//each frame in flight owns a command buffer, semaphores and a ring region, more than this only adds latency
+const uint32_t MAX_FRAMES_IN_FLIGHT = 16;
+
+const uint32_t HEADLESS_DEFAULT_FRAME_COUNT = 1000;
+
+//bytes of per-frame uniform and upload data each frame in flight can write
+const VkDeviceSize FRAME_RING_REGION_SIZE = 64 * 1024;
+
+//local_size_x of shaders/cull.comp
+const uint32_t CULL_GROUP_SIZE = 64;
+
+const uint32_t CULL_BENCHMARK_DEFAULT_INSTANCES = 1 << 20;
+
+//the commands of one draw in the main pass as the dispatch benchmark records it: pipeline, uniforms, dynamic state
+//and the draw itself
+const uint32_t DISPATCH_BENCHMARK_COMMANDS_PER_DRAW = 5;
+
+//set by CMake from VALIDATION_TIER, see ValidationTier
+#ifndef DEFAULT_VALIDATION_TIER
+#define DEFAULT_VALIDATION_TIER "full"
+#endif
+
+//how much of the validation layer is loaded. every tier above off costs CPU time on every Vulkan call
+enum class ValidationTier {
+  kOff,          //no layer and no messenger
+  kErrors,       //layer loaded, only errors are reported
+  kFull,         //errors, warnings, performance warnings and verbose messages
+  kGpuAssisted,  //full plus GPU-assisted validation of shader accesses, much slower
+  kSync,         //full plus synchronization validation of hazards between commands
+};
+
+static constexpr const char* ValidationTierName(ValidationTier validation_tier) {
+  switch (validation_tier) {
+    case ValidationTier::kOff:
+      return "off";
+    case ValidationTier::kErrors:
+      return "errors";
+    case ValidationTier::kFull:
+      return "full";
+    case ValidationTier::kGpuAssisted:
+      return "gpu";
+    case ValidationTier::kSync:
+      return "sync";
+  }
+  return "unknown";
+}
+
+static constexpr std::optional<ValidationTier> ParseValidationTier(std::string_view s_name) {
+  for (ValidationTier validation_tier : {ValidationTier::kOff, ValidationTier::kErrors, ValidationTier::kFull,
+                                         ValidationTier::kGpuAssisted, ValidationTier::kSync}) {
+    if (s_name == ValidationTierName(validation_tier)) {
+      return validation_tier;
+    }
+  }
+  return std::nullopt;
+}
+
+static_assert(ParseValidationTier(DEFAULT_VALIDATION_TIER).has_value(),
+              "DEFAULT_VALIDATION_TIER must be off, errors, full, gpu or sync");
+
+struct ProgramConfig {
+  //render into device-local images instead of a window surface and swapchain
+  bool b_headless = false;
+
+  //number of frames to render before exiting, 0 runs until the window is closed
+  uint32_t un_frame_count = 0;
+
+  //time every frame and write percentile statistics as JSON on exit
+  bool b_benchmark = false;
+  uint32_t un_benchmark_warmup_frames = 10;
+  std::string s_benchmark_output;  //empty writes to stdout
+
+  //samples per pixel, rendered into a transient attachment and resolved into the output image. clamped to what the
+  //device supports
+  uint32_t un_msaa_samples = 1;
+
+  //keep the render pass, framebuffers and vkQueueSubmit path even where dynamic rendering is available
+  bool b_legacy_rendering = false;
+
+  //pipeline cache loaded at startup and written back on shutdown, empty disables it
+  std::string s_pipeline_cache_path = "pipeline_cache.bin";
+
+  //draw calls issued per frame, each one draws an equal share of the instances
+  uint32_t un_draw_count = 1;
+
+  //triangles laid out in a grid and read from a storage buffer by the vertex shader, 0 draws one per draw call
+  uint32_t un_instance_count = 0;
+
+  //the instance grid spans this many times the width and height of the view, so only about 1 / scale^2 of it is
+  //on screen
+  float f_scene_scale = 1.f;
+
+  //a compute pass tests every instance against the view frustum and draws the survivors with one
+  //vkCmdDrawIndexedIndirectCount, replacing --draws and --record-threads. culls on the CPU where the device lacks the
+  //features
+  bool b_gpu_culling = false;
+
+  //SIMD frustum culling on a thread pool, writing the visible instances into a mapped ring every frame
+  bool b_cpu_culling = false;
+
+  //times the CPU culling kernels over this many passes of the instances, reports instances per second and exits
+  uint32_t un_cull_benchmark_iterations = 0;
+
+  //worker threads recording secondary command buffers, 0 records everything inline on the calling thread
+  uint32_t un_record_threads = 0;
+
+  //.mesh file (mesh_format.h) copied from its mapping into device-local vertex and index buffers at startup, empty
+  //loads none
+  std::string s_mesh_path;
+
+  //radians per second every instance rotates by, driven through the per-frame uniforms
+  float f_spin_speed = 0.f;
+
+  //frames the CPU may record ahead of the GPU, each with its own command buffer, command pools and uniform region
+  uint32_t un_frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+
+  //unset prefers MAILBOX and falls back to FIFO, an unsupported explicit choice also falls back to FIFO
+  std::optional<VkPresentModeKHR> opt_present_mode;
+
+  //requested swapchain images, clamped to the surface limits. 0 uses minImageCount + 1
+  uint32_t un_swapchain_images = 0;
+
+  //caps the frame rate by sleeping before input is polled, 0 runs unthrottled
+  float f_fps_limit = 0.f;
+
+  //fragment shader specialization constant, 0 keeps vertex colors, 1 grayscale, 2 inverted.
+  //non-zero modes compile in the background while the default pipeline is drawn
+  uint32_t un_color_mode = 0;
+
+  //Chrome trace JSON of CPU scopes and GPU ranges written on exit, empty disables tracing
+  std::string s_trace_path;
+
+  //file or named pipe every headless frame is streamed to, empty renders without reading frames back
+  std::string s_output_path;
+  ReadbackFormat output_format = ReadbackFormat::kRawRgba;
+
+  ValidationTier validation_tier = ParseValidationTier(DEFAULT_VALIDATION_TIER).value();
+
+  //records this many commands through the loader and through the device dispatch table, reports both and exits
+  uint32_t un_dispatch_benchmark_calls = 0;
+
+  //physical device by index or by a substring of its name, empty picks the highest scoring suitable device
+  std::string s_device;
+
+  //headless render farm: this many contexts per suitable device (or only the --device one), each on its own thread,
+  //pulling frames from a shared queue of un_frame_count frames. 0 renders normally
+  uint32_t un_farm_contexts_per_device = 0;
+};
+
+static const char* PresentModeName(VkPresentModeKHR present_mode) {
+  switch (present_mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+      return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      return "fifo-relaxed";
+    default:
+      return "unknown";
+  }
+}
+
+static float MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//a serialized cache is only trusted when it was produced by this exact device and driver
+static bool IsPipelineCacheCompatible(const std::vector<char>& v_data,
+                                      const VkPhysicalDeviceProperties& physical_device_properties) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (v_data.size() < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, v_data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) && header.headerSize <= v_data.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == physical_device_properties.vendorID &&
+         header.deviceID == physical_device_properties.deviceID &&
+         memcmp(header.pipelineCacheUUID, physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+struct PhysicalDeviceCandidate {
+  uint32_t un_index;  //in vkEnumeratePhysicalDevices order
+  VkPhysicalDevice vkphysical_device;
+  std::string s_name;
+  std::optional<uint64_t> opt_score;  //nullopt when the device cannot run the program
+  std::string s_reason;               //why it cannot
+};
+
+//the device type dominates the score, then device-local memory, then a dedicated transfer family for uploads.
+//a device is unsuitable without Vulkan 1.2 timeline semaphores, a graphics queue, or, when vksurface is set, a queue
+//that can present to it and the swapchain extension
+static PhysicalDeviceCandidate ScorePhysicalDevice(uint32_t un_index, VkPhysicalDevice vkphysical_device,
+                                                   VkSurfaceKHR vksurface) {
+  VkPhysicalDeviceProperties physical_device_properties;
+  vkGetPhysicalDeviceProperties(vkphysical_device, &physical_device_properties);
+
+  PhysicalDeviceCandidate candidate = {
+      .un_index = un_index,
+      .vkphysical_device = vkphysical_device,
+      .s_name = physical_device_properties.deviceName,
+      .opt_score = std::nullopt,
+      .s_reason = "",
+  };
+
+  //timeline semaphores order transfer queue uploads against rendering
+  VkPhysicalDeviceVulkan12Features vulkan12_features{
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+  };
+  VkPhysicalDeviceFeatures2 features2 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+      .pNext = &vulkan12_features,
+  };
+  if (physical_device_properties.apiVersion >= VK_API_VERSION_1_2) {
+    vkGetPhysicalDeviceFeatures2(vkphysical_device, &features2);
+  }
+  if (!vulkan12_features.timelineSemaphore) {
+    candidate.s_reason = "no Vulkan 1.2 timeline semaphores";
+    return candidate;
+  }
+
+  uint32_t un_queue_family_count = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(vkphysical_device, &un_queue_family_count, nullptr);
+  std::vector<VkQueueFamilyProperties> v_queue_family_properties(un_queue_family_count);
+  vkGetPhysicalDeviceQueueFamilyProperties(vkphysical_device, &un_queue_family_count,
+                                           v_queue_family_properties.data());
+
+  bool b_graphics = false;
+  bool b_present = vksurface == VK_NULL_HANDLE;
+  bool b_dedicated_transfer = false;
+  for (uint32_t i = 0; i < un_queue_family_count; i++) {
+    VkQueueFlags queue_flags = v_queue_family_properties[i].queueFlags;
+    b_graphics = b_graphics || (queue_flags & VK_QUEUE_GRAPHICS_BIT);
+    b_dedicated_transfer =
+        b_dedicated_transfer || ((queue_flags & VK_QUEUE_TRANSFER_BIT) && !(queue_flags & VK_QUEUE_GRAPHICS_BIT));
+
+    if (!b_present) {
+      VkBool32 present_support = VK_FALSE;
+      vkGetPhysicalDeviceSurfaceSupportKHR(vkphysical_device, i, vksurface, &present_support);
+      b_present = present_support;
+    }
+  }
+  if (!b_graphics) {
+    candidate.s_reason = "no graphics queue";
+    return candidate;
+  }
+  if (!b_present) {
+    candidate.s_reason = "cannot present to the window";
+    return candidate;
+  }
+
+  if (vksurface != VK_NULL_HANDLE) {
+    uint32_t un_extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(vkphysical_device, nullptr, &un_extension_count, nullptr);
+    std::vector<VkExtensionProperties> v_extensions(un_extension_count);
+    vkEnumerateDeviceExtensionProperties(vkphysical_device, nullptr, &un_extension_count, v_extensions.data());
+
+    if (std::none_of(v_extensions.begin(), v_extensions.end(), [](const VkExtensionProperties& extension) {
+          return strcmp(extension.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+        })) {
+      candidate.s_reason = "no swapchain support";
+      return candidate;
+    }
+  }
+
+  uint64_t un_type_rank = 0;
+  switch (physical_device_properties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      un_type_rank = 4;
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      un_type_rank = 3;
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      un_type_rank = 2;
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      un_type_rank = 1;
+      break;
+    default:
+      break;
+  }
+
+  VkPhysicalDeviceMemoryProperties memory_properties;
+  vkGetPhysicalDeviceMemoryProperties(vkphysical_device, &memory_properties);
+  uint64_t un_device_local_mb = 0;
+  for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++) {
+    if (memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      un_device_local_mb += memory_properties.memoryHeaps[i].size / (1024 * 1024);
+    }
+  }
+
+  //memory is capped below one type rank, so a bigger integrated heap never beats a discrete GPU
+  candidate.opt_score = un_type_rank * 1'000'000'000 + std::min<uint64_t>(un_device_local_mb, 100'000'000) * 8 +
+                        (b_dedicated_transfer ? 1 : 0);
+  return candidate;
+}
+
+static std::vector<PhysicalDeviceCandidate> RankPhysicalDevices(VkInstance vkinstance, VkSurfaceKHR vksurface) {
+  uint32_t un_device_count = 0;
+  vkEnumeratePhysicalDevices(vkinstance, &un_device_count, nullptr);
+  std::vector<VkPhysicalDevice> v_physical_devices(un_device_count);
+  vkEnumeratePhysicalDevices(vkinstance, &un_device_count, v_physical_devices.data());
+
+  std::vector<PhysicalDeviceCandidate> v_candidates{};
+  for (uint32_t i = 0; i < un_device_count; i++) {
+    v_candidates.push_back(ScorePhysicalDevice(i, v_physical_devices[i], vksurface));
+  }
+  return v_candidates;
+}
+
+//s_device is either an index into vkEnumeratePhysicalDevices or a case-sensitive substring of the device name
+static bool MatchesDeviceOverride(const PhysicalDeviceCandidate& candidate, const std::string& s_device) {
+  //only a string that is a whole number in range is an index, anything else such as "1x" is part of a name
+  uint32_t un_index = 0;
+  const char* p_end = s_device.data() + s_device.size();
+  auto [p_parsed, error] = std::from_chars(s_device.data(), p_end, un_index);
+  if (!s_device.empty() && error == std::errc() && p_parsed == p_end) {
+    return candidate.un_index == un_index;
+  }
+  return candidate.s_name.find(s_device) != std::string::npos;
+}
 
+//matches FrameUniforms in shaders/hello.vert, rewritten every frame through the frame ring
+struct FrameUniforms {
+  glm::mat4 view_proj;
+  glm::vec4 time;  //x seconds since Init, y seconds since the previous frame, z spin speed in radians per second
+};
+
+//passes of the draw queue, drawn in this order. without a depth buffer the later pass ends up on top
+enum class DrawPass : uint32_t {
+  kMesh,
+  kInstances,
+};
+
+//matches MeshPushConstants in shaders/mesh.vert, the dequantization of the loaded mesh and where it is placed
+struct MeshPushConstants {
+  glm::vec4 position_scale;
+  glm::vec4 position_offset;
+  glm::vec4 placement;  //xyz added to the model space position, then scaled by w to fit the mesh into the view
+};
+
+//square grid over clip space times f_scene_scale, a single instance keeps the original full-size triangle
+static std::vector<InstanceData> BuildInstanceGrid(uint32_t un_count, float f_scene_scale) {
+  uint32_t un_grid_side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(un_count))));
+  float f_cell_size = 2.f * f_scene_scale / un_grid_side;
+
+  std::vector<InstanceData> v_instances(un_count);
+  for (uint32_t i = 0; i < un_count; i++) {
+    uint32_t un_hash = i * 2654435761u;
+    v_instances[i] = {
+        .transform = glm::vec4(-f_scene_scale + f_cell_size * (i % un_grid_side + 0.5f),
+                               -f_scene_scale + f_cell_size * (i / un_grid_side + 0.5f), f_cell_size * 0.5f, 0.f),
+        .color = un_count == 1 ? glm::vec4(1.f)
+                               : glm::vec4((un_hash & 0xFF) / 255.f, ((un_hash >> 8) & 0xFF) / 255.f,
+                                           ((un_hash >> 16) & 0xFF) / 255.f, 1.f),
+    };
+  }
+  return v_instances;
+}
+
+//runs on whichever thread made the Vulkan call, so it only queues the message for the log thread
 static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
                                                     VkDebugUtilsMessageTypeFlagsEXT type,
                                                     const VkDebugUtilsMessengerCallbackDataEXT* p_callback_data,
                                                     void* p_user_data) {
-
-  std::cerr << "[VkProgram-Val] " << p_callback_data->pMessage << std::endl;
+  static_cast<LogSink*>(p_user_data)
+      ->Push(severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, p_callback_data->messageIdNumber,
+             p_callback_data->pMessage);
 
   return VK_FALSE;
 }
 
-class Program {
+class Program : VkDeviceDispatch {
  public:
-  Program(GLFWwindow* glfw_window) : m_glfw_window(glfw_window) {};
+  Program(GLFWwindow* glfw_window, const ProgramConfig& config) : m_glfw_window(glfw_window), m_config(config) {};
 
   bool Init() {
+    TRACE_SCOPE("Init");
+
     {  //Vulkan instance initialization
       std::vector<const char*> v_enabled_layers{};
+      bool b_validation_features = false;
+      m_validation_tier = m_config.validation_tier;
 
-      {  //Vulkan validation layers
+      if (m_validation_tier != ValidationTier::kOff) {  //Vulkan validation layers
         const char* s_validation_layer_name = []() -> const char* {
           uint32_t un_layer_count;
           d_qualify_vk(vkEnumerateInstanceLayerProperties(&un_layer_count, nullptr));
@@ -93,9 +457,35 @@ class Program {
           return nullptr;
         }();
 
-        if (s_validation_layer_name) {
+        if (!s_validation_layer_name) {
+          m_validation_tier = ValidationTier::kOff;
+        } else {
           v_enabled_layers.push_back(s_validation_layer_name);
+
+          //GPU-assisted and synchronization validation are switched on through an extension of the layer itself
+          if (m_validation_tier == ValidationTier::kGpuAssisted || m_validation_tier == ValidationTier::kSync) {
+            uint32_t un_extension_count = 0;
+            b_qualify_vk(vkEnumerateInstanceExtensionProperties(s_validation_layer_name, &un_extension_count, nullptr));
+
+            std::vector<VkExtensionProperties> v_layer_extensions(un_extension_count);
+            b_qualify_vk(vkEnumerateInstanceExtensionProperties(s_validation_layer_name, &un_extension_count,
+                                                                v_layer_extensions.data()));
+
+            b_validation_features = std::any_of(v_layer_extensions.begin(), v_layer_extensions.end(),
+                                                [](const VkExtensionProperties& extension) {
+                                                  return strcmp(extension.extensionName,
+                                                                VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME) == 0;
+                                                });
+            if (!b_validation_features) {
+              std::cout << "[Program] " << VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME
+                        << " is not available, falling back to full validation" << std::endl;
+              m_validation_tier = ValidationTier::kFull;
+            }
+          }
         }
+
+        //what is actually enabled, after falling back for a missing layer or extension
+        std::cout << "[Program] Validation: " << ValidationTierName(m_validation_tier) << std::endl;
       }
 
       {  //Create vulkan instance
@@ -105,17 +495,40 @@ class Program {
             .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
             .pEngineName = "danwillm",
             .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-            .apiVersion = VK_API_VERSION_1_0,
+            .apiVersion = VK_API_VERSION_1_3,  //the highest version used, 1.2 devices keep working
         };
 
-        uint32_t un_glfw_extension_count = 0;
-        const char** pp_glfw_extensions = glfwGetRequiredInstanceExtensions(&un_glfw_extension_count);
+        std::vector<const char*> v_extensions{};
+        if (!m_config.b_headless) {
+          uint32_t un_glfw_extension_count = 0;
+          const char** pp_glfw_extensions = glfwGetRequiredInstanceExtensions(&un_glfw_extension_count);
 
-        std::vector<const char*> v_extensions(pp_glfw_extensions, pp_glfw_extensions + un_glfw_extension_count);
+          v_extensions.assign(pp_glfw_extensions, pp_glfw_extensions + un_glfw_extension_count);
+        }
         v_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        if (b_validation_features) {
+          v_extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+        }
+
+        std::vector<VkValidationFeatureEnableEXT> v_enabled_validation_features{};
+        if (m_validation_tier == ValidationTier::kGpuAssisted) {
+          v_enabled_validation_features.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT);
+          v_enabled_validation_features.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_RESERVE_BINDING_SLOT_EXT);
+        } else if (m_validation_tier == ValidationTier::kSync) {
+          v_enabled_validation_features.push_back(VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT);
+        }
+        VkValidationFeaturesEXT validation_features = {
+            .sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT,
+            .pNext = nullptr,
+            .enabledValidationFeatureCount = static_cast<uint32_t>(v_enabled_validation_features.size()),
+            .pEnabledValidationFeatures = v_enabled_validation_features.data(),
+            .disabledValidationFeatureCount = 0,
+            .pDisabledValidationFeatures = nullptr,
+        };
 
         VkInstanceCreateInfo instance_create_info = {
             .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+            .pNext = b_validation_features ? &validation_features : nullptr,
             .flags = 0,
             .pApplicationInfo = &application_info,
             .enabledLayerCount = (uint32_t)v_enabled_layers.size(),
@@ -129,46 +542,81 @@ class Program {
       {  //extension proc address registration
         vk_get_proc(m_vkinstance, vkCreateDebugUtilsMessengerEXT);
         vk_get_proc(m_vkinstance, vkDestroyDebugUtilsMessengerEXT);
+        vk_get_proc(m_vkinstance, vkCmdBeginDebugUtilsLabelEXT);
+        vk_get_proc(m_vkinstance, vkCmdEndDebugUtilsLabelEXT);
+        vk_get_proc(m_vkinstance, vkGetPhysicalDeviceCalibrateableTimeDomainsEXT);
       }
 
-      {  //debug utils
+      if (m_validation_tier != ValidationTier::kOff) {  //debug utils
+        m_log_sink.Init("[VkProgram-Val]");
+
+        bool b_errors_only = m_validation_tier == ValidationTier::kErrors;
         VkDebugUtilsMessengerCreateInfoEXT debug_utils_messenger_create_info = {
             .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
             .flags = 0,
-            .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-                               VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-                               VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-            .messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-                           VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-                           VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+            .messageSeverity = b_errors_only ? VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
+                                             : VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+                                                   VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+                                                   VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+            .messageType = b_errors_only ? VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
+                                         : VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                                               VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                                               VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
             .pfnUserCallback = DebugCallback,
-            .pUserData = nullptr,
+            .pUserData = &m_log_sink,
         };
         b_qualify_vk(vkCreateDebugUtilsMessengerEXT(m_vkinstance, &debug_utils_messenger_create_info, nullptr,
                                                     &m_vkdebug_utils_messenger));
       }
 
       //create surface
-      b_qualify_vk(glfwCreateWindowSurface(m_vkinstance, m_glfw_window, nullptr, &m_vksurface));
+      if (!m_config.b_headless) {
+        b_qualify_vk(glfwCreateWindowSurface(m_vkinstance, m_glfw_window, nullptr, &m_vksurface));
+      }
 
       {  //pick physical device
-        uint32_t un_device_count = 0;
-        b_qualify_vk(vkEnumeratePhysicalDevices(m_vkinstance, &un_device_count, nullptr));
-
-        if (un_device_count == 0) {
+        std::vector<PhysicalDeviceCandidate> v_candidates = RankPhysicalDevices(m_vkinstance, m_vksurface);
+        if (v_candidates.empty()) {
           std::cerr << "No vulkan physical devices!" << std::endl;
           return false;
         }
 
-        std::vector<VkPhysicalDevice> v_physical_devices(un_device_count);
-        b_qualify_vk(vkEnumeratePhysicalDevices(m_vkinstance, &un_device_count, v_physical_devices.data()));
+        const PhysicalDeviceCandidate* p_chosen = nullptr;
+        for (const PhysicalDeviceCandidate& candidate : v_candidates) {
+          if (candidate.opt_score.has_value()) {
+            std::cout << "[Program] Device " << candidate.un_index << ": " << candidate.s_name << ", score "
+                      << candidate.opt_score.value() << std::endl;
+          } else {
+            std::cout << "[Program] Device " << candidate.un_index << ": " << candidate.s_name << ", unsuitable, "
+                      << candidate.s_reason << std::endl;
+          }
+
+          bool b_eligible = m_config.s_device.empty() ? candidate.opt_score.has_value()
+                                                      : MatchesDeviceOverride(candidate, m_config.s_device);
+          if (b_eligible && (p_chosen == nullptr || candidate.opt_score > p_chosen->opt_score)) {
+            p_chosen = &candidate;
+          }
+        }
+
+        if (p_chosen == nullptr) {
+          std::cerr << "No suitable physical device"
+                    << (m_config.s_device.empty() ? "" : " matches --device " + m_config.s_device) << "!" << std::endl;
+          return false;
+        }
+        if (!p_chosen->opt_score.has_value()) {
+          std::cerr << "Physical device " << p_chosen->s_name << " cannot be used: " << p_chosen->s_reason << "!"
+                    << std::endl;
+          return false;
+        }
 
-        m_vkphysical_device = v_physical_devices.front();
+        m_vkphysical_device = p_chosen->vkphysical_device;
+        std::cout << "[Program] Using device " << p_chosen->un_index << ": " << p_chosen->s_name << std::endl;
       }
 
       struct QueueFamilyIndices {
         std::optional<uint32_t> opt_graphics_family;
         std::optional<uint32_t> opt_present_family;
+        std::optional<uint32_t> opt_transfer_family;
 
         bool isComplete() { return opt_graphics_family.has_value() && opt_present_family.has_value(); }
       };
@@ -188,10 +636,15 @@ class Program {
             queue_family_indices.opt_graphics_family = i;
           }
 
-          VkBool32 presentSupport = false;
-          vkGetPhysicalDeviceSurfaceSupportKHR(m_vkphysical_device, i, m_vksurface, &presentSupport);
-          if (presentSupport) {
-            queue_family_indices.opt_present_family = i;
+          if (m_config.b_headless) {
+            //nothing is presented, the graphics queue stands in for the present queue
+            queue_family_indices.opt_present_family = queue_family_indices.opt_graphics_family;
+          } else {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(m_vkphysical_device, i, m_vksurface, &presentSupport);
+            if (presentSupport) {
+              queue_family_indices.opt_present_family = i;
+            }
           }
 
           if (queue_family_indices.isComplete()) {
@@ -204,8 +657,27 @@ class Program {
           return false;
         }
 
+        //prefer a transfer-only family, which usually maps to the DMA engines, then any non-graphics family with
+        //transfer, otherwise uploads share the graphics queue
+        for (uint32_t i = 0; i < v_queue_family_properties.size(); i++) {
+          VkQueueFlags queue_flags = v_queue_family_properties[i].queueFlags;
+          if ((queue_flags & VK_QUEUE_TRANSFER_BIT) && !(queue_flags & VK_QUEUE_GRAPHICS_BIT)) {
+            if (!(queue_flags & VK_QUEUE_COMPUTE_BIT)) {
+              queue_family_indices.opt_transfer_family = i;
+              break;
+            }
+            if (!queue_family_indices.opt_transfer_family.has_value()) {
+              queue_family_indices.opt_transfer_family = i;
+            }
+          }
+        }
+        if (!queue_family_indices.opt_transfer_family.has_value()) {
+          queue_family_indices.opt_transfer_family = queue_family_indices.opt_graphics_family;
+        }
+
         std::set<uint32_t> set_unique_queue_families = {queue_family_indices.opt_graphics_family.value(),
-                                                        queue_family_indices.opt_present_family.value()};
+                                                        queue_family_indices.opt_present_family.value(),
+                                                        queue_family_indices.opt_transfer_family.value()};
 
         float f_queue_priorities = 1.f;
         std::vector<VkDeviceQueueCreateInfo> v_queue_create_infos{};
@@ -220,14 +692,165 @@ class Program {
           v_queue_create_infos.push_back(queue_create_info);
         }
 
-        const std::vector<const char*> v_device_extensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+        std::vector<const char*> v_device_extensions{};
+        if (!m_config.b_headless) {
+          v_device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+
+        //present ids and present wait tell us when a frame actually reached the display, which is what the input
+        //latency metric needs. without them latency is measured up to the return of vkQueuePresentKHR
+        VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+            .pNext = nullptr,
+            .presentWait = VK_FALSE,
+        };
+        VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = &present_wait_features,
+            .presentId = VK_FALSE,
+        };
+
+        uint32_t un_extension_count = 0;
+        b_qualify_vk(vkEnumerateDeviceExtensionProperties(m_vkphysical_device, nullptr, &un_extension_count, nullptr));
+
+        std::vector<VkExtensionProperties> v_available_extensions(un_extension_count);
+        b_qualify_vk(vkEnumerateDeviceExtensionProperties(m_vkphysical_device, nullptr, &un_extension_count,
+                                                          v_available_extensions.data()));
+
+        auto HasExtension = [&](const char* s_name) {
+          return std::any_of(v_available_extensions.begin(), v_available_extensions.end(),
+                             [&](const VkExtensionProperties& extension) {
+                               return strcmp(extension.extensionName, s_name) == 0;
+                             });
+        };
+
+        if (!m_config.b_headless) {
+          if (HasExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && HasExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+            VkPhysicalDeviceFeatures2 features2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &present_id_features,
+            };
+            vkGetPhysicalDeviceFeatures2(m_vkphysical_device, &features2);
+
+            m_bpresent_wait = present_id_features.presentId && present_wait_features.presentWait;
+          }
+        }
+
+        if (m_bpresent_wait) {
+          v_device_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+          v_device_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
+
+        //lines GPU trace ranges up with CPU scopes. steady_clock is CLOCK_MONOTONIC on Linux, elsewhere the GPU
+        //ranges are placed relative to their submit instead
+        bool b_calibrated_timestamps = false;
+#ifdef __linux__
+        if (Tracer::Get().IsEnabled() && HasExtension(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) &&
+            vkGetPhysicalDeviceCalibrateableTimeDomainsEXT != nullptr) {
+          uint32_t un_time_domain_count = 0;
+          b_qualify_vk(
+              vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(m_vkphysical_device, &un_time_domain_count, nullptr));
+
+          std::vector<VkTimeDomainEXT> v_time_domains(un_time_domain_count);
+          b_qualify_vk(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(m_vkphysical_device, &un_time_domain_count,
+                                                                      v_time_domains.data()));
+
+          b_calibrated_timestamps =
+              std::find(v_time_domains.begin(), v_time_domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) !=
+                  v_time_domains.end() &&
+              std::find(v_time_domains.begin(), v_time_domains.end(), VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) !=
+                  v_time_domains.end();
+        }
+#endif
+        if (b_calibrated_timestamps) {
+          v_device_extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+        }
+
+        //synchronization2 gives the render graph's barriers and the frame's submit 64-bit stage and access masks,
+        //dynamic rendering replaces the render pass and framebuffers. both are core in Vulkan 1.3, older devices may
+        //still expose them as VK_KHR_synchronization2 and VK_KHR_dynamic_rendering
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
+        bool b_vulkan13 = physical_device_properties.apiVersion >= VK_API_VERSION_1_3;
+
+        VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+            .pNext = nullptr,
+            .dynamicRendering = VK_FALSE,
+        };
+        VkPhysicalDeviceSynchronization2Features synchronization2_features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+            .pNext = &dynamic_rendering_features,
+            .synchronization2 = VK_FALSE,
         };
+        bool b_synchronization2_extension = !b_vulkan13 && HasExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        bool b_dynamic_rendering_extension = !b_vulkan13 && HasExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        if (b_vulkan13 || b_synchronization2_extension || b_dynamic_rendering_extension) {
+          //the core and extension feature structs are the same types, querying them works on either path
+          VkPhysicalDeviceFeatures2 features2 = {
+              .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+              .pNext = &synchronization2_features,
+          };
+          vkGetPhysicalDeviceFeatures2(m_vkphysical_device, &features2);
+
+          m_bsynchronization2 = synchronization2_features.synchronization2 &&
+                                (b_vulkan13 || b_synchronization2_extension);
+          m_bdynamic_rendering = dynamic_rendering_features.dynamicRendering &&
+                                 (b_vulkan13 || b_dynamic_rendering_extension) && !m_config.b_legacy_rendering;
+        }
+
+        if (m_bsynchronization2 && !b_vulkan13) {
+          v_device_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        }
+        if (m_bdynamic_rendering && !b_vulkan13) {
+          v_device_extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        }
+
+        //the cull pass writes one command per surviving instance, identified by firstInstance, and the draw reads
+        //how many there are from a buffer. all three features are optional in Vulkan 1.2
+        if (m_config.b_gpu_culling) {
+          VkPhysicalDeviceVulkan12Features supported_vulkan12_features = {
+              .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+              .pNext = nullptr,
+          };
+          VkPhysicalDeviceFeatures2 features2 = {
+              .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+              .pNext = &supported_vulkan12_features,
+          };
+          vkGetPhysicalDeviceFeatures2(m_vkphysical_device, &features2);
+
+          m_bgpu_culling = supported_vulkan12_features.drawIndirectCount && features2.features.multiDrawIndirect &&
+                           features2.features.drawIndirectFirstInstance;
+          if (!m_bgpu_culling) {
+            std::cout << "[Program] GPU culling needs drawIndirectCount, multiDrawIndirect and "
+                         "drawIndirectFirstInstance, culling on the CPU instead"
+                      << std::endl;
+          }
+        }
+        m_bcpu_culling = (m_config.b_cpu_culling || m_config.b_gpu_culling) && !m_bgpu_culling;
+
+        void* p_feature_chain = m_bpresent_wait ? &present_id_features : nullptr;
+        if (m_bsynchronization2) {
+          synchronization2_features.pNext = p_feature_chain;
+          p_feature_chain = &synchronization2_features;
+        }
+        if (m_bdynamic_rendering) {
+          dynamic_rendering_features.pNext = p_feature_chain;
+          p_feature_chain = &dynamic_rendering_features;
+        }
 
         VkPhysicalDeviceFeatures deviceFeatures{};
+        deviceFeatures.multiDrawIndirect = m_bgpu_culling;
+        deviceFeatures.drawIndirectFirstInstance = m_bgpu_culling;
+        VkPhysicalDeviceVulkan12Features vulkan12_features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+            .pNext = p_feature_chain,
+            .drawIndirectCount = m_bgpu_culling,
+            .timelineSemaphore = VK_TRUE,
+        };
         VkDeviceCreateInfo device_create_info = {
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-            .pNext = nullptr,
+            .pNext = &vulkan12_features,
             .flags = 0,
             .queueCreateInfoCount = (uint32_t)v_queue_create_infos.size(),
             .pQueueCreateInfos = v_queue_create_infos.data(),
@@ -239,222 +862,220 @@ class Program {
         };
         b_qualify_vk(vkCreateDevice(m_vkphysical_device, &device_create_info, nullptr, &m_vkdevice));
 
+        //from here on every device-level call goes through the table instead of the loader trampolines
+        if (!LoadDeviceDispatch(m_vkdevice)) {
+          std::cerr << "Failed to load device functions!" << std::endl;
+          return false;
+        }
+
         vkGetDeviceQueue(m_vkdevice, queue_family_indices.opt_graphics_family.value(), 0, &m_vkgraphics_queue);
         vkGetDeviceQueue(m_vkdevice, queue_family_indices.opt_present_family.value(), 0, &m_vkpresent_queue);
-      }
-
-      {  //swapchain creation
-        struct SwapchainSupportDetails {
-          VkSurfaceCapabilitiesKHR v_capabilities;
-          std::vector<VkSurfaceFormatKHR> v_formats;
-          std::vector<VkPresentModeKHR> v_present_modes;
-        };
-
-        SwapchainSupportDetails swapchain_support{};
-        b_qualify_vk(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_vkphysical_device, m_vksurface,
-                                                               &swapchain_support.v_capabilities));
+        vkGetDeviceQueue(m_vkdevice, queue_family_indices.opt_transfer_family.value(), 0, &m_vktransfer_queue);
 
-        uint32_t un_format_count;
-        b_qualify_vk(vkGetPhysicalDeviceSurfaceFormatsKHR(m_vkphysical_device, m_vksurface, &un_format_count, nullptr));
+        m_bpresent_wait = m_bpresent_wait && vkWaitForPresentKHR != nullptr;
+        m_bcalibrated_timestamps = b_calibrated_timestamps && vkGetCalibratedTimestampsEXT != nullptr;
+        m_bsynchronization2 = m_bsynchronization2 && vkCmdPipelineBarrier2 != nullptr && vkQueueSubmit2 != nullptr;
+        m_bdynamic_rendering = m_bdynamic_rendering && vkCmdBeginRendering != nullptr && vkCmdEndRendering != nullptr;
 
-        if (un_format_count != 0) {
-          swapchain_support.v_formats.resize(un_format_count);
-          b_qualify_vk(vkGetPhysicalDeviceSurfaceFormatsKHR(m_vkphysical_device, m_vksurface, &un_format_count,
-                                                            swapchain_support.v_formats.data()));
-        }
-
-        uint32_t un_present_mode_count;
-        b_qualify_vk(vkGetPhysicalDeviceSurfacePresentModesKHR(m_vkphysical_device, m_vksurface, &un_present_mode_count,
-                                                               nullptr));
+        std::cout << "[Program] " << (m_bdynamic_rendering ? "Dynamic rendering" : "Render pass and framebuffers")
+                  << ", " << (m_bsynchronization2 ? "synchronization2" : "legacy synchronization") << std::endl;
 
-        if (un_present_mode_count != 0) {
-          swapchain_support.v_present_modes.resize(un_present_mode_count);
-          b_qualify_vk(vkGetPhysicalDeviceSurfacePresentModesKHR(
-              m_vkphysical_device, m_vksurface, &un_present_mode_count, swapchain_support.v_present_modes.data()));
-        }
+        m_untimestamp_valid_bits =
+            v_queue_family_properties[queue_family_indices.opt_graphics_family.value()].timestampValidBits;
+      }
 
-        //choose format
-        m_swapchain_format = swapchain_support.v_formats[0];
-        for (const auto& available_surface_format : swapchain_support.v_formats) {
-          if (available_surface_format.format == VK_FORMAT_B8G8R8A8_SRGB &&
-              available_surface_format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            m_swapchain_format = available_surface_format;
-            break;
-          }
+      {  //device memory arena
+        if (!m_memory_arena.Init(m_vkphysical_device, m_vkdevice, *this)) {
+          std::cerr << "Failed to initialise device memory arena!" << std::endl;
+          return false;
         }
+      }
 
-        //choose present mode
-        VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
-        for (const auto& available_present_mode : swapchain_support.v_present_modes) {
-          if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            present_mode = available_present_mode;
-          }
+      {  //transfer uploader
+        if (!m_transfer_uploader.Init(m_vkdevice, *this, m_memory_arena, m_vktransfer_queue,
+                                      queue_family_indices.opt_transfer_family.value(),
+                                      queue_family_indices.opt_graphics_family.value())) {
+          std::cerr << "Failed to initialise transfer uploader!" << std::endl;
+          return false;
         }
 
-        {  //set swapchain extent
-          if (swapchain_support.v_capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
-            m_swapchain_extent = swapchain_support.v_capabilities.currentExtent;
-          } else {
-            int n_width, n_height;
-            glfwGetFramebufferSize(m_glfw_window, &n_width, &n_height);
-
-            m_swapchain_extent = {(uint32_t)n_width, (uint32_t)n_height};
+        std::cout << "[Program] Uploading on "
+                  << (m_transfer_uploader.IsDedicatedQueue() ? "a dedicated transfer queue" : "the graphics queue")
+                  << std::endl;
+      }
 
-            m_swapchain_extent.width =
-                std::clamp(m_swapchain_extent.width, swapchain_support.v_capabilities.minImageExtent.width,
-                           swapchain_support.v_capabilities.maxImageExtent.width);
-            m_swapchain_extent.height =
-                std::clamp(m_swapchain_extent.height, swapchain_support.v_capabilities.minImageExtent.height,
-                           swapchain_support.v_capabilities.maxImageExtent.height);
-          }
+      if (!m_config.b_headless) {  //swapchain creation
+        if (!CreateSwapchain(VK_NULL_HANDLE)) {
+          return false;
         }
+      } else {  //headless render targets
+        m_swapchain_format = {
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
+        };
+        m_swapchain_extent = {WIDTH, HEIGHT};
 
-        //set image count
-        uint32_t un_image_count = swapchain_support.v_capabilities.minImageCount + 1;
-        if (swapchain_support.v_capabilities.maxImageCount > 0 &&
-            un_image_count > swapchain_support.v_capabilities.maxImageCount) {
-          un_image_count = swapchain_support.v_capabilities.maxImageCount;
-        }
+        //one target per frame in flight, so a frame never renders over an image the GPU is still writing
+        m_swapchain_images.resize(m_config.un_frames_in_flight);
+        mv_headless_image_allocations.resize(m_config.un_frames_in_flight);
 
-        VkSwapchainCreateInfoKHR swapchain_create_info = {
-            .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-            .pNext = nullptr,
-            .flags = 0,
-            .surface = m_vksurface,
-            .minImageCount = un_image_count,
-            .imageFormat = m_swapchain_format.format,
-            .imageColorSpace = m_swapchain_format.colorSpace,
-            .imageExtent = m_swapchain_extent,
-            .imageArrayLayers = 1,
-            .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
-            .queueFamilyIndexCount = 0,
-            .pQueueFamilyIndices = nullptr,
-            .preTransform = swapchain_support.v_capabilities.currentTransform,
-            .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-            .presentMode = present_mode,
-            .clipped = VK_TRUE,
-            .oldSwapchain = VK_NULL_HANDLE,
-        };
-
-        b_qualify_vk(vkCreateSwapchainKHR(m_vkdevice, &swapchain_create_info, nullptr, &m_vkswapchain));
-
-        b_qualify_vk(vkGetSwapchainImagesKHR(m_vkdevice, m_vkswapchain, &un_image_count, nullptr));
-        m_swapchain_images.resize(un_image_count);
-
-        b_qualify_vk(vkGetSwapchainImagesKHR(m_vkdevice, m_vkswapchain, &un_image_count, m_swapchain_images.data()));
-
-        m_swapchain_image_views.resize(m_swapchain_images.size());
         for (size_t i = 0; i < m_swapchain_images.size(); i++) {
-          VkImageViewCreateInfo image_view_create_info = {
-              .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+          VkImageCreateInfo image_create_info = {
+              .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
               .pNext = nullptr,
               .flags = 0,
-              .image = m_swapchain_images[i],
-              .viewType = VK_IMAGE_VIEW_TYPE_2D,
+              .imageType = VK_IMAGE_TYPE_2D,
               .format = m_swapchain_format.format,
-              .components =
-                  {
-                      .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-                      .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-                      .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                      .a = VK_COMPONENT_SWIZZLE_IDENTITY,
-                  },
-              .subresourceRange =
-                  {
-                      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                      .baseMipLevel = 0,
-                      .levelCount = 1,
-                      .baseArrayLayer = 0,
-                      .layerCount = 1,
-                  },
+              .extent = {m_swapchain_extent.width, m_swapchain_extent.height, 1},
+              .mipLevels = 1,
+              .arrayLayers = 1,
+              .samples = VK_SAMPLE_COUNT_1_BIT,
+              .tiling = VK_IMAGE_TILING_OPTIMAL,
+              .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+              .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+              .queueFamilyIndexCount = 0,
+              .pQueueFamilyIndices = nullptr,
+              .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
           };
-          b_qualify_vk(vkCreateImageView(m_vkdevice, &image_view_create_info, nullptr, &m_swapchain_image_views[i]));
+          if (!m_memory_arena.CreateImage(image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                                          m_swapchain_images[i], mv_headless_image_allocations[i])) {
+            std::cerr << "Failed to create headless render target!" << std::endl;
+            return false;
+          }
         }
       }
 
+      if (!CreateImageViews()) {
+        return false;
+      }
+
       {  //render pass
-        VkAttachmentDescription color_attachment_description = {
-            .flags = 0,
-            .format = m_swapchain_format.format,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-        };
+        //the highest sample count the device supports that does not exceed the requested one
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
+
+        m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+        for (VkSampleCountFlagBits sample_count :
+             {VK_SAMPLE_COUNT_2_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_16_BIT}) {
+          if (sample_count <= m_config.un_msaa_samples &&
+              (physical_device_properties.limits.framebufferColorSampleCounts & sample_count)) {
+            m_msaa_samples = sample_count;
+          }
+        }
+        if (m_msaa_samples != m_config.un_msaa_samples) {
+          std::cout << "[Program] " << m_config.un_msaa_samples << "x MSAA is not supported, using "
+                    << static_cast<uint32_t>(m_msaa_samples) << "x" << std::endl;
+        }
+        //dynamic rendering describes the attachments while recording instead
+        if (!m_bdynamic_rendering && !CreateRenderPass()) {
+          return false;
+        }
+      }
+
+      {  //render graph
+        m_render_graph.Init(m_vkdevice, *this, m_memory_arena, m_bsynchronization2);
+
+        RenderGraph::Transients no_previous_transients{};
+        if (!BuildRenderGraph(no_previous_transients)) {
+          std::cerr << "Failed to compile the render graph!" << std::endl;
+          return false;
+        }
+      }
 
-        VkAttachmentReference color_attachment_reference = {
-            .attachment = 0,
-            .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      {  //descriptor set layout
+        //the cull pass shares the set and the pipeline layout, it reads the instances and uniforms too and writes
+        //the draws through the last two bindings
+        VkShaderStageFlags shared_stages =
+            VK_SHADER_STAGE_VERTEX_BIT | (m_bgpu_culling ? VK_SHADER_STAGE_COMPUTE_BIT : VkShaderStageFlags{0});
+        VkDescriptorSetLayoutBinding bindings[] = {
+            {
+                .binding = 0,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = shared_stages,
+                .pImmutableSamplers = nullptr,
+            },
+            {
+                //the offset of the current frame's region is supplied when the set is bound
+                .binding = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .descriptorCount = 1,
+                .stageFlags = shared_stages,
+                .pImmutableSamplers = nullptr,
+            },
+            {
+                //GPU culling only, the draw commands
+                .binding = 2,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .pImmutableSamplers = nullptr,
+            },
+            {
+                //GPU culling only, the draw count
+                .binding = 3,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .pImmutableSamplers = nullptr,
+            },
         };
-        VkSubpassDescription subpass_description = {
-            .flags = 0,
-            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-            .inputAttachmentCount = 0,
-            .pInputAttachments = nullptr,
-            .colorAttachmentCount = 1,
-            .pColorAttachments = &color_attachment_reference,
-            .pResolveAttachments = nullptr,
-            .pDepthStencilAttachment = nullptr,
-            .preserveAttachmentCount = 0,
-            .pPreserveAttachments = nullptr,
-        };
-
-        VkSubpassDependency subpass_dependency = {
-            .srcSubpass = VK_SUBPASS_EXTERNAL,
-            .dstSubpass = 0,
-            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-            .dependencyFlags = 0,
-        };
-
-        VkRenderPassCreateInfo render_pass_create_info = {
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+
+        VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .attachmentCount = 1,
-            .pAttachments = &color_attachment_description,
-            .subpassCount = 1,
-            .pSubpasses = &subpass_description,
-            .dependencyCount = 1,
-            .pDependencies = &subpass_dependency,
+            .bindingCount = m_bgpu_culling ? 4u : 2u,
+            .pBindings = bindings,
         };
-        b_qualify_vk(vkCreateRenderPass(m_vkdevice, &render_pass_create_info, nullptr, &m_renderpass));
+        b_qualify_vk(vkCreateDescriptorSetLayout(m_vkdevice, &descriptor_set_layout_create_info, nullptr,
+                                                 &m_vkdescriptor_set_layout));
       }
 
-      {  // create pipeline
-        auto ReadFile = [&](const std::string& filename) -> std::vector<char> {
-          std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-          if (!file.is_open()) {
-            return {};
+      {  //pipeline cache
+        std::vector<char> v_cache_data{};
+        if (!m_config.s_pipeline_cache_path.empty()) {
+          std::ifstream file(m_config.s_pipeline_cache_path, std::ios::ate | std::ios::binary);
+          if (file.is_open()) {
+            v_cache_data.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(v_cache_data.data(), v_cache_data.size());
           }
+        }
 
-          size_t n_file_size = static_cast<size_t>(file.tellg());
-          std::vector<char> buffer(n_file_size);
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
 
-          file.seekg(0);
-          file.read(buffer.data(), n_file_size);
+        if (!v_cache_data.empty() && !IsPipelineCacheCompatible(v_cache_data, physical_device_properties)) {
+          std::cout << "[Program] Discarding pipeline cache " << m_config.s_pipeline_cache_path
+                    << ", it was created by a different device or driver" << std::endl;
+          v_cache_data.clear();
+        }
 
-          return buffer;
+        VkPipelineCacheCreateInfo pipeline_cache_create_info = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .initialDataSize = v_cache_data.size(),
+            .pInitialData = v_cache_data.empty() ? nullptr : v_cache_data.data(),
         };
+        b_qualify_vk(vkCreatePipelineCache(m_vkdevice, &pipeline_cache_create_info, nullptr, &m_vkpipeline_cache));
+      }
 
-        auto vert_shader = ReadFile("shaders/hello.vert.spv");
-        auto frag_shader = ReadFile("shaders/hello.frag.spv");
+      {  // create pipeline
+        auto CreateShaderModule = [this](VkDevice device, const char* p_name, VkShaderModule& out_vk_shader_module) {
+          const EmbeddedShader* p_shader = FindEmbeddedShader(p_name);
+          if (p_shader == nullptr) {
+            std::cout << "[Program] Shader " << p_name << " is not embedded in the binary" << std::endl;
+            return false;
+          }
 
-        auto CreateShaderModule = [](VkDevice device, size_t size_buffer, const std::vector<char>& v_buffer,
-                                     VkShaderModule& out_vk_shader_module) {
           VkShaderModuleCreateInfo vk_shader_module_create_info = {
               .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
               .pNext = nullptr,
               .flags = 0,
-              .codeSize = size_buffer,
-              .pCode = reinterpret_cast<const uint32_t*>(v_buffer.data()),
+              .codeSize = p_shader->n_size,
+              .pCode = p_shader->p_code,
           };
 
           b_qualify_vk(vkCreateShaderModule(device, &vk_shader_module_create_info, nullptr, &out_vk_shader_module));
@@ -462,206 +1083,93 @@ class Program {
           return true;
         };
 
-        if (!CreateShaderModule(m_vkdevice, vert_shader.size(), vert_shader, m_vert_shader)) {
+        if (!CreateShaderModule(m_vkdevice, "hello.vert", m_vert_shader)) {
           std::cout << "Failed to create vertex shader module" << std::endl;
           return false;
         }
 
-        if (!CreateShaderModule(m_vkdevice, frag_shader.size(), frag_shader, m_frag_shader)) {
+        if (!CreateShaderModule(m_vkdevice, "hello.frag", m_frag_shader)) {
           std::cout << "Failed to create fragment shader module" << std::endl;
           return false;
         }
 
-        VkPipelineShaderStageCreateInfo vert_shader_stage_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = m_vert_shader,
-            .pName = "main",
-            .pSpecializationInfo = nullptr,
-        };
-        VkPipelineShaderStageCreateInfo frag_shader_stage_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = m_frag_shader,
-            .pName = "main",
-            .pSpecializationInfo = nullptr,
-        };
-
-        VkPipelineShaderStageCreateInfo shader_stage_create_infos[] = {vert_shader_stage_create_info,
-                                                                       frag_shader_stage_create_info};
+        //the mesh pipeline itself is built once the file is mapped and its streams are known
+        bool b_mesh = !m_config.s_mesh_path.empty();
+        if (b_mesh && !CreateShaderModule(m_vkdevice, "mesh.vert", m_vkmesh_vert_shader)) {
+          std::cout << "Failed to create mesh vertex shader module" << std::endl;
+          return false;
+        }
 
-        VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .vertexBindingDescriptionCount = 0,
-            .pVertexBindingDescriptions = nullptr,
-            .vertexAttributeDescriptionCount = 0,
-            .pVertexAttributeDescriptions = nullptr,
+        VkPushConstantRange mesh_push_constant_range = {
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(MeshPushConstants),
         };
 
-        VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-            .primitiveRestartEnable = VK_FALSE,
+            .setLayoutCount = 1,
+            .pSetLayouts = &m_vkdescriptor_set_layout,
+            .pushConstantRangeCount = b_mesh ? 1u : 0u,
+            .pPushConstantRanges = b_mesh ? &mesh_push_constant_range : nullptr,
         };
 
-        VkViewport viewport = {
-            .x = 0.f,
-            .y = 0.f,
-            .width = (float)m_swapchain_extent.width,
-            .height = (float)m_swapchain_extent.height,
-            .minDepth = 0.f,
-            .maxDepth = 1.f,
-        };
+        b_qualify_vk(vkCreatePipelineLayout(m_vkdevice, &pipeline_layout_create_info, nullptr, &m_pipeline_layout));
 
-        VkRect2D scissor = {
-            .offset = {0, 0},
-            .extent = m_swapchain_extent,
-        };
+        //the swapchain keeps this format across recreation, so pipeline builds never read m_swapchain_format
+        m_color_attachment_format = m_swapchain_format.format;
 
-        std::vector<VkDynamicState> v_dynamic_states = {
-            VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_SCISSOR,
-        };
+        //the default variant is built up front, it is also what every other variant falls back to until it is ready
+        if (!BuildGraphicsPipeline({}, false, m_pipeline)) {
+          std::cerr << "Failed to create graphics pipeline!" << std::endl;
+          return false;
+        }
 
-        VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .dynamicStateCount = static_cast<uint32_t>(v_dynamic_states.size()),
-            .pDynamicStates = v_dynamic_states.data(),
-        };
+        m_pipeline_manager.Init(m_vkdevice, *this, std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u),
+                                m_pipeline, [this](const PipelineManager::VariantKey& key, VkPipeline& out_pipeline) {
+                                  return BuildGraphicsPipeline(key, false, out_pipeline);
+                                });
+        m_draw_queue.Init(*this);
 
-        VkPipelineViewportStateCreateInfo viewport_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .viewportCount = 1,
-            .pViewports = &viewport,
-            .scissorCount = 1,
-            .pScissors = &scissor,
-        };
+        if (m_config.un_color_mode != 0) {
+          m_unpipeline_variant = m_pipeline_manager.Request({m_config.un_color_mode});
+        }
 
-        VkPipelineRasterizationStateCreateInfo rasterization_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .depthClampEnable = VK_FALSE,
-            .rasterizerDiscardEnable = VK_FALSE,
-            .polygonMode = VK_POLYGON_MODE_FILL,
-            .cullMode = VK_POLYGON_MODE_FILL,
-            .frontFace = VK_FRONT_FACE_CLOCKWISE,
-            .depthBiasEnable = VK_FALSE,
-            .depthBiasConstantFactor = 0.f,
-            .depthBiasClamp = 0.f,
-            .depthBiasSlopeFactor = 0.f,
-            .lineWidth = 1.f,
-        };
-
-        VkPipelineMultisampleStateCreateInfo multisample_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-            .sampleShadingEnable = VK_FALSE,
-            .minSampleShading = 1.f,
-            .pSampleMask = nullptr,
-            .alphaToCoverageEnable = VK_FALSE,
-            .alphaToOneEnable = VK_FALSE,
-        };
-
-        VkPipelineColorBlendAttachmentState color_blend_attachment_state = {
-            .blendEnable = VK_FALSE,
-            .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-            .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-            .colorBlendOp = VK_BLEND_OP_ADD,
-            .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-            .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-            .alphaBlendOp = VK_BLEND_OP_ADD,
-            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
-                              VK_COLOR_COMPONENT_A_BIT,
-        };
-        VkPipelineColorBlendStateCreateInfo color_blend_state_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .logicOpEnable = VK_FALSE,
-            .logicOp = VK_LOGIC_OP_COPY,
-            .attachmentCount = 1,
-            .pAttachments = &color_blend_attachment_state,
-            .blendConstants = {0.f, 0.f, 0.f, 0.f},
-        };
-
-        VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .setLayoutCount = 0,
-            .pSetLayouts = nullptr,
-            .pushConstantRangeCount = 0,
-            .pPushConstantRanges = nullptr,
-        };
-
-        b_qualify_vk(vkCreatePipelineLayout(m_vkdevice, &pipeline_layout_create_info, nullptr, &m_pipeline_layout));
-
-        VkGraphicsPipelineCreateInfo pipeline_create_info = {
-            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .stageCount = 2,
-            .pStages = shader_stage_create_infos,
-            .pVertexInputState = &vertex_input_state_create_info,
-            .pInputAssemblyState = &input_assembly_state_create_info,
-            .pTessellationState = nullptr,
-            .pViewportState = &viewport_state_create_info,
-            .pRasterizationState = &rasterization_state_create_info,
-            .pMultisampleState = &multisample_state_create_info,
-            .pDepthStencilState = nullptr,
-            .pColorBlendState = &color_blend_state_create_info,
-            .pDynamicState = &dynamic_state_create_info,
-            .layout = m_pipeline_layout,
-            .renderPass = m_renderpass,
-            .subpass = 0,
-            .basePipelineHandle = VK_NULL_HANDLE,
-            .basePipelineIndex = -1,
-        };
-
-        b_qualify_vk(
-            vkCreateGraphicsPipelines(m_vkdevice, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &m_pipeline));
-      }
-
-      {  //framebuffers
-        m_swapchain_framebuffers.resize(m_swapchain_image_views.size());
-
-        for (size_t i = 0; i < m_swapchain_image_views.size(); i++) {
-          VkImageView attachments[] = {
-              m_swapchain_image_views[i],
-          };
+        if (m_bgpu_culling) {
+          if (!CreateShaderModule(m_vkdevice, "cull.comp", m_vkcull_shader)) {
+            std::cout << "Failed to create cull shader module" << std::endl;
+            return false;
+          }
 
-          VkFramebufferCreateInfo framebuffer_create_info = {
-              .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+          VkComputePipelineCreateInfo compute_pipeline_create_info = {
+              .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
               .pNext = nullptr,
               .flags = 0,
-              .renderPass = m_renderpass,
-              .attachmentCount = 1,
-              .pAttachments = attachments,
-              .width = m_swapchain_extent.width,
-              .height = m_swapchain_extent.height,
-              .layers = 1,
+              .stage =
+                  {
+                      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                      .pNext = nullptr,
+                      .flags = 0,
+                      .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                      .module = m_vkcull_shader,
+                      .pName = "main",
+                      .pSpecializationInfo = nullptr,
+                  },
+              .layout = m_pipeline_layout,
+              .basePipelineHandle = VK_NULL_HANDLE,
+              .basePipelineIndex = -1,
           };
-
-          b_qualify_vk(
-              vkCreateFramebuffer(m_vkdevice, &framebuffer_create_info, nullptr, &m_swapchain_framebuffers[i]));
+          b_qualify_vk(vkCreateComputePipelines(m_vkdevice, m_vkpipeline_cache, 1, &compute_pipeline_create_info,
+                                                nullptr, &m_vkcull_pipeline));
         }
       }
 
+      if (!CreateFramebuffers()) {
+        return false;
+      }
+
       {  // command pool
         VkCommandPoolCreateInfo cmd_pool_create_info = {
             .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
@@ -673,7 +1181,7 @@ class Program {
       }
 
       {  // create command buffers
-        mv_vkcommand_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+        mv_vkcommand_buffers.resize(m_config.un_frames_in_flight);
 
         VkCommandBufferAllocateInfo cmd_buffer_allocate_info = {
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -685,51 +1193,543 @@ class Program {
         b_qualify_vk(vkAllocateCommandBuffers(m_vkdevice, &cmd_buffer_allocate_info, mv_vkcommand_buffers.data()));
       }
 
+      {  //instance buffer
+        m_uninstance_count =
+            m_config.un_instance_count > 0 ? m_config.un_instance_count : std::max(m_config.un_draw_count, 1u);
+        m_unframe_instance_count = m_uninstance_count;
+
+        std::vector<InstanceData> v_instances = BuildInstanceGrid(m_uninstance_count, m_config.f_scene_scale);
+
+        if (m_bcpu_culling) {
+          //every frame writes its survivors into its own region of a mapped ring, so nothing is uploaded. regions
+          //start on multiples of sizeof(InstanceData), the draws reach them through firstInstance
+          VkPhysicalDeviceProperties physical_device_properties;
+          vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
+
+          m_scene_core.Init(v_instances);
+          if (!m_instance_ring.Init(m_memory_arena, sizeof(InstanceData) * m_uninstance_count,
+                                    m_config.un_frames_in_flight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    physical_device_properties.limits.minStorageBufferOffsetAlignment)) {
+            std::cerr << "Failed to create instance ring!" << std::endl;
+            return false;
+          }
+          m_cull_thread_pool = std::make_unique<ThreadPool>(std::max(std::thread::hardware_concurrency(), 1u));
+
+          std::cout << "[Program] Culling on the CPU with the " << SceneCore::GetKernelName(m_scene_core.GetKernel())
+                    << " kernel on " << m_cull_thread_pool->GetThreadCount() << " threads" << std::endl;
+        } else {
+          VkDeviceSize instance_buffer_size = sizeof(InstanceData) * v_instances.size();
+          if (!CreateBuffer(instance_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkinstance_buffer, m_instance_allocation)) {
+            std::cerr << "Failed to create instance buffer!" << std::endl;
+            return false;
+          }
+
+          if (m_bgpu_culling) {
+            //the cull pass draws the triangle indexed, uploaded first so the instance upload's value covers it too
+            const uint16_t un_triangle_indices[] = {0, 1, 2};
+            uint64_t un_index_upload_value = 0;
+            if (!CreateBuffer(sizeof(un_triangle_indices),
+                              VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkindex_buffer, m_index_allocation) ||
+                !m_transfer_uploader.Upload(m_vkindex_buffer, 0, un_triangle_indices, sizeof(un_triangle_indices),
+                                            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+                                            un_index_upload_value)) {
+              std::cerr << "Failed to create index buffer!" << std::endl;
+              return false;
+            }
+
+            //one command per instance in the worst case, both written by the cull pass and read by the draw
+            if (!CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * m_uninstance_count,
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkdraw_command_buffer,
+                              m_draw_command_allocation) ||
+                !CreateBuffer(sizeof(uint32_t),
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkdraw_count_buffer, m_draw_count_allocation)) {
+              std::cerr << "Failed to create indirect draw buffers!" << std::endl;
+              return false;
+            }
+          }
+
+          //frames skip the draws until the upload has landed instead of waiting for it
+          VkPipelineStageFlags instance_stages =
+              VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | (m_bgpu_culling ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0);
+          if (!m_transfer_uploader.Upload(m_vkinstance_buffer, 0, v_instances.data(), instance_buffer_size,
+                                          instance_stages, VK_ACCESS_SHADER_READ_BIT, m_uninstance_upload_value)) {
+            std::cerr << "Failed to upload instance buffer!" << std::endl;
+            return false;
+          }
+        }
+      }
+
+      if (!m_config.s_mesh_path.empty()) {  //mesh, copied from the file mapping straight into the staging ring
+        TRACE_SCOPE("LoadMesh");
+        auto load_start = std::chrono::steady_clock::now();
+
+        MeshFile mesh_file;
+        if (!mesh_file.Init(m_config.s_mesh_path)) {
+          return false;
+        }
+        const MeshFileHeader& header = mesh_file.GetHeader();
+
+        //the streams share one buffer, each one starting 16-byte aligned after the previous one
+        VkDeviceSize vertex_buffer_size = 0;
+        for (uint32_t i = 0; i < header.un_stream_count; i++) {
+          mv_mesh_stream_offsets.push_back(vertex_buffer_size);
+          vertex_buffer_size += (mesh_file.GetStream(i).data.un_size + 15) / 16 * 16;
+        }
+
+        //one binding per stream shaders/mesh.vert reads, the attribute's location is its MeshAttribute. every
+        //MeshStreamFormat is a format vertex buffers must support, so no format query is needed
+        uint32_t un_attribute_mask = 0;
+        for (uint32_t i = 0; i < header.un_stream_count; i++) {
+          const MeshStream& stream = mesh_file.GetStream(i);
+          uint32_t un_location = static_cast<uint32_t>(stream.attribute);
+          if (un_location > static_cast<uint32_t>(MeshAttribute::kNormal) || (un_attribute_mask >> un_location & 1)) {
+            continue;
+          }
+          un_attribute_mask |= 1u << un_location;
+
+          uint32_t un_binding = static_cast<uint32_t>(mv_mesh_vertex_bindings.size());
+          mv_mesh_vertex_bindings.push_back({
+              .binding = un_binding,
+              .stride = stream.un_stride,
+              .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+          });
+          mv_mesh_vertex_attributes.push_back({
+              .location = un_location,
+              .binding = un_binding,
+              .format = static_cast<VkFormat>(stream.format),
+              .offset = 0,
+          });
+          m_mesh_geometry.vertex_offsets[un_binding] = mv_mesh_stream_offsets[i];
+        }
+        if (un_attribute_mask != 0b111) {
+          std::cerr << "[Program] " << m_config.s_mesh_path << " needs position, color and normal streams"
+                    << std::endl;
+          return false;
+        }
+
+        if (!CreateBuffer(std::max(vertex_buffer_size, VkDeviceSize{16}),
+                          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkmesh_vertex_buffer, m_mesh_vertex_allocation) ||
+            !CreateBuffer(header.indices.un_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkmesh_index_buffer, m_mesh_index_allocation)) {
+          std::cerr << "Failed to create mesh buffers!" << std::endl;
+          return false;
+        }
+        m_mesh_geometry.un_binding_count = static_cast<uint32_t>(mv_mesh_vertex_bindings.size());
+        m_mesh_geometry.vkvertex_buffers.fill(m_vkmesh_vertex_buffer);
+        m_mesh_geometry.vkindex_buffer = m_vkmesh_index_buffer;
+        m_mesh_geometry.index_type = mesh_file.GetIndexType();
+
+        //the uploader copies chunk by chunk from the mapping into staging memory, the page faults of each chunk are
+        //the only reads of the file
+        for (uint32_t i = 0; i < header.un_stream_count; i++) {
+          const MeshStream& stream = mesh_file.GetStream(i);
+          if (!m_transfer_uploader.Upload(m_vkmesh_vertex_buffer, mv_mesh_stream_offsets[i],
+                                          mesh_file.GetSectionData(stream.data), stream.data.un_size,
+                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                                          m_unmesh_upload_value)) {
+            std::cerr << "Failed to upload mesh vertices!" << std::endl;
+            return false;
+          }
+        }
+        if (!m_transfer_uploader.Upload(m_vkmesh_index_buffer, 0, mesh_file.GetSectionData(header.indices),
+                                        header.indices.un_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                        VK_ACCESS_INDEX_READ_BIT, m_unmesh_upload_value)) {
+          std::cerr << "Failed to upload mesh indices!" << std::endl;
+          return false;
+        }
+
+        //lod 0, or the whole index section for a file without lods
+        m_unmesh_index_count = header.un_lod_count > 0 ? mesh_file.GetLod(0).un_index_count : header.un_index_count;
+        m_unmesh_first_index = header.un_lod_count > 0 ? mesh_file.GetLod(0).un_first_index : 0;
+
+        //centered on the bounding box and scaled so its bounding sphere just fits
+        //clamped so a degenerate bounding box (a single point) does not divide by zero
+        float f_radius = std::max(glm::length(glm::vec3(header.f_position_scale[0], header.f_position_scale[1],
+                                                        header.f_position_scale[2])),
+                                  std::numeric_limits<float>::min());
+        m_mesh_push_constants = {
+            .position_scale = glm::vec4(header.f_position_scale[0], header.f_position_scale[1],
+                                        header.f_position_scale[2], 0.f),
+            .position_offset = glm::vec4(header.f_position_offset[0], header.f_position_offset[1],
+                                         header.f_position_offset[2], 0.f),
+            .placement = glm::vec4(-header.f_position_offset[0], -header.f_position_offset[1],
+                                   -header.f_position_offset[2], 1.f / f_radius),
+        };
+
+        if (!BuildGraphicsPipeline({m_config.un_color_mode}, true, m_vkmesh_pipeline)) {
+          std::cerr << "Failed to create mesh pipeline!" << std::endl;
+          return false;
+        }
+
+        m_mesh_load_stats = {
+            .un_vertex_count = header.un_vertex_count,
+            .un_index_count = header.un_index_count,
+            .un_lod_count = header.un_lod_count,
+            .un_meshlet_count = header.un_meshlet_count,
+            .un_bytes = vertex_buffer_size + header.indices.un_size,
+            .f_load_ms = MillisecondsSince(load_start),
+        };
+        std::cout << "[Program] Loaded " << m_config.s_mesh_path << ": " << header.un_vertex_count << " vertices, "
+                  << header.un_index_count << " indices, " << header.un_lod_count << " lods in "
+                  << m_mesh_load_stats.f_load_ms << " ms" << std::endl;
+      }
+
+      {  //per-frame uniform ring
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
+
+        if (!m_frame_ring.Init(m_memory_arena, FRAME_RING_REGION_SIZE, m_config.un_frames_in_flight,
+                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                               physical_device_properties.limits.minUniformBufferOffsetAlignment)) {
+          std::cerr << "Failed to create per-frame uniform ring!" << std::endl;
+          return false;
+        }
+      }
+
+      {  //descriptor set
+        VkDescriptorPoolSize descriptor_pool_sizes[] = {
+            {
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = m_bgpu_culling ? 3u : 1u,
+            },
+            {
+                .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .descriptorCount = 1,
+            },
+        };
+
+        VkDescriptorPoolCreateInfo descriptor_pool_create_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = 1,
+            .poolSizeCount = 2,
+            .pPoolSizes = descriptor_pool_sizes,
+        };
+        b_qualify_vk(vkCreateDescriptorPool(m_vkdevice, &descriptor_pool_create_info, nullptr, &m_vkdescriptor_pool));
+
+        VkDescriptorSetAllocateInfo descriptor_set_allocate_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = m_vkdescriptor_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &m_vkdescriptor_set_layout,
+        };
+        b_qualify_vk(vkAllocateDescriptorSets(m_vkdevice, &descriptor_set_allocate_info, &m_vkdescriptor_set));
+
+        VkDescriptorBufferInfo instance_buffer_info = {
+            .buffer = m_bcpu_culling ? m_instance_ring.GetBuffer() : m_vkinstance_buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        VkDescriptorBufferInfo frame_uniforms_info = {
+            .buffer = m_frame_ring.GetBuffer(),
+            .offset = 0,
+            .range = sizeof(FrameUniforms),
+        };
+
+        VkDescriptorBufferInfo draw_command_buffer_info = {
+            .buffer = m_vkdraw_command_buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        VkDescriptorBufferInfo draw_count_buffer_info = {
+            .buffer = m_vkdraw_count_buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        VkWriteDescriptorSet write_descriptor_sets[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = m_vkdescriptor_set,
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo = nullptr,
+                .pBufferInfo = &instance_buffer_info,
+                .pTexelBufferView = nullptr,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = m_vkdescriptor_set,
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .pImageInfo = nullptr,
+                .pBufferInfo = &frame_uniforms_info,
+                .pTexelBufferView = nullptr,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = m_vkdescriptor_set,
+                .dstBinding = 2,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo = nullptr,
+                .pBufferInfo = &draw_command_buffer_info,
+                .pTexelBufferView = nullptr,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = m_vkdescriptor_set,
+                .dstBinding = 3,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo = nullptr,
+                .pBufferInfo = &draw_count_buffer_info,
+                .pTexelBufferView = nullptr,
+            },
+        };
+        vkUpdateDescriptorSets(m_vkdevice, m_bgpu_culling ? 4 : 2, write_descriptor_sets, 0, nullptr);
+      }
+
+      if (m_config.un_record_threads > 0) {  //per-frame, per-thread command pools for secondary command buffers
+        mvv_vkthread_command_pools.resize(m_config.un_frames_in_flight);
+        mvv_vkthread_command_buffers.resize(m_config.un_frames_in_flight);
+
+        for (size_t i = 0; i < m_config.un_frames_in_flight; i++) {
+          mvv_vkthread_command_pools[i].resize(m_config.un_record_threads);
+          mvv_vkthread_command_buffers[i].resize(m_config.un_record_threads);
+
+          for (uint32_t j = 0; j < m_config.un_record_threads; j++) {
+            //pools are reset wholesale once the slot's previous frame has completed, never per command buffer
+            VkCommandPoolCreateInfo thread_pool_create_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                .queueFamilyIndex = queue_family_indices.opt_graphics_family.value(),
+            };
+            b_qualify_vk(
+                vkCreateCommandPool(m_vkdevice, &thread_pool_create_info, nullptr, &mvv_vkthread_command_pools[i][j]));
+
+            VkCommandBufferAllocateInfo secondary_allocate_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .commandPool = mvv_vkthread_command_pools[i][j],
+                .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                .commandBufferCount = 1,
+            };
+            b_qualify_vk(
+                vkAllocateCommandBuffers(m_vkdevice, &secondary_allocate_info, &mvv_vkthread_command_buffers[i][j]));
+          }
+        }
+
+        m_record_thread_pool = std::make_unique<ThreadPool>(m_config.un_record_threads);
+      }
+
       {  //create sync objects
-        mv_vksemaphores_image_available.resize(m_swapchain_images.size());
-        mv_vksemaphores_render_finished.resize(m_swapchain_images.size());
-        mv_vkfences_in_flight.resize(MAX_FRAMES_IN_FLIGHT);
+        //frame completion is tracked by the scheduler's timeline semaphore alone. headless frames are never
+        //presented, so they need nothing else. acquire semaphores are used per frame slot, present semaphores per
+        //swapchain image
+        if (!m_frame_scheduler.Init(m_vkdevice, *this, m_config.un_frames_in_flight)) {
+          std::cerr << "Failed to initialise frame scheduler!" << std::endl;
+          return false;
+        }
+
+        mv_vksemaphores_image_available.resize(m_config.b_headless ? 0 : m_config.un_frames_in_flight);
+        mv_vksemaphores_render_finished.resize(m_config.b_headless ? 0 : m_swapchain_images.size());
 
         VkSemaphoreCreateInfo semaphore_create_info = {
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
         };
-        VkFenceCreateInfo fence_create_info = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-        };
 
-        for (size_t i = 0; i < m_swapchain_images.size(); i++) {
-          b_qualify_vk(
-              vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &mv_vksemaphores_image_available[i]));
+        for (VkSemaphore& semaphore : mv_vksemaphores_image_available) {
+          b_qualify_vk(vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &semaphore));
+        }
 
-          b_qualify_vk(
-              vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &mv_vksemaphores_render_finished[i]));
+        for (VkSemaphore& semaphore : mv_vksemaphores_render_finished) {
+          b_qualify_vk(vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &semaphore));
+        }
+      }
+
+      if (!m_config.s_output_path.empty()) {  //frame readback
+        uint32_t un_fps = m_config.f_fps_limit > 0.f ? static_cast<uint32_t>(m_config.f_fps_limit + 0.5f) : 60;
+        if (!m_frame_readback.Init(m_vkdevice, *this, m_memory_arena, m_frame_scheduler.GetTimelineSemaphore(),
+                                   m_swapchain_extent, m_config.s_output_path, m_config.output_format, un_fps)) {
+          std::cerr << "Failed to initialise frame readback!" << std::endl;
+          return false;
         }
+        std::cout << "[Program] Streaming frames to " << m_config.s_output_path << std::endl;
+      }
+
+      if (m_config.b_benchmark && m_untimestamp_valid_bits == 0) {
+        std::cout << "[Program] Graphics queue does not support timestamps, GPU time will not be reported"
+                  << std::endl;
+      }
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-          b_qualify_vk(vkCreateFence(m_vkdevice, &fence_create_info, nullptr, &mv_vkfences_in_flight[i]));
+      {  //GPU trace ranges and the benchmark's GPU frame time, debug labels are emitted even when tracing is off
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
+
+        if (!m_gpu_tracer.Init(m_vkdevice, *this, "GPU graphics queue", m_config.un_frames_in_flight,
+                               m_untimestamp_valid_bits, physical_device_properties.limits.timestampPeriod,
+                               vkCmdBeginDebugUtilsLabelEXT, vkCmdEndDebugUtilsLabelEXT, m_bcalibrated_timestamps,
+                               m_config.b_benchmark)) {
+          std::cerr << "Failed to initialise GPU tracer!" << std::endl;
+          return false;
         }
       }
 
+      m_init_time = std::chrono::steady_clock::now();
+
       return true;
     }
   }
 
-  void Tick() {
-    vkWaitForFences(m_vkdevice, 1, &mv_vkfences_in_flight[m_uncurrent_frame], VK_TRUE, UINT64_MAX);
-    vkResetFences(m_vkdevice, 1, &mv_vkfences_in_flight[m_uncurrent_frame]);
+  //records, submits and presents one frame. a frame skipped while the window is minimized or the swapchain is out of
+  //date still counts as success, false means rendering cannot continue
+  bool Tick() {
+    TRACE_SCOPE("Tick");
+
+    auto tick_start = std::chrono::steady_clock::now();
+    m_last_frame_timing = {};
+    if (m_last_tick_start.has_value()) {
+      m_last_frame_timing.f_frame_ms =
+          std::chrono::duration<float, std::milli>(tick_start - m_last_tick_start.value()).count();
+    }
+    m_last_tick_start = tick_start;
+
+    if (m_bswapchain_dirty) {
+      if (!RecreateSwapchain()) {
+        std::cerr << "[Program] Could not recreate the swapchain" << std::endl;
+        return false;
+      }
+      //still dirty while the window is minimized
+      if (m_bswapchain_dirty) {
+        return true;
+      }
+    }
+
+    {
+      TRACE_SCOPE("WaitForFrameSlot");
+      if (!m_frame_scheduler.WaitForFrameSlot()) {
+        return false;
+      }
+    }
+    m_last_frame_timing.f_wait_ms = MillisecondsSince(tick_start);
+    m_uncurrent_frame = m_frame_scheduler.GetFrameSlot();
+
+    //the previous frame in this slot has completed, so its timestamps are available
+    m_gpu_tracer.Collect(m_uncurrent_frame);
+    m_last_frame_timing.opt_gpu_ms = m_gpu_tracer.GetFrameMs();
+
+    //retired swapchains and transients of frames the GPU has finished since the last Tick
+    m_frame_scheduler.GetCompletedValue();
+    m_frame_scheduler.CollectGarbage();
+
+    //variants that finished compiling are swapped in here, never in the middle of recording a frame
+    m_pipeline_manager.BeginFrame();
+    m_vkframe_pipeline = m_pipeline_manager.Get(m_unpipeline_variant);
+
+    //the GPU is done with everything this slot allocated last time around
+    m_frame_ring.BeginFrame(m_uncurrent_frame);
+
+    //the uniforms and the CPU cull see the same view and time
+    glm::mat4 view_proj(1.f);
+    float f_seconds = MillisecondsSince(m_init_time) / 1000.f;
+
+    {  //per-frame uniforms, written straight into this slot's mapped region
+      TRACE_SCOPE("UpdateUniforms");
+
+      std::optional<FrameRing::Slice> opt_slice = m_frame_ring.Allocate(sizeof(FrameUniforms));
+      if (!opt_slice.has_value()) {
+        std::cerr << "[Program] Frame ring region is too small for the frame uniforms" << std::endl;
+        return false;
+      }
+
+      FrameUniforms* p_uniforms = static_cast<FrameUniforms*>(opt_slice->p_data);
+      p_uniforms->view_proj = view_proj;
+      //CPU culled instances are written with the spin already applied
+      p_uniforms->time = glm::vec4(f_seconds, m_last_frame_timing.f_frame_ms / 1000.f,
+                                   m_bcpu_culling ? 0.f : m_config.f_spin_speed, 0.f);
+
+      if (opt_slice->offset > UINT32_MAX) {
+        std::cerr << "[Program] Frame uniforms lie beyond the reach of a dynamic offset" << std::endl;
+        return false;
+      }
+      m_unframe_uniforms_offset = static_cast<uint32_t>(opt_slice->offset);
+      m_frame_ring.Flush();
+    }
+
+    if (m_bcpu_culling) {  //visible instances, written straight into this slot's region of the instance ring
+      TRACE_SCOPE("CullInstances");
+
+      m_instance_ring.BeginFrame(m_uncurrent_frame);
+      std::optional<FrameRing::Slice> opt_slice = m_instance_ring.Allocate(sizeof(InstanceData) * m_uninstance_count);
+      if (!opt_slice.has_value()) {
+        std::cerr << "[Program] Instance ring region is too small for the instances" << std::endl;
+        return false;
+      }
+
+      float f_angle = std::fmod(f_seconds * m_config.f_spin_speed, 6.2831853f);
+      m_unframe_instance_count = m_scene_core.Cull(m_cull_thread_pool.get(), SceneCore::ExtractFrustum(view_proj),
+                                                   f_angle, static_cast<InstanceData*>(opt_slice->p_data));
+      //firstInstance plus the instance index has to stay in 32 bits. a ring past 4 GiB can start a region further in
+      VkDeviceSize first_instance = opt_slice->offset / sizeof(InstanceData);
+      if (first_instance + m_uninstance_count > UINT32_MAX) {
+        std::cerr << "[Program] Instance ring region lies beyond the reach of firstInstance" << std::endl;
+        return false;
+      }
+      m_unframe_first_instance = static_cast<uint32_t>(first_instance);
+      m_instance_ring.Flush();
+    }
+
+    //acquire image from swapchain, headless frames own the render target matching their frame slot
+    uint32_t un_image_index = m_uncurrent_frame;
+    if (!m_config.b_headless) {
+      TRACE_SCOPE("Acquire");
+
+      auto acquire_start = std::chrono::steady_clock::now();
+      VkResult acquire_result =
+          vkAcquireNextImageKHR(m_vkdevice, m_vkswapchain, UINT64_MAX,
+                                mv_vksemaphores_image_available[m_uncurrent_frame], VK_NULL_HANDLE, &un_image_index);
+      m_last_frame_timing.f_acquire_ms = MillisecondsSince(acquire_start);
+
+      //nothing was acquired or submitted, so the next Tick can recreate and retry this slot
+      if (acquire_result == VK_ERROR_OUT_OF_DATE_KHR) {
+        m_bswapchain_dirty = true;
+        return true;
+      }
+
+      //a suboptimal image has still been acquired and its semaphore will signal, so render and present it first
+      if (acquire_result == VK_SUBOPTIMAL_KHR) {
+        m_bswapchain_dirty = true;
+      } else if (acquire_result != VK_SUCCESS) {
+        std::cout << "[Program] vkAcquireNextImageKHR failed with: " << acquire_result << std::endl;
+        return false;
+      }
+    }
+
+    //acquire returning usually means an earlier image just left the screen, a good moment to check
+    PollDisplayedPresents();
 
-    //acquire image from swapchain
-    uint32_t un_image_index;
-    v_qualify_vk(vkAcquireNextImageKHR(m_vkdevice, m_vkswapchain, UINT64_MAX,
-                                       mv_vksemaphores_image_available[m_uncurrent_frame], VK_NULL_HANDLE,
-                                       &un_image_index));
+    uint64_t un_upload_wait_value = 0;
+    VkPipelineStageFlags upload_wait_stages = 0;
 
+    auto record_start = std::chrono::steady_clock::now();
     {  //record command buffer
-      v_qualify_vk(vkResetCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame], 0));
+      TRACE_SCOPE("Record");
+
+      b_qualify_vk(vkResetCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame], 0));
 
       VkCommandBufferBeginInfo begin_info = {
           .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
@@ -737,78 +1737,162 @@ class Program {
           .flags = 0,
           .pInheritanceInfo = nullptr,
       };
-      v_qualify_vk(vkBeginCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame], &begin_info));
+      b_qualify_vk(vkBeginCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame], &begin_info));
+
+      m_gpu_tracer.BeginFrame(mv_vkcommand_buffers[m_uncurrent_frame], m_uncurrent_frame);
+      m_gpu_tracer.BeginRange(mv_vkcommand_buffers[m_uncurrent_frame], "Frame");
+
+      m_transfer_uploader.RecordAcquireBarriers(mv_vkcommand_buffers[m_uncurrent_frame], un_upload_wait_value,
+                                                upload_wait_stages);
+      //after the acquire barriers, so the queue draws exactly what this command buffer has acquired
+      BuildDrawQueue();
+      m_uncurrent_image_index = un_image_index;
+      m_render_graph.BindImage(m_render_target, m_swapchain_images[un_image_index]);
+      if (m_bgpu_culling) {
+        m_render_graph.BindBuffer(m_draw_commands_target, m_vkdraw_command_buffer);
+        m_render_graph.BindBuffer(m_draw_count_target, m_vkdraw_count_buffer);
+      }
+      if (!m_config.s_output_path.empty()) {
+        m_render_graph.BindBuffer(m_readback_target, m_frame_readback.AcquireSlot());
+      }
+      if (!m_render_graph.Execute(mv_vkcommand_buffers[m_uncurrent_frame])) {
+        AbandonFrame();
+        return false;
+      }
 
-      VkClearValue clear_value = {
-          .color =
-              {
-                  .float32 = {0.f, 0.f, 0.f, 1.f},
-              },
-      };
-      VkRenderPassBeginInfo render_pass_begin_info = {
-          .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-          .pNext = nullptr,
-          .renderPass = m_renderpass,
-          .framebuffer = m_swapchain_framebuffers[un_image_index],
-          .renderArea =
-              {
-                  .offset = {0, 0},
-                  .extent = m_swapchain_extent,
-              },
-          .clearValueCount = 1,
-          .pClearValues = &clear_value,
-      };
-      vkCmdBeginRenderPass(mv_vkcommand_buffers[m_uncurrent_frame], &render_pass_begin_info,
-                           VK_SUBPASS_CONTENTS_INLINE);
-
-      vkCmdBindPipeline(mv_vkcommand_buffers[m_uncurrent_frame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-
-      VkViewport viewport = {
-          .x = 0.f,
-          .y = 0.f,
-          .width = static_cast<float>(m_swapchain_extent.width),
-          .height = static_cast<float>(m_swapchain_extent.height),
-          .minDepth = 0.f,
-          .maxDepth = 1.f,
-      };
-      vkCmdSetViewport(mv_vkcommand_buffers[m_uncurrent_frame], 0, 1, &viewport);
+      m_gpu_tracer.EndRange(mv_vkcommand_buffers[m_uncurrent_frame]);
+      b_qualify_vk(vkEndCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame]));
+    }
+    m_last_frame_timing.f_record_ms = MillisecondsSince(record_start);
 
-      VkRect2D scissor = {
-          .offset = {0, 0},
-          .extent = m_swapchain_extent,
-      };
-      vkCmdSetScissor(mv_vkcommand_buffers[m_uncurrent_frame], 0, 1, &scissor);
+    VkSemaphore signal_semaphores[] = {
+        m_config.b_headless ? VK_NULL_HANDLE : mv_vksemaphores_render_finished[un_image_index]};
+    {  //submit
+      TRACE_SCOPE("Submit");
 
-      vkCmdDraw(mv_vkcommand_buffers[m_uncurrent_frame], 3, 1, 0, 0);
+      std::vector<VkSemaphore> v_wait_semaphores{};
+      std::vector<VkPipelineStageFlags> v_wait_stages{};
+      std::vector<uint64_t> v_wait_values{};  //ignored for the binary image available semaphore
 
-      vkCmdEndRenderPass(mv_vkcommand_buffers[m_uncurrent_frame]);
-      v_qualify_vk(vkEndCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame]));
-    }
+      if (!m_config.b_headless) {
+        v_wait_semaphores.push_back(mv_vksemaphores_image_available[m_uncurrent_frame]);
+        v_wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        v_wait_values.push_back(0);
+      }
 
-    VkSemaphore signal_semaphores[] = {mv_vksemaphores_render_finished[un_image_index]};
-    {  //submit
-      VkSemaphore wait_semaphores[] = {mv_vksemaphores_image_available[m_uncurrent_frame]};
-      VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-      VkSubmitInfo submit_info = {
-          .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-          .pNext = nullptr,
-          .waitSemaphoreCount = 1,
-          .pWaitSemaphores = wait_semaphores,
-          .pWaitDstStageMask = wait_stages,
-          .commandBufferCount = 1,
-          .pCommandBuffers = &mv_vkcommand_buffers[m_uncurrent_frame],
-          .signalSemaphoreCount = 1,
-          .pSignalSemaphores = signal_semaphores,
-      };
-      v_qualify_vk(vkQueueSubmit(m_vkgraphics_queue, 1, &submit_info, mv_vkfences_in_flight[m_uncurrent_frame]));
+      //already reached by the time its acquire was recorded, but it orders the release before the acquire
+      if (un_upload_wait_value > 0) {
+        v_wait_semaphores.push_back(m_transfer_uploader.GetTimelineSemaphore());
+        v_wait_stages.push_back(upload_wait_stages);
+        v_wait_values.push_back(un_upload_wait_value);
+      }
+
+      //the timeline signal is what frees this slot, the render finished semaphore is only for present
+      std::vector<VkSemaphore> v_signal_semaphores = {m_frame_scheduler.GetTimelineSemaphore()};
+      std::vector<uint64_t> v_signal_values = {m_frame_scheduler.GetSignalValue()};
+      if (!m_config.b_headless) {
+        v_signal_semaphores.push_back(signal_semaphores[0]);
+        v_signal_values.push_back(0);
+      }
+
+      m_gpu_tracer.EndFrame();
+      auto submit_start = std::chrono::steady_clock::now();
+      if (m_bsynchronization2) {
+        //values and stages sit next to each semaphore, and the render finished semaphore is signalled once color
+        //output is done instead of after every stage
+        std::vector<VkSemaphoreSubmitInfo> v_wait_semaphore_infos(v_wait_semaphores.size());
+        for (size_t i = 0; i < v_wait_semaphores.size(); i++) {
+          v_wait_semaphore_infos[i] = {
+              .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+              .pNext = nullptr,
+              .semaphore = v_wait_semaphores[i],
+              .value = v_wait_values[i],
+              .stageMask = v_wait_stages[i],  //the legacy stage bits keep their values in the 64-bit flags
+              .deviceIndex = 0,
+          };
+        }
+        VkSemaphoreSubmitInfo signal_semaphore_infos[] = {
+            {
+                //slot reuse and deferred deletes need every command of the frame to have finished
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                .pNext = nullptr,
+                .semaphore = v_signal_semaphores[0],
+                .value = v_signal_values[0],
+                .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .deviceIndex = 0,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                .pNext = nullptr,
+                .semaphore = signal_semaphores[0],
+                .value = 0,
+                .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .deviceIndex = 0,
+            },
+        };
+        VkCommandBufferSubmitInfo command_buffer_submit_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+            .pNext = nullptr,
+            .commandBuffer = mv_vkcommand_buffers[m_uncurrent_frame],
+            .deviceMask = 0,
+        };
+        VkSubmitInfo2 submit_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .pNext = nullptr,
+            .flags = 0,
+            .waitSemaphoreInfoCount = static_cast<uint32_t>(v_wait_semaphore_infos.size()),
+            .pWaitSemaphoreInfos = v_wait_semaphore_infos.data(),
+            .commandBufferInfoCount = 1,
+            .pCommandBufferInfos = &command_buffer_submit_info,
+            .signalSemaphoreInfoCount = static_cast<uint32_t>(v_signal_semaphores.size()),
+            .pSignalSemaphoreInfos = signal_semaphore_infos,
+        };
+        b_qualify_vk(vkQueueSubmit2(m_vkgraphics_queue, 1, &submit_info, VK_NULL_HANDLE));
+      } else {
+        VkTimelineSemaphoreSubmitInfo timeline_submit_info = {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreValueCount = static_cast<uint32_t>(v_wait_values.size()),
+            .pWaitSemaphoreValues = v_wait_values.data(),
+            .signalSemaphoreValueCount = static_cast<uint32_t>(v_signal_values.size()),
+            .pSignalSemaphoreValues = v_signal_values.data(),
+        };
+        VkSubmitInfo submit_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &timeline_submit_info,
+            .waitSemaphoreCount = static_cast<uint32_t>(v_wait_semaphores.size()),
+            .pWaitSemaphores = v_wait_semaphores.data(),
+            .pWaitDstStageMask = v_wait_stages.data(),
+            .commandBufferCount = 1,
+            .pCommandBuffers = &mv_vkcommand_buffers[m_uncurrent_frame],
+            .signalSemaphoreCount = static_cast<uint32_t>(v_signal_semaphores.size()),
+            .pSignalSemaphores = v_signal_semaphores.data(),
+        };
+        b_qualify_vk(vkQueueSubmit(m_vkgraphics_queue, 1, &submit_info, VK_NULL_HANDLE));
+      }
+      if (!m_config.s_output_path.empty()) {
+        m_frame_readback.Commit(m_frame_scheduler.GetSignalValue());
+      }
+      m_frame_scheduler.OnSubmitted();
+      m_last_frame_timing.f_submit_ms = MillisecondsSince(submit_start);
     }
 
-    {  //present
+    if (!m_config.b_headless) {  //present
+      TRACE_SCOPE("Present");
+
       VkSwapchainKHR swapchains[] = {m_vkswapchain};
 
+      uint64_t un_present_id = ++m_unlast_present_id;
+      VkPresentIdKHR present_id = {
+          .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+          .pNext = nullptr,
+          .swapchainCount = 1,
+          .pPresentIds = &un_present_id,
+      };
+
       VkPresentInfoKHR present_info = {
           .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-          .pNext = nullptr,
+          .pNext = m_bpresent_wait ? &present_id : nullptr,
           .waitSemaphoreCount = 1,
           .pWaitSemaphores = signal_semaphores,
           .swapchainCount = 1,
@@ -816,15 +1900,185 @@ class Program {
           .pImageIndices = &un_image_index,
           .pResults = nullptr,
       };
-      v_qualify_vk(vkQueuePresentKHR(m_vkpresent_queue, &present_info));
+      auto present_start = std::chrono::steady_clock::now();
+      VkResult present_result = vkQueuePresentKHR(m_vkpresent_queue, &present_info);
+      m_last_frame_timing.f_present_ms = MillisecondsSince(present_start);
+
+      //input for this frame was polled right before Tick started
+      m_last_frame_timing.opt_input_to_present_ms = MillisecondsSince(tick_start);
+      if (m_bpresent_wait && (present_result == VK_SUCCESS || present_result == VK_SUBOPTIMAL_KHR)) {
+        mdq_pending_presents.push_back({un_present_id, tick_start});
+      }
+      PollDisplayedPresents();
+
+      if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR) {
+        m_bswapchain_dirty = true;
+      } else if (present_result != VK_SUCCESS) {
+        std::cout << "[Program] vkQueuePresentKHR failed with: " << present_result << std::endl;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  //cleans up after recording failed past the acquire. the command buffer is ended so it can be reset, and an empty
+  //batch waits on the image available semaphore the acquire signalled, so the semaphore is unsignalled again before
+  //this slot's next acquire reuses it
+  void AbandonFrame() {
+    m_gpu_tracer.EndRange(mv_vkcommand_buffers[m_uncurrent_frame]);
+    vkEndCommandBuffer(mv_vkcommand_buffers[m_uncurrent_frame]);
+
+    if (m_config.b_headless) {
+      return;
+    }
+
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &mv_vksemaphores_image_available[m_uncurrent_frame],
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 0,
+        .pCommandBuffers = nullptr,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+    v_qualify_vk(vkQueueSubmit(m_vkgraphics_queue, 1, &submit_info, VK_NULL_HANDLE));
+  }
+
+  //called from the GLFW framebuffer size callback, the swapchain is rebuilt at the start of the next Tick
+  void OnFramebufferResized() { m_bswapchain_dirty = true; }
+
+  VkPresentModeKHR GetPresentMode() const { return m_present_mode; }
+  uint32_t GetSwapchainImageCount() const { return static_cast<uint32_t>(m_swapchain_images.size()); }
+  bool IsPresentWaitSupported() const { return m_bpresent_wait; }
+  bool IsDynamicRendering() const { return m_bdynamic_rendering; }
+  ValidationTier GetValidationTier() const { return m_validation_tier; }
+  bool IsSynchronization2() const { return m_bsynchronization2; }
+  bool IsGpuCulling() const { return m_bgpu_culling; }
+  bool IsCpuCulling() const { return m_bcpu_culling; }
+  SceneKernel GetCpuCullKernel() const { return m_scene_core.GetKernel(); }
+
+  const FrameTiming& GetLastFrameTiming() const { return m_last_frame_timing; }
+
+  std::string GetDeviceName() const {
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(m_vkphysical_device, &physical_device_properties);
+    return physical_device_properties.deviceName;
+  }
+
+  MemoryArenaStats GetMemoryStats() const { return m_memory_arena.GetStats(); }
+  const RenderGraphStats& GetRenderGraphStats() const { return m_render_graph.GetStats(); }
+  const MeshLoadStats& GetMeshLoadStats() const { return m_mesh_load_stats; }
+  DrawQueueStats GetDrawQueueStats() const { return m_draw_queue.GetStats(); }
+
+  //waits for the writer to catch up with every submitted frame so the readback stats are complete
+  void FlushReadback() { m_frame_readback.WaitIdle(); }
+  const ReadbackStats& GetReadbackStats() const { return m_frame_readback.GetStats(); }
+
+  //records un_calls dynamic state commands into an idle command buffer, once through the loader's exported trampolines
+  //and once through the device dispatch table, and prints the average cost of a call for each. state commands do
+  //almost no work in the driver, so the difference is the dispatch overhead a command-heavy frame pays per call
+  bool RunDispatchBenchmark(uint32_t un_calls) {
+    VkDeviceDispatch loader_dispatch{};
+    loader_dispatch.LoadLoaderDispatch();
+
+    if (!m_frame_scheduler.WaitForFrameSlot()) {
+      return false;
+    }
+
+    //a secondary buffer that continues the main pass, so draws are valid without beginning a render pass. it is never
+    //submitted
+    VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = m_vkcommand_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1,
+    };
+    VkCommandBuffer command_buffer;
+    b_qualify_vk(vkAllocateCommandBuffers(m_vkdevice, &command_buffer_allocate_info, &command_buffer));
+
+    VkViewport viewport = {
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(m_swapchain_extent.width),
+        .height = static_cast<float>(m_swapchain_extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = m_swapchain_extent,
+    };
+
+    const uint32_t un_draws =
+        std::max((un_calls + DISPATCH_BENCHMARK_COMMANDS_PER_DRAW - 1) / DISPATCH_BENCHMARK_COMMANDS_PER_DRAW, 1u);
+    const uint32_t un_recorded_calls = un_draws * DISPATCH_BENCHMARK_COMMANDS_PER_DRAW;
+
+    auto Measure = [&](const VkDeviceDispatch& dispatch, double& out_ns_per_call) -> bool {
+      b_qualify_vk(vkResetCommandBuffer(command_buffer, 0));
+      if (!BeginSecondaryCommandBuffer(command_buffer, 0)) {
+        return false;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t i = 0; i < un_draws; i++) {
+        dispatch.vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+        dispatch.vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1,
+                                         &m_vkdescriptor_set, 1, &m_unframe_uniforms_offset);
+        dispatch.vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        dispatch.vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+        dispatch.vkCmdDraw(command_buffer, 3, 1, 0, i);
+      }
+      double f_elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+      b_qualify_vk(vkEndCommandBuffer(command_buffer));
+
+      out_ns_per_call = std::min(out_ns_per_call, f_elapsed_ns / un_recorded_calls);
+      return true;
+    };
+
+    //alternate the two and keep the best round of each, so warmup and clock ramping hit both equally
+    double f_loader_ns = std::numeric_limits<double>::max();
+    double f_table_ns = std::numeric_limits<double>::max();
+    bool b_measured = true;
+    for (uint32_t un_round = 0; un_round < 5 && b_measured; un_round++) {
+      b_measured = Measure(loader_dispatch, f_loader_ns) && Measure(*this, f_table_ns);
+    }
+    vkFreeCommandBuffers(m_vkdevice, m_vkcommand_pool, 1, &command_buffer);
+    if (!b_measured) {
+      return false;
     }
 
-    m_uncurrent_frame = (m_uncurrent_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    std::cout << "{\n";
+    std::cout << "  \"device\": ";
+    WriteJsonString(std::cout, GetDeviceName().c_str());
+    std::cout << ",\n";
+    std::cout << "  \"validation\": \"" << ValidationTierName(m_validation_tier) << "\",\n";
+    std::cout << "  \"calls\": " << un_recorded_calls << ",\n";
+    std::cout << "  \"draws\": " << un_draws << ",\n";
+    std::cout << "  \"loader_ns_per_call\": " << f_loader_ns << ",\n";
+    std::cout << "  \"device_table_ns_per_call\": " << f_table_ns << ",\n";
+    std::cout << "  \"saving_ns_per_call\": " << f_loader_ns - f_table_ns << "\n";
+    std::cout << "}" << std::endl;
+
+    return true;
   }
 
   ~Program() {
+    //Init stopped before the device functions were loaded, only instance-level objects can exist
+    if (vkDestroyDevice == nullptr) {
+      DestroyInstance();
+      return;
+    }
+
     vkDeviceWaitIdle(m_vkdevice);
 
+    m_gpu_tracer.Destroy();
+
     for (VkSemaphore semaphore : mv_vksemaphores_image_available) {
       vkDestroySemaphore(m_vkdevice, semaphore, nullptr);
     }
@@ -833,8 +2087,17 @@ class Program {
       vkDestroySemaphore(m_vkdevice, semaphore, nullptr);
     }
 
-    for (VkFence fence : mv_vkfences_in_flight) {
-      vkDestroyFence(m_vkdevice, fence, nullptr);
+    //the writer drains the frames still queued before the timeline it waits on goes away
+    m_frame_readback.Destroy();
+
+    //destroys whatever was still waiting on frames to complete
+    m_frame_scheduler.Destroy();
+
+    m_record_thread_pool.reset();
+    for (const auto& v_thread_pools : mvv_vkthread_command_pools) {
+      for (VkCommandPool command_pool : v_thread_pools) {
+        vkDestroyCommandPool(m_vkdevice, command_pool, nullptr);
+      }
     }
 
     vkDestroyCommandPool(m_vkdevice, m_vkcommand_pool, nullptr);
@@ -843,7 +2106,34 @@ class Program {
       vkDestroyFramebuffer(m_vkdevice, framebuffer, nullptr);
     }
 
+    m_render_graph.Destroy();
+
+    m_pipeline_manager.Destroy();
     vkDestroyPipeline(m_vkdevice, m_pipeline, nullptr);
+
+    vkDestroyDescriptorPool(m_vkdevice, m_vkdescriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_vkdevice, m_vkdescriptor_set_layout, nullptr);
+    m_memory_arena.DestroyBuffer(m_vkinstance_buffer, m_instance_allocation);
+    m_instance_ring.Destroy();
+    m_cull_thread_pool.reset();
+    if (m_bgpu_culling) {
+      vkDestroyPipeline(m_vkdevice, m_vkcull_pipeline, nullptr);
+      vkDestroyShaderModule(m_vkdevice, m_vkcull_shader, nullptr);
+      m_memory_arena.DestroyBuffer(m_vkindex_buffer, m_index_allocation);
+      m_memory_arena.DestroyBuffer(m_vkdraw_command_buffer, m_draw_command_allocation);
+      m_memory_arena.DestroyBuffer(m_vkdraw_count_buffer, m_draw_count_allocation);
+    }
+    m_memory_arena.DestroyBuffer(m_vkmesh_vertex_buffer, m_mesh_vertex_allocation);
+    m_memory_arena.DestroyBuffer(m_vkmesh_index_buffer, m_mesh_index_allocation);
+    vkDestroyPipeline(m_vkdevice, m_vkmesh_pipeline, nullptr);
+    vkDestroyShaderModule(m_vkdevice, m_vkmesh_vert_shader, nullptr);
+    m_frame_ring.Destroy();
+    m_transfer_uploader.Destroy();
+
+    if (m_vkpipeline_cache != VK_NULL_HANDLE) {
+      SavePipelineCache();
+      vkDestroyPipelineCache(m_vkdevice, m_vkpipeline_cache, nullptr);
+    }
     vkDestroyPipelineLayout(m_vkdevice, m_pipeline_layout, nullptr);
     vkDestroyRenderPass(m_vkdevice, m_renderpass, nullptr);
 
@@ -854,79 +2144,1761 @@ class Program {
       vkDestroyImageView(m_vkdevice, image_view, nullptr);
     }
 
+    if (m_config.b_headless) {
+      for (size_t i = 0; i < m_swapchain_images.size(); i++) {
+        m_memory_arena.DestroyImage(m_swapchain_images[i], mv_headless_image_allocations[i]);
+      }
+    }
+
     vkDestroySwapchainKHR(m_vkdevice, m_vkswapchain, nullptr);
+    m_memory_arena.Destroy();
     vkDestroyDevice(m_vkdevice, nullptr);
-    vkDestroyDebugUtilsMessengerEXT(m_vkinstance, m_vkdebug_utils_messenger, nullptr);
-    vkDestroySurfaceKHR(m_vkinstance, m_vksurface, nullptr);
-    vkDestroyInstance(m_vkinstance, nullptr);
+    DestroyInstance();
   }
 
  private:
-  GLFWwindow* m_glfw_window;
+  void DestroyInstance() {
+    if (m_vkdebug_utils_messenger != VK_NULL_HANDLE) {
+      vkDestroyDebugUtilsMessengerEXT(m_vkinstance, m_vkdebug_utils_messenger, nullptr);
+    }
+    m_log_sink.Destroy();
 
-  VkInstance m_vkinstance;
-  VkDebugUtilsMessengerEXT m_vkdebug_utils_messenger;
+    if (m_vkinstance != VK_NULL_HANDLE) {
+      vkDestroySurfaceKHR(m_vkinstance, m_vksurface, nullptr);
+      vkDestroyInstance(m_vkinstance, nullptr);
+    }
+  }
 
-  VkPhysicalDevice m_vkphysical_device;
-  VkDevice m_vkdevice;
+  //creates m_vkswapchain for the current surface size and fetches its images. old_swapchain is handed to the driver
+  //so it can reuse its resources and is retired, not destroyed, by the caller
+  bool CreateSwapchain(VkSwapchainKHR old_swapchain) {
+    struct SwapchainSupportDetails {
+      VkSurfaceCapabilitiesKHR v_capabilities;
+      std::vector<VkSurfaceFormatKHR> v_formats;
+      std::vector<VkPresentModeKHR> v_present_modes;
+    };
+
+    SwapchainSupportDetails swapchain_support{};
+    b_qualify_vk(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_vkphysical_device, m_vksurface,
+                                                           &swapchain_support.v_capabilities));
+
+    uint32_t un_format_count;
+    b_qualify_vk(vkGetPhysicalDeviceSurfaceFormatsKHR(m_vkphysical_device, m_vksurface, &un_format_count, nullptr));
+
+    if (un_format_count != 0) {
+      swapchain_support.v_formats.resize(un_format_count);
+      b_qualify_vk(vkGetPhysicalDeviceSurfaceFormatsKHR(m_vkphysical_device, m_vksurface, &un_format_count,
+                                                        swapchain_support.v_formats.data()));
+    }
 
-  VkQueue m_vkgraphics_queue;
-  VkQueue m_vkpresent_queue;
+    uint32_t un_present_mode_count;
+    b_qualify_vk(vkGetPhysicalDeviceSurfacePresentModesKHR(m_vkphysical_device, m_vksurface, &un_present_mode_count,
+                                                           nullptr));
 
-  VkSurfaceKHR m_vksurface;
+    if (un_present_mode_count != 0) {
+      swapchain_support.v_present_modes.resize(un_present_mode_count);
+      b_qualify_vk(vkGetPhysicalDeviceSurfacePresentModesKHR(
+          m_vkphysical_device, m_vksurface, &un_present_mode_count, swapchain_support.v_present_modes.data()));
+    }
 
-  VkSurfaceFormatKHR m_swapchain_format;
-  VkExtent2D m_swapchain_extent{};
-  VkSwapchainKHR m_vkswapchain;
-  std::vector<VkImage> m_swapchain_images;
-  std::vector<VkImageView> m_swapchain_image_views;
+    //choose format, a recreated swapchain keeps the previous one while the surface offers it
+    VkSurfaceFormatKHR previous_format = m_swapchain_format;
+    m_swapchain_format = swapchain_support.v_formats[0];
+    for (const auto& available_surface_format : swapchain_support.v_formats) {
+      if (available_surface_format.format == VK_FORMAT_B8G8R8A8_SRGB &&
+          available_surface_format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+        m_swapchain_format = available_surface_format;
+        break;
+      }
+    }
+    if (old_swapchain != VK_NULL_HANDLE) {
+      for (const auto& available_surface_format : swapchain_support.v_formats) {
+        if (available_surface_format.format == previous_format.format &&
+            available_surface_format.colorSpace == previous_format.colorSpace) {
+          m_swapchain_format = available_surface_format;
+          break;
+        }
+      }
+    }
 
-  std::vector<VkFramebuffer> m_swapchain_framebuffers;
+    //choose present mode, FIFO is the only one every surface has to support
+    VkPresentModeKHR wanted_present_mode = m_config.opt_present_mode.value_or(VK_PRESENT_MODE_MAILBOX_KHR);
+    VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    for (const auto& available_present_mode : swapchain_support.v_present_modes) {
+      if (available_present_mode == wanted_present_mode) {
+        present_mode = available_present_mode;
+      }
+    }
 
-  VkShaderModule m_vert_shader;
-  VkShaderModule m_frag_shader;
+    if (m_config.opt_present_mode.has_value() && present_mode != wanted_present_mode) {
+      std::cout << "[Program] Present mode " << PresentModeName(wanted_present_mode)
+                << " is not supported by the surface, using fifo" << std::endl;
+    }
+    m_present_mode = present_mode;
+
+    {  //set swapchain extent
+      if (swapchain_support.v_capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
+        m_swapchain_extent = swapchain_support.v_capabilities.currentExtent;
+      } else {
+        int n_width, n_height;
+        glfwGetFramebufferSize(m_glfw_window, &n_width, &n_height);
+
+        m_swapchain_extent = {(uint32_t)n_width, (uint32_t)n_height};
+
+        m_swapchain_extent.width =
+            std::clamp(m_swapchain_extent.width, swapchain_support.v_capabilities.minImageExtent.width,
+                       swapchain_support.v_capabilities.maxImageExtent.width);
+        m_swapchain_extent.height =
+            std::clamp(m_swapchain_extent.height, swapchain_support.v_capabilities.minImageExtent.height,
+                       swapchain_support.v_capabilities.maxImageExtent.height);
+      }
+    }
 
-  VkRenderPass m_renderpass;
-  VkPipelineLayout m_pipeline_layout;
+    //set image count
+    uint32_t un_image_count = m_config.un_swapchain_images > 0 ? m_config.un_swapchain_images
+                                                               : swapchain_support.v_capabilities.minImageCount + 1;
+    un_image_count = std::max(un_image_count, swapchain_support.v_capabilities.minImageCount);
+    if (swapchain_support.v_capabilities.maxImageCount > 0 &&
+        un_image_count > swapchain_support.v_capabilities.maxImageCount) {
+      un_image_count = swapchain_support.v_capabilities.maxImageCount;
+    }
 
-  VkPipeline m_pipeline;
+    VkSwapchainCreateInfoKHR swapchain_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+        .pNext = nullptr,
+        .flags = 0,
+        .surface = m_vksurface,
+        .minImageCount = un_image_count,
+        .imageFormat = m_swapchain_format.format,
+        .imageColorSpace = m_swapchain_format.colorSpace,
+        .imageExtent = m_swapchain_extent,
+        .imageArrayLayers = 1,
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+        .preTransform = swapchain_support.v_capabilities.currentTransform,
+        .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+        .presentMode = present_mode,
+        .clipped = VK_TRUE,
+        .oldSwapchain = old_swapchain,
+    };
+
+    b_qualify_vk(vkCreateSwapchainKHR(m_vkdevice, &swapchain_create_info, nullptr, &m_vkswapchain));
+
+    b_qualify_vk(vkGetSwapchainImagesKHR(m_vkdevice, m_vkswapchain, &un_image_count, nullptr));
+    m_swapchain_images.resize(un_image_count);
+
+    b_qualify_vk(vkGetSwapchainImagesKHR(m_vkdevice, m_vkswapchain, &un_image_count, m_swapchain_images.data()));
+
+    return true;
+  }
+
+  //swaps in a swapchain for the new surface size. the old swapchain, its views, framebuffers, present semaphores and
+  //the render graph's transient images may still be in use by frames in flight, so they are handed to the frame
+  //scheduler and destroyed once every frame submitted so far has completed
+  bool RecreateSwapchain() {
+    TRACE_SCOPE("RecreateSwapchain");
+
+    int n_width = 0, n_height = 0;
+    glfwGetFramebufferSize(m_glfw_window, &n_width, &n_height);
+    if (n_width == 0 || n_height == 0) {
+      //minimized, nothing can be presented until the window comes back. the swapchain stays dirty for the next Tick
+      glfwWaitEvents();
+      return true;
+    }
+
+    VkFormat previous_format = m_swapchain_format.format;
+
+    //present ids are per swapchain, frames still queued on the old one are no longer tracked
+    mdq_pending_presents.clear();
+
+    //deferred work only runs at the start of a later Tick, so the old swapchain can still be passed as oldSwapchain
+    VkSwapchainKHR vkold_swapchain = m_vkswapchain;
+    RetiredSwapchain retired = {
+        .vkswapchain = m_vkswapchain,
+        .v_image_views = std::move(m_swapchain_image_views),
+        .v_framebuffers = std::move(m_swapchain_framebuffers),
+        .v_semaphores = std::move(mv_vksemaphores_render_finished),
+    };
+    m_frame_scheduler.Defer([this, retired = std::move(retired)]() { DestroyRetiredSwapchain(retired); });
+    m_vkswapchain = VK_NULL_HANDLE;
+    m_swapchain_image_views.clear();
+    m_swapchain_framebuffers.clear();
+    mv_vksemaphores_render_finished.clear();
+
+    if (!CreateSwapchain(vkold_swapchain)) {
+      return false;
+    }
+
+    //the render pass and pipelines were built for the original format, which CreateSwapchain keeps whenever the
+    //surface still offers it
+    if (m_swapchain_format.format != previous_format) {
+      std::cerr << "[Program] Surface no longer supports the swapchain format" << std::endl;
+      return false;
+    }
+
+    if (!CreateImageViews()) {
+      return false;
+    }
+
+    //transient attachments follow the swapchain extent
+    RenderGraph::Transients retired_transients{};
+    bool b_render_graph_built = BuildRenderGraph(retired_transients);
+    m_frame_scheduler.Defer([this, retired_transients]() { m_render_graph.DestroyTransients(retired_transients); });
+    if (!b_render_graph_built || !CreateFramebuffers()) {
+      return false;
+    }
+
+    VkSemaphoreCreateInfo semaphore_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+    };
+    mv_vksemaphores_render_finished.resize(m_swapchain_images.size());
+    for (VkSemaphore& semaphore : mv_vksemaphores_render_finished) {
+      b_qualify_vk(vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &semaphore));
+    }
+
+    m_bswapchain_dirty = false;
+    return true;
+  }
+
+  struct RetiredSwapchain {
+    VkSwapchainKHR vkswapchain;
+    std::vector<VkImageView> v_image_views;
+    std::vector<VkFramebuffer> v_framebuffers;
+    std::vector<VkSemaphore> v_semaphores;  //render finished semaphores that presents of this swapchain waited on
+  };
+
+  void DestroyRetiredSwapchain(const RetiredSwapchain& retired) {
+    for (VkFramebuffer framebuffer : retired.v_framebuffers) {
+      vkDestroyFramebuffer(m_vkdevice, framebuffer, nullptr);
+    }
+    for (VkImageView image_view : retired.v_image_views) {
+      vkDestroyImageView(m_vkdevice, image_view, nullptr);
+    }
+    for (VkSemaphore semaphore : retired.v_semaphores) {
+      vkDestroySemaphore(m_vkdevice, semaphore, nullptr);
+    }
+    vkDestroySwapchainKHR(m_vkdevice, retired.vkswapchain, nullptr);
+  }
+
+  //non-blocking check of which tracked presents have reached the display, in present order.
+  //the latency is only as precise as how often this runs, which is twice per frame
+  void PollDisplayedPresents() {
+    while (!mdq_pending_presents.empty()) {
+      VkResult result = vkWaitForPresentKHR(m_vkdevice, m_vkswapchain, mdq_pending_presents.front().first, 0);
+      if (result == VK_TIMEOUT) {
+        return;
+      }
+
+      if (result == VK_SUCCESS) {
+        m_last_frame_timing.v_input_to_display_ms.push_back(MillisecondsSince(mdq_pending_presents.front().second));
+      }
+      mdq_pending_presents.pop_front();
+    }
+  }
+
+  bool CreateImageViews() {
+    m_swapchain_image_views.resize(m_swapchain_images.size());
+    for (size_t i = 0; i < m_swapchain_images.size(); i++) {
+      VkImageViewCreateInfo image_view_create_info = {
+          .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .image = m_swapchain_images[i],
+          .viewType = VK_IMAGE_VIEW_TYPE_2D,
+          .format = m_swapchain_format.format,
+          .components =
+              {
+                  .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+              },
+          .subresourceRange =
+              {
+                  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                  .baseMipLevel = 0,
+                  .levelCount = 1,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1,
+              },
+      };
+      b_qualify_vk(vkCreateImageView(m_vkdevice, &image_view_create_info, nullptr, &m_swapchain_image_views[i]));
+    }
+
+    return true;
+  }
+
+  //declares the frame's passes and the resources they touch, then compiles the barriers and the transient memory.
+  //transient attachments follow the swapchain, so this runs again whenever it is recreated. the previous topology's
+  //transients are handed back in out_retired_transients, frames in flight may still be using them
+  bool BuildRenderGraph(RenderGraph::Transients& out_retired_transients) {
+    out_retired_transients = m_render_graph.Reset();
+
+    //windowed frames wait on the acquire semaphore at the color output stage, the transition out of UNDEFINED has to
+    //come after it. the render finished semaphore is signalled at the same stage, so the transition to PRESENT_SRC
+    //has to come before it. headless images end in TRANSFER_SRC for the readback pass
+    m_render_target = m_render_graph.ImportImage(
+        "Render target", VK_IMAGE_ASPECT_COLOR_BIT,
+        {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE},
+        {m_config.b_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+         m_config.b_headless ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+         VK_ACCESS_2_NONE});
+
+    std::vector<RenderGraph::PassAccess> v_main_accesses = {
+        {m_render_target, RenderGraphAccess::kColorAttachmentWrite},
+    };
+
+    if (m_bgpu_culling) {
+      //the buffers persist across frames. starting from the previous frame's indirect reads orders this frame's
+      //writes after them
+      RenderGraph::ExternalState indirect_state = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                                                   VK_ACCESS_2_NONE};
+      RenderGraph::ExternalState done_state = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+      m_draw_commands_target = m_render_graph.ImportBuffer("Draw commands", indirect_state, done_state);
+      m_draw_count_target = m_render_graph.ImportBuffer("Draw count", indirect_state, done_state);
+
+      m_render_graph.AddPass("Cull reset", {{m_draw_count_target, RenderGraphAccess::kTransferWrite}},
+                             [this](VkCommandBuffer vkcommand_buffer) {
+                               vkCmdFillBuffer(vkcommand_buffer, m_vkdraw_count_buffer, 0, sizeof(uint32_t), 0);
+                               return true;
+                             });
+      m_render_graph.AddPass("Cull",
+                             {
+                                 {m_draw_count_target, RenderGraphAccess::kComputeReadWrite},
+                                 {m_draw_commands_target, RenderGraphAccess::kComputeWrite},
+                             },
+                             [this](VkCommandBuffer vkcommand_buffer) { return RecordCullPass(vkcommand_buffer); });
+
+      v_main_accesses.push_back({m_draw_commands_target, RenderGraphAccess::kIndirectRead});
+      v_main_accesses.push_back({m_draw_count_target, RenderGraphAccess::kIndirectRead});
+    }
+    if (m_msaa_samples != VK_SAMPLE_COUNT_1_BIT) {
+      VkImageCreateInfo image_create_info = {
+          .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .imageType = VK_IMAGE_TYPE_2D,
+          .format = m_swapchain_format.format,
+          .extent = {m_swapchain_extent.width, m_swapchain_extent.height, 1},
+          .mipLevels = 1,
+          .arrayLayers = 1,
+          .samples = m_msaa_samples,
+          .tiling = VK_IMAGE_TILING_OPTIMAL,
+          .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+          .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 0,
+          .pQueueFamilyIndices = nullptr,
+          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      };
+      m_msaa_target = m_render_graph.CreateTransientImage("MSAA color", image_create_info, VK_IMAGE_ASPECT_COLOR_BIT);
+      v_main_accesses.push_back({m_msaa_target, RenderGraphAccess::kColorAttachmentWrite});
+    }
+
+    m_render_graph.AddPass("Main", std::move(v_main_accesses),
+                           [this](VkCommandBuffer vkcommand_buffer) { return RecordMainPass(vkcommand_buffer); });
+
+    if (!m_config.s_output_path.empty()) {
+      //the slot is read by the writer thread once the frame's timeline value is reached, the final host barrier
+      //makes the copy visible to it
+      m_readback_target = m_render_graph.ImportBuffer(
+          "Readback slot", {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE},
+          {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT});
+      m_render_graph.AddPass("Readback",
+                             {
+                                 {m_render_target, RenderGraphAccess::kTransferRead},
+                                 {m_readback_target, RenderGraphAccess::kTransferWrite},
+                             },
+                             [this](VkCommandBuffer vkcommand_buffer) {
+                               m_frame_readback.RecordCopy(vkcommand_buffer,
+                                                           m_swapchain_images[m_uncurrent_image_index]);
+                               return true;
+                             });
+    }
+
+    return m_render_graph.Compile();
+  }
+
+  //tests every instance against the frustum and appends a draw command for each one that is at least partly
+  //inside. the count was cleared by the pass before, and stays 0 while the instances are still uploading
+  bool RecordCullPass(VkCommandBuffer vkcommand_buffer) {
+    if (m_transfer_uploader.GetAcquiredValue() < m_uninstance_upload_value) {
+      return true;
+    }
+
+    GpuTraceScope gpu_trace_scope(m_gpu_tracer, vkcommand_buffer, "Cull");
+    vkCmdBindPipeline(vkcommand_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkcull_pipeline);
+    vkCmdBindDescriptorSets(vkcommand_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1,
+                            &m_vkdescriptor_set, 1, &m_unframe_uniforms_offset);
+    vkCmdDispatch(vkcommand_buffer, (m_uninstance_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    return true;
+  }
+
+  //the pass drawing every instance into the image at m_uncurrent_image_index, with dynamic rendering or inside the
+  //render pass
+  bool RecordMainPass(VkCommandBuffer vkcommand_buffer) {
+    const uint32_t un_packet_count = m_draw_queue.GetPacketCount();
+    //the culled draw is a single command, there is nothing to split across threads
+    bool b_secondary = un_packet_count > 0 && m_record_thread_pool && !m_bgpu_culling;
+
+    VkClearValue clear_value = {
+        .color =
+            {
+                .float32 = {0.f, 0.f, 0.f, 1.f},
+            },
+    };
+    VkRect2D render_area = {
+        .offset = {0, 0},
+        .extent = m_swapchain_extent,
+    };
+
+    m_gpu_tracer.BeginRange(vkcommand_buffer, "RenderPass");
+    if (m_bdynamic_rendering) {
+      bool b_msaa = m_msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+      VkImageView vkoutput_view = m_swapchain_image_views[m_uncurrent_image_index];
+
+      VkRenderingAttachmentInfo color_attachment_info = {
+          .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+          .pNext = nullptr,
+          .imageView = b_msaa ? m_render_graph.GetImageView(m_msaa_target) : vkoutput_view,
+          .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          .resolveMode = b_msaa ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE,
+          .resolveImageView = b_msaa ? vkoutput_view : VK_NULL_HANDLE,
+          .resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+          .storeOp = b_msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+          .clearValue = clear_value,
+      };
+      VkRenderingInfo rendering_info = {
+          .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+          .pNext = nullptr,
+          .flags = b_secondary ? VkRenderingFlags{VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT} : 0,
+          .renderArea = render_area,
+          .layerCount = 1,
+          .viewMask = 0,
+          .colorAttachmentCount = 1,
+          .pColorAttachments = &color_attachment_info,
+          .pDepthAttachment = nullptr,
+          .pStencilAttachment = nullptr,
+      };
+      vkCmdBeginRendering(vkcommand_buffer, &rendering_info);
+    } else {
+      VkRenderPassBeginInfo render_pass_begin_info = {
+          .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+          .pNext = nullptr,
+          .renderPass = m_renderpass,
+          .framebuffer = m_swapchain_framebuffers[m_uncurrent_image_index],
+          .renderArea = render_area,
+          .clearValueCount = 1,
+          .pClearValues = &clear_value,
+      };
+      vkCmdBeginRenderPass(vkcommand_buffer, &render_pass_begin_info,
+                           b_secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    //the pass and the range are closed even when the record threads failed, so the caller can still end the
+    //command buffer
+    bool b_recorded = true;
+    if (b_secondary) {
+      b_recorded = RecordSecondaryCommandBuffers(m_uncurrent_image_index);
+    } else if (un_packet_count > 0) {
+      RecordDraws(vkcommand_buffer, 0, un_packet_count);
+    }
+
+    if (m_bdynamic_rendering) {
+      vkCmdEndRendering(vkcommand_buffer);
+    } else {
+      vkCmdEndRenderPass(vkcommand_buffer);
+    }
+    m_gpu_tracer.EndRange(vkcommand_buffer);
+
+    return b_recorded;
+  }
+
+  //the legacy path's single subpass. with MSAA it renders into attachment 0 and resolves into attachment 1
+  bool CreateRenderPass() {
+    bool b_msaa = m_msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+
+    //layout transitions and hazards around the pass are the render graph's job, so the attachments enter and
+    //leave the pass in the layout the subpass uses and there are no external dependencies
+    VkAttachmentDescription attachment_descriptions[] = {
+        {
+            //the output image itself without MSAA
+            .flags = 0,
+            .format = m_swapchain_format.format,
+            .samples = m_msaa_samples,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = b_msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        },
+        {
+            //MSAA only, the output image the samples are resolved into
+            .flags = 0,
+            .format = m_swapchain_format.format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        },
+    };
+
+    VkAttachmentReference color_attachment_reference = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+    VkAttachmentReference resolve_attachment_reference = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+    VkSubpassDescription subpass_description = {
+        .flags = 0,
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .inputAttachmentCount = 0,
+        .pInputAttachments = nullptr,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment_reference,
+        .pResolveAttachments = b_msaa ? &resolve_attachment_reference : nullptr,
+        .pDepthStencilAttachment = nullptr,
+        .preserveAttachmentCount = 0,
+        .pPreserveAttachments = nullptr,
+    };
+
+    VkRenderPassCreateInfo render_pass_create_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .attachmentCount = b_msaa ? 2u : 1u,
+        .pAttachments = attachment_descriptions,
+        .subpassCount = 1,
+        .pSubpasses = &subpass_description,
+        .dependencyCount = 0,
+        .pDependencies = nullptr,
+    };
+    b_qualify_vk(vkCreateRenderPass(m_vkdevice, &render_pass_create_info, nullptr, &m_renderpass));
+
+    return true;
+  }
+
+  bool CreateFramebuffers() {
+    if (m_bdynamic_rendering) {
+      return true;
+    }
+
+    m_swapchain_framebuffers.resize(m_swapchain_image_views.size());
+
+    for (size_t i = 0; i < m_swapchain_image_views.size(); i++) {
+      //with MSAA the samples are rendered into the graph's transient image and resolved into the swapchain image
+      std::vector<VkImageView> v_attachments;
+      if (m_msaa_samples != VK_SAMPLE_COUNT_1_BIT) {
+        v_attachments.push_back(m_render_graph.GetImageView(m_msaa_target));
+      }
+      v_attachments.push_back(m_swapchain_image_views[i]);
+
+      VkFramebufferCreateInfo framebuffer_create_info = {
+          .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .renderPass = m_renderpass,
+          .attachmentCount = static_cast<uint32_t>(v_attachments.size()),
+          .pAttachments = v_attachments.data(),
+          .width = m_swapchain_extent.width,
+          .height = m_swapchain_extent.height,
+          .layers = 1,
+      };
+
+      b_qualify_vk(
+          vkCreateFramebuffer(m_vkdevice, &framebuffer_create_info, nullptr, &m_swapchain_framebuffers[i]));
+    }
+
+    return true;
+  }
+
+  //builds the graphics pipeline with v_constants as specialization constants 0..N-1 of both stages, b_mesh swaps the
+  //instanced triangle for the loaded mesh's vertex streams. the pipeline manager calls it from its worker threads
+  //while RecreateSwapchain may run, so it only reads state that is fixed after Init: viewport and scissor are
+  //dynamic and the attachment format comes from m_color_attachment_format. the cache is thread safe
+  bool BuildGraphicsPipeline(const std::vector<uint32_t>& v_constants, bool b_mesh, VkPipeline& out_pipeline) {
+    std::vector<VkSpecializationMapEntry> v_map_entries(v_constants.size());
+    for (uint32_t i = 0; i < v_constants.size(); i++) {
+      v_map_entries[i] = {
+          .constantID = i,
+          .offset = static_cast<uint32_t>(i * sizeof(uint32_t)),
+          .size = sizeof(uint32_t),
+      };
+    }
+
+    VkSpecializationInfo specialization_info = {
+        .mapEntryCount = static_cast<uint32_t>(v_map_entries.size()),
+        .pMapEntries = v_map_entries.data(),
+        .dataSize = v_constants.size() * sizeof(uint32_t),
+        .pData = v_constants.data(),
+    };
+    const VkSpecializationInfo* p_specialization_info = v_constants.empty() ? nullptr : &specialization_info;
+
+    VkPipelineShaderStageCreateInfo vert_shader_stage_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = b_mesh ? m_vkmesh_vert_shader : m_vert_shader,
+        .pName = "main",
+        .pSpecializationInfo = p_specialization_info,
+    };
+    VkPipelineShaderStageCreateInfo frag_shader_stage_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .module = m_frag_shader,
+        .pName = "main",
+        .pSpecializationInfo = p_specialization_info,
+    };
+
+    VkPipelineShaderStageCreateInfo shader_stage_create_infos[] = {vert_shader_stage_create_info,
+                                                                   frag_shader_stage_create_info};
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .vertexBindingDescriptionCount = b_mesh ? static_cast<uint32_t>(mv_mesh_vertex_bindings.size()) : 0u,
+        .pVertexBindingDescriptions = b_mesh ? mv_mesh_vertex_bindings.data() : nullptr,
+        .vertexAttributeDescriptionCount = b_mesh ? static_cast<uint32_t>(mv_mesh_vertex_attributes.size()) : 0u,
+        .pVertexAttributeDescriptions = b_mesh ? mv_mesh_vertex_attributes.data() : nullptr,
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    std::vector<VkDynamicState> v_dynamic_states = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .dynamicStateCount = static_cast<uint32_t>(v_dynamic_states.size()),
+        .pDynamicStates = v_dynamic_states.data(),
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .viewportCount = 1,
+        .pViewports = nullptr,  //dynamic, set when the draws are recorded
+        .scissorCount = 1,
+        .pScissors = nullptr,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterization_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        //there is no depth buffer, the mesh relies on back faces being culled to hide its far side
+        .cullMode = b_mesh ? VkCullModeFlags{VK_CULL_MODE_BACK_BIT} : VkCullModeFlags{VK_CULL_MODE_NONE},
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasConstantFactor = 0.f,
+        .depthBiasClamp = 0.f,
+        .depthBiasSlopeFactor = 0.f,
+        .lineWidth = 1.f,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .rasterizationSamples = m_msaa_samples,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 1.f,
+        .pSampleMask = nullptr,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE,
+    };
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state = {
+        .blendEnable = VK_FALSE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                          VK_COLOR_COMPONENT_A_BIT,
+    };
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = &color_blend_attachment_state,
+        .blendConstants = {0.f, 0.f, 0.f, 0.f},
+    };
+
+    //without a render pass the pipeline is told the attachment formats directly
+    VkPipelineRenderingCreateInfo pipeline_rendering_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .pNext = nullptr,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &m_color_attachment_format,
+        .depthAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+    };
+
+    VkGraphicsPipelineCreateInfo pipeline_create_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = m_bdynamic_rendering ? &pipeline_rendering_create_info : nullptr,
+        .flags = 0,
+        .stageCount = 2,
+        .pStages = shader_stage_create_infos,
+        .pVertexInputState = &vertex_input_state_create_info,
+        .pInputAssemblyState = &input_assembly_state_create_info,
+        .pTessellationState = nullptr,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterization_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = nullptr,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = m_renderpass,
+        .subpass = 0,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    b_qualify_vk(
+        vkCreateGraphicsPipelines(m_vkdevice, m_vkpipeline_cache, 1, &pipeline_create_info, nullptr, &out_pipeline));
+
+    return true;
+  }
+
+  //fills the draw queue with everything the main pass draws this frame and sorts it. the instances and the mesh are
+  //only drawn once their uploads have been acquired
+  void BuildDrawQueue() {
+    TRACE_SCOPE("BuildDrawQueue");
+    m_draw_queue.Reset();
+
+    uint32_t un_material = m_draw_queue.AddMaterial({
+        .vklayout = m_pipeline_layout,
+        .vkdescriptor_set = m_vkdescriptor_set,
+        .un_dynamic_offset = m_unframe_uniforms_offset,
+    });
+
+    uint64_t un_acquired_value = m_transfer_uploader.GetAcquiredValue();
+    if (m_vkmesh_pipeline != VK_NULL_HANDLE && un_acquired_value >= m_unmesh_upload_value) {
+      m_draw_queue.Submit(static_cast<uint32_t>(DrawPass::kMesh), 0.5f,
+                          {
+                              .un_pipeline = m_draw_queue.AddPipeline(m_vkmesh_pipeline),
+                              .un_material = un_material,
+                              .un_geometry = m_draw_queue.AddGeometry(m_mesh_geometry),
+                              .kind = DrawQueue::DrawKind::kDrawIndexed,
+                              .command =
+                                  {
+                                      .indexCount = m_unmesh_index_count,
+                                      .instanceCount = 1,
+                                      .firstIndex = m_unmesh_first_index,
+                                      .vertexOffset = 0,
+                                      .firstInstance = 0,
+                                  },
+                              .vkindirect_buffer = VK_NULL_HANDLE,
+                              .vkcount_buffer = VK_NULL_HANDLE,
+                              .un_max_draw_count = 0,
+                              .p_push_constants = &m_mesh_push_constants,
+                              .un_push_constant_size = sizeof(MeshPushConstants),
+                          });
+    }
+
+    if (un_acquired_value < m_uninstance_upload_value) {
+      m_draw_queue.Sort();
+      return;
+    }
+
+    uint32_t un_pipeline = m_draw_queue.AddPipeline(m_vkframe_pipeline);
+    if (m_bgpu_culling) {
+      //one indexed draw per instance that survived the cull pass, firstInstance selects its InstanceData
+      DrawQueue::Geometry triangle_geometry = {
+          .un_binding_count = 0,
+          .vkvertex_buffers = {},
+          .vertex_offsets = {},
+          .vkindex_buffer = m_vkindex_buffer,
+          .index_type = VK_INDEX_TYPE_UINT16,
+      };
+      m_draw_queue.Submit(static_cast<uint32_t>(DrawPass::kInstances), 0.f,
+                          {
+                              .un_pipeline = un_pipeline,
+                              .un_material = un_material,
+                              .un_geometry = m_draw_queue.AddGeometry(triangle_geometry),
+                              .kind = DrawQueue::DrawKind::kDrawIndexedIndirectCount,
+                              .command = {},
+                              .vkindirect_buffer = m_vkdraw_command_buffer,
+                              .vkcount_buffer = m_vkdraw_count_buffer,
+                              .un_max_draw_count = m_uninstance_count,
+                              .p_push_constants = nullptr,
+                              .un_push_constant_size = 0,
+                          });
+    } else {
+      //each draw is one instanced call over its contiguous share of the frame's instances
+      const uint64_t un_instance_count = m_unframe_instance_count;
+      const uint64_t un_draw_count = m_config.un_draw_count;
+      for (uint32_t i = 0; i < un_draw_count; i++) {
+        uint32_t un_first_instance = static_cast<uint32_t>(un_instance_count * i / un_draw_count);
+        uint32_t un_end_instance = static_cast<uint32_t>(un_instance_count * (i + 1) / un_draw_count);
+        if (un_end_instance == un_first_instance) {
+          continue;
+        }
+        m_draw_queue.Submit(static_cast<uint32_t>(DrawPass::kInstances), 0.f,
+                            {
+                                .un_pipeline = un_pipeline,
+                                .un_material = un_material,
+                                .un_geometry = DrawQueue::NO_GEOMETRY,
+                                .kind = DrawQueue::DrawKind::kDraw,
+                                .command =
+                                    {
+                                        .indexCount = 3,
+                                        .instanceCount = un_end_instance - un_first_instance,
+                                        .firstIndex = 0,
+                                        .vertexOffset = 0,
+                                        .firstInstance = m_unframe_first_instance + un_first_instance,
+                                    },
+                                .vkindirect_buffer = VK_NULL_HANDLE,
+                                .vkcount_buffer = VK_NULL_HANDLE,
+                                .un_max_draw_count = 0,
+                                .p_push_constants = nullptr,
+                                .un_push_constant_size = 0,
+                            });
+      }
+    }
+
+    m_draw_queue.Sort();
+  }
+
+  //sets the dynamic state, then records the sorted draw packets [un_first_packet, un_end_packet)
+  void RecordDraws(VkCommandBuffer command_buffer, uint32_t un_first_packet, uint32_t un_end_packet) {
+    VkViewport viewport = {
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(m_swapchain_extent.width),
+        .height = static_cast<float>(m_swapchain_extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = m_swapchain_extent,
+    };
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+    m_draw_queue.Record(command_buffer, un_first_packet, un_end_packet);
+  }
+
+  bool CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties,
+                    VkBuffer& out_buffer, MemoryAllocation& out_allocation) {
+    VkBufferCreateInfo buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+    };
+
+    return m_memory_arena.CreateBuffer(buffer_create_info, memory_properties, 0, out_buffer, out_allocation);
+  }
+
+  //begins a secondary command buffer that continues the main pass drawing into swapchain image un_image_index
+  bool BeginSecondaryCommandBuffer(VkCommandBuffer vkcommand_buffer, uint32_t un_image_index) {
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &m_swapchain_format.format,
+        .depthAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .rasterizationSamples = m_msaa_samples,
+    };
+    VkCommandBufferInheritanceInfo inheritance_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = m_bdynamic_rendering ? &inheritance_rendering_info : nullptr,
+        .renderPass = m_renderpass,
+        .subpass = 0,
+        .framebuffer = m_bdynamic_rendering ? VK_NULL_HANDLE : m_swapchain_framebuffers[un_image_index],
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags = 0,
+        .pipelineStatistics = 0,
+    };
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritance_info,
+    };
+    b_qualify_vk(vkBeginCommandBuffer(vkcommand_buffer, &begin_info));
+
+    return true;
+  }
+
+  //splits the frame's sorted draw packets across the record threads, each one recording into a secondary command
+  //buffer from its own pool for this frame slot, then executes them from the primary command buffer inside the render
+  //pass. every buffer starts with nothing bound, so each split costs one more set of binds
+  bool RecordSecondaryCommandBuffers(uint32_t un_image_index) {
+    const uint32_t un_thread_count = m_record_thread_pool->GetThreadCount();
+    const uint32_t un_packet_count = m_draw_queue.GetPacketCount();
+
+    //whole chunks from the front, so the threads that got packets are contiguous even with fewer packets than threads
+    const uint32_t un_chunk_size = (un_packet_count + un_thread_count - 1) / un_thread_count;
+
+    std::vector<VkCommandBuffer>& v_secondary_buffers = mvv_vkthread_command_buffers[m_uncurrent_frame];
+    std::atomic<bool> b_failed{false};
+
+    m_record_thread_pool->Run([&](uint32_t un_thread_index) {
+      uint32_t un_first_packet = std::min(un_packet_count, un_thread_index * un_chunk_size);
+      uint32_t un_end_packet = std::min(un_packet_count, un_first_packet + un_chunk_size);
+      if (un_first_packet == un_end_packet) {
+        return;
+      }
+
+      auto RecordThread = [&]() -> bool {
+        Tracer::Get().SetThreadName("Record worker");
+        TRACE_SCOPE("RecordSecondary");
+
+        b_qualify_vk(vkResetCommandPool(m_vkdevice, mvv_vkthread_command_pools[m_uncurrent_frame][un_thread_index], 0));
+
+        if (!BeginSecondaryCommandBuffer(v_secondary_buffers[un_thread_index], un_image_index)) {
+          return false;
+        }
+
+        RecordDraws(v_secondary_buffers[un_thread_index], un_first_packet, un_end_packet);
+
+        b_qualify_vk(vkEndCommandBuffer(v_secondary_buffers[un_thread_index]));
+        return true;
+      };
+
+      if (!RecordThread()) {
+        b_failed = true;
+      }
+    });
+
+    if (b_failed) {
+      return false;
+    }
+
+    //threads with no packets left their buffers unrecorded, the rest are contiguous from the front
+    uint32_t un_recorded_count = (un_packet_count + un_chunk_size - 1) / un_chunk_size;
+    vkCmdExecuteCommands(mv_vkcommand_buffers[m_uncurrent_frame], un_recorded_count, v_secondary_buffers.data());
+
+    return true;
+  }
+
+  //written to a temporary file first so a crash mid-write never leaves a truncated cache behind
+  void SavePipelineCache() {
+    if (m_config.s_pipeline_cache_path.empty()) {
+      return;
+    }
+
+    size_t n_cache_size = 0;
+    v_qualify_vk(vkGetPipelineCacheData(m_vkdevice, m_vkpipeline_cache, &n_cache_size, nullptr));
+
+    std::vector<char> v_cache_data(n_cache_size);
+    v_qualify_vk(vkGetPipelineCacheData(m_vkdevice, m_vkpipeline_cache, &n_cache_size, v_cache_data.data()));
+
+    std::string s_temp_path = m_config.s_pipeline_cache_path + ".tmp";
+    {
+      std::ofstream file(s_temp_path, std::ios::binary | std::ios::trunc);
+      if (!file.is_open()) {
+        std::cout << "[Program] Could not write pipeline cache " << s_temp_path << std::endl;
+        return;
+      }
+      file.write(v_cache_data.data(), n_cache_size);
+    }
+
+    std::error_code error;
+    std::filesystem::rename(s_temp_path, m_config.s_pipeline_cache_path, error);
+    if (error) {
+      std::cout << "[Program] Could not replace pipeline cache: " << error.message() << std::endl;
+    }
+  }
+
+  GLFWwindow* m_glfw_window;
+  ProgramConfig m_config;
+
+  VkInstance m_vkinstance = VK_NULL_HANDLE;
+  VkDebugUtilsMessengerEXT m_vkdebug_utils_messenger = VK_NULL_HANDLE;
+  ValidationTier m_validation_tier = ValidationTier::kOff;  //the tier in effect, config.validation_tier may fall back
+  LogSink m_log_sink;                                       //validation messages, printed from its own thread
+
+  VkPhysicalDevice m_vkphysical_device;
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+
+  DeviceMemoryArena m_memory_arena;
+
+  VkQueue m_vkgraphics_queue;
+  VkQueue m_vkpresent_queue;
+  VkQueue m_vktransfer_queue;
+
+  TransferUploader m_transfer_uploader;
+
+  VkSurfaceKHR m_vksurface = VK_NULL_HANDLE;
+
+  VkSurfaceFormatKHR m_swapchain_format;
+  VkFormat m_color_attachment_format = VK_FORMAT_UNDEFINED;  //what the pipelines were built for, set once in Init
+  VkExtent2D m_swapchain_extent{};
+  VkSwapchainKHR m_vkswapchain = VK_NULL_HANDLE;
+  std::vector<VkImage> m_swapchain_images;
+  std::vector<MemoryAllocation> mv_headless_image_allocations;
+  std::vector<VkImageView> m_swapchain_image_views;
+
+  std::vector<VkFramebuffer> m_swapchain_framebuffers;
+
+  bool m_bswapchain_dirty = false;
+  VkPresentModeKHR m_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+
+  bool m_bpresent_wait = false;
+  uint64_t m_unlast_present_id = 0;
+  std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> mdq_pending_presents;  //id, input time
+
+  VkShaderModule m_vert_shader;
+  VkShaderModule m_frag_shader;
+
+  VkRenderPass m_renderpass = VK_NULL_HANDLE;  //legacy path only
+  VkPipelineLayout m_pipeline_layout;
+  VkSampleCountFlagBits m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+
+  bool m_bdynamic_rendering = false;  //vkCmdBeginRendering instead of the render pass and framebuffers
+  bool m_bsynchronization2 = false;  //vkCmdPipelineBarrier2 in the render graph and vkQueueSubmit2
+
+  RenderGraph m_render_graph;
+  RenderGraph::Resource m_render_target = 0;  //the swapchain or headless image, rebound every frame
+  RenderGraph::Resource m_msaa_target = 0;
+  RenderGraph::Resource m_readback_target = 0;  //the readback slot acquired for the frame, rebound every frame
+  RenderGraph::Resource m_draw_commands_target = 0;
+  RenderGraph::Resource m_draw_count_target = 0;
+  uint32_t m_uncurrent_image_index = 0;  //image the frame being recorded renders into
+
+  VkPipelineCache m_vkpipeline_cache = VK_NULL_HANDLE;
+
+  VkDescriptorSetLayout m_vkdescriptor_set_layout = VK_NULL_HANDLE;
+  VkDescriptorPool m_vkdescriptor_pool = VK_NULL_HANDLE;
+  VkDescriptorSet m_vkdescriptor_set = VK_NULL_HANDLE;
+
+  uint32_t m_uninstance_count = 0;
+  VkBuffer m_vkinstance_buffer = VK_NULL_HANDLE;
+  uint64_t m_uninstance_upload_value = 0;  //transfer timeline value at which the instance data has landed
+  MemoryAllocation m_instance_allocation{};
+
+  //what the draws of the frame being recorded cover, all instances unless they were culled on the CPU
+  uint32_t m_unframe_instance_count = 0;
+  uint32_t m_unframe_first_instance = 0;
+
+  bool m_bcpu_culling = false;  //requested, or GPU culling requested and unsupported
+  SceneCore m_scene_core;
+  FrameRing m_instance_ring;
+  std::unique_ptr<ThreadPool> m_cull_thread_pool;
+
+  bool m_bgpu_culling = false;  //requested and supported, see ProgramConfig::b_gpu_culling
+  VkShaderModule m_vkcull_shader = VK_NULL_HANDLE;
+  VkPipeline m_vkcull_pipeline = VK_NULL_HANDLE;
+  VkBuffer m_vkindex_buffer = VK_NULL_HANDLE;
+  MemoryAllocation m_index_allocation{};
+  VkBuffer m_vkdraw_command_buffer = VK_NULL_HANDLE;  //VkDrawIndexedIndirectCommand per visible instance
+  MemoryAllocation m_draw_command_allocation{};
+  VkBuffer m_vkdraw_count_buffer = VK_NULL_HANDLE;
+  MemoryAllocation m_draw_count_allocation{};
+
+  VkBuffer m_vkmesh_vertex_buffer = VK_NULL_HANDLE;  //every stream of the mesh, at mv_mesh_stream_offsets
+  MemoryAllocation m_mesh_vertex_allocation{};
+  std::vector<VkDeviceSize> mv_mesh_stream_offsets;
+  VkBuffer m_vkmesh_index_buffer = VK_NULL_HANDLE;
+  MemoryAllocation m_mesh_index_allocation{};
+  MeshLoadStats m_mesh_load_stats{};
+  uint64_t m_unmesh_upload_value = 0;  //transfer timeline value at which the mesh has landed
+  VkShaderModule m_vkmesh_vert_shader = VK_NULL_HANDLE;
+  VkPipeline m_vkmesh_pipeline = VK_NULL_HANDLE;  //VK_NULL_HANDLE without --mesh
+  //position, color and normal, in the order of m_mesh_geometry's vertex buffers
+  std::vector<VkVertexInputBindingDescription> mv_mesh_vertex_bindings;
+  std::vector<VkVertexInputAttributeDescription> mv_mesh_vertex_attributes;
+  DrawQueue::Geometry m_mesh_geometry{};
+  uint32_t m_unmesh_first_index = 0;
+  uint32_t m_unmesh_index_count = 0;
+  MeshPushConstants m_mesh_push_constants{};
+
+  DrawQueue m_draw_queue;
+
+  FrameRing m_frame_ring;
+  uint32_t m_unframe_uniforms_offset = 0;  //dynamic offset of this frame's FrameUniforms
+  std::chrono::steady_clock::time_point m_init_time;
+
+  VkPipeline m_pipeline;  //default variant, also the fallback for variants still compiling
+
+  PipelineManager m_pipeline_manager;
+  uint32_t m_unpipeline_variant = UINT32_MAX;  //requested variant, UINT32_MAX draws with the default pipeline
+  VkPipeline m_vkframe_pipeline = VK_NULL_HANDLE;  //pipeline bound by every draw of the frame being recorded
 
   VkCommandPool m_vkcommand_pool;
   std::vector<VkCommandBuffer> mv_vkcommand_buffers;
 
+  //indexed [frame in flight][record thread]
+  std::vector<std::vector<VkCommandPool>> mvv_vkthread_command_pools;
+  std::vector<std::vector<VkCommandBuffer>> mvv_vkthread_command_buffers;
+  std::unique_ptr<ThreadPool> m_record_thread_pool;
+
   std::vector<VkSemaphore> mv_vksemaphores_image_available;
   std::vector<VkSemaphore> mv_vksemaphores_render_finished;
-  std::vector<VkFence> mv_vkfences_in_flight;
 
-  uint32_t m_uncurrent_frame = 0;
+  FrameScheduler m_frame_scheduler;
+  uint32_t m_uncurrent_frame = 0;  //slot of the frame being recorded
+
+  FrameReadback m_frame_readback;
+
+  uint32_t m_untimestamp_valid_bits = 0;
+  bool m_bcalibrated_timestamps = false;  //VK_EXT_calibrated_timestamps enabled with a CLOCK_MONOTONIC domain
+
+  GpuTracer m_gpu_tracer;
+
+  FrameTiming m_last_frame_timing{};
+  std::optional<std::chrono::steady_clock::time_point> m_last_tick_start;
 
   PFN_vkCreateDebugUtilsMessengerEXT vkCreateDebugUtilsMessengerEXT;
   PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT;
+  PFN_vkCmdBeginDebugUtilsLabelEXT vkCmdBeginDebugUtilsLabelEXT = nullptr;
+  PFN_vkCmdEndDebugUtilsLabelEXT vkCmdEndDebugUtilsLabelEXT = nullptr;
+  PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT vkGetPhysicalDeviceCalibrateableTimeDomainsEXT = nullptr;
 };
 
-int main() {
+static void PrintUsage(const char* p_program) {
+  std::cerr << "Usage: " << p_program
+            << " [--headless] [--frames N] [--benchmark N] [--benchmark-warmup N] [--benchmark-output FILE]"
+            << " [--pipeline-cache FILE | --no-pipeline-cache] [--draws N] [--instances N]"
+            << " [--record-threads N] [--scene-scale N] [--gpu-culling] [--cpu-culling]"
+            << " [--cull-benchmark ITERATIONS] [--mesh FILE] [--spin RADIANS_PER_SECOND] [--frames-in-flight N]"
+            << " [--present-mode immediate|mailbox|fifo|fifo-relaxed] [--swapchain-images N] [--fps-limit FPS]"
+            << " [--msaa N] [--legacy-rendering] [--color-mode N] [--trace FILE] [--output FILE]"
+            << " [--output-format rgba|y4m]"
+            << " [--validation off|errors|full|gpu|sync] [--dispatch-benchmark CALLS] [--device INDEX|NAME]"
+            << " [--farm CONTEXTS_PER_DEVICE]" << std::endl;
+}
+
+//s_value as a whole decimal number in [un_min, un_max]. from_chars takes no sign and the whole string has to parse, so
+//"-1", "+1", "8x" and "" are rejected instead of wrapping or being cut short
+static bool ParseUint32(const char* p_program, const std::string& s_flag, std::string_view s_value, uint32_t un_min,
+                        uint32_t un_max, uint32_t& out_value) {
+  uint32_t un_value = 0;
+  const char* p_end = s_value.data() + s_value.size();
+  auto [p_parsed, error] = std::from_chars(s_value.data(), p_end, un_value);
+  if (error != std::errc() || p_parsed != p_end || un_value < un_min || un_value > un_max) {
+    std::cerr << "Invalid value for " << s_flag << ": \"" << s_value << "\" (expected a whole number from " << un_min
+              << " to " << un_max << ")" << std::endl;
+    PrintUsage(p_program);
+    return false;
+  }
+  out_value = un_value;
+  return true;
+}
+
+//s_value as a finite decimal number in [f_min, f_max], with the same whole-string rule as ParseUint32
+static bool ParseFloat(const char* p_program, const std::string& s_flag, std::string_view s_value, float f_min,
+                       float f_max, float& out_value) {
+  float f_value = 0.f;
+  const char* p_end = s_value.data() + s_value.size();
+  auto [p_parsed, error] = std::from_chars(s_value.data(), p_end, f_value);
+  if (error != std::errc() || p_parsed != p_end || !std::isfinite(f_value) || f_value < f_min || f_value > f_max) {
+    std::cerr << "Invalid value for " << s_flag << ": \"" << s_value << "\" (expected a number from " << f_min
+              << " to " << f_max << ")" << std::endl;
+    PrintUsage(p_program);
+    return false;
+  }
+  out_value = f_value;
+  return true;
+}
+
+static bool ParseCommandLine(int argc, char** argv, ProgramConfig& out_config) {
+  std::optional<ReadbackFormat> opt_output_format;
+  for (int i = 1; i < argc; i++) {
+    std::string s_arg = argv[i];
+
+    if (s_arg == "--headless") {
+      out_config.b_headless = true;
+    } else if (s_arg == "--frames" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, UINT32_MAX, out_config.un_frame_count)) {
+        return false;
+      }
+    } else if (s_arg == "--benchmark" && i + 1 < argc) {
+      out_config.b_benchmark = true;
+      //0 frames would never finish and never write the report
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 1, UINT32_MAX, out_config.un_frame_count)) {
+        return false;
+      }
+    } else if (s_arg == "--benchmark-warmup" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, UINT32_MAX, out_config.un_benchmark_warmup_frames)) {
+        return false;
+      }
+    } else if (s_arg == "--benchmark-output" && i + 1 < argc) {
+      out_config.s_benchmark_output = argv[++i];
+    } else if (s_arg == "--draws" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, UINT32_MAX, out_config.un_draw_count)) {
+        return false;
+      }
+    } else if (s_arg == "--instances" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, UINT32_MAX, out_config.un_instance_count)) {
+        return false;
+      }
+    } else if (s_arg == "--record-threads" && i + 1 < argc) {
+      std::string s_threads = argv[++i];
+      if (s_threads == "auto") {
+        out_config.un_record_threads = std::max(1u, std::thread::hardware_concurrency());
+      } else if (!ParseUint32(argv[0], s_arg, s_threads, 0, UINT32_MAX, out_config.un_record_threads)) {
+        return false;
+      }
+    } else if (s_arg == "--spin" && i + 1 < argc) {
+      //negative spins the other way
+      if (!ParseFloat(argv[0], s_arg, argv[++i], std::numeric_limits<float>::lowest(),
+                      std::numeric_limits<float>::max(), out_config.f_spin_speed)) {
+        return false;
+      }
+    } else if (s_arg == "--frames-in-flight" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 1, MAX_FRAMES_IN_FLIGHT, out_config.un_frames_in_flight)) {
+        return false;
+      }
+    } else if (s_arg == "--swapchain-images" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, UINT32_MAX, out_config.un_swapchain_images)) {
+        return false;
+      }
+    } else if (s_arg == "--present-mode" && i + 1 < argc) {
+      std::string s_mode = argv[++i];
+      bool b_found = false;
+      for (VkPresentModeKHR present_mode : {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                            VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR}) {
+        if (s_mode == PresentModeName(present_mode)) {
+          out_config.opt_present_mode = present_mode;
+          b_found = true;
+        }
+      }
+      if (!b_found) {
+        std::cerr << "Unknown present mode: " << s_mode << std::endl;
+        return false;
+      }
+    } else if (s_arg == "--msaa" && i + 1 < argc) {
+      //up to the highest count Init picks from, lowered to the closest count the device supports
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 1, VK_SAMPLE_COUNT_16_BIT, out_config.un_msaa_samples)) {
+        return false;
+      }
+    } else if (s_arg == "--gpu-culling") {
+      out_config.b_gpu_culling = true;
+    } else if (s_arg == "--cpu-culling") {
+      out_config.b_cpu_culling = true;
+    } else if (s_arg == "--cull-benchmark" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 1, UINT32_MAX, out_config.un_cull_benchmark_iterations)) {
+        return false;
+      }
+    } else if (s_arg == "--mesh" && i + 1 < argc) {
+      out_config.s_mesh_path = argv[++i];
+    } else if (s_arg == "--scene-scale" && i + 1 < argc) {
+      //below 1 the grid would not fill the view
+      if (!ParseFloat(argv[0], s_arg, argv[++i], 1.f, std::numeric_limits<float>::max(), out_config.f_scene_scale)) {
+        return false;
+      }
+    } else if (s_arg == "--legacy-rendering") {
+      out_config.b_legacy_rendering = true;
+    } else if (s_arg == "--color-mode" && i + 1 < argc) {
+      //the modes hello.frag knows, anything above would compile a variant that draws like mode 0
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, 2, out_config.un_color_mode)) {
+        return false;
+      }
+    } else if (s_arg == "--fps-limit" && i + 1 < argc) {
+      if (!ParseFloat(argv[0], s_arg, argv[++i], 0.f, std::numeric_limits<float>::max(), out_config.f_fps_limit)) {
+        return false;
+      }
+    } else if (s_arg == "--validation" && i + 1 < argc) {
+      std::string s_tier = argv[++i];
+      std::optional<ValidationTier> opt_validation_tier = ParseValidationTier(s_tier);
+      if (!opt_validation_tier.has_value()) {
+        std::cerr << "Unknown validation tier: " << s_tier << std::endl;
+        return false;
+      }
+      out_config.validation_tier = opt_validation_tier.value();
+    } else if (s_arg == "--dispatch-benchmark" && i + 1 < argc) {
+      //rounded up to whole draws, which has to stay in range
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 0, UINT32_MAX - (DISPATCH_BENCHMARK_COMMANDS_PER_DRAW - 1),
+                       out_config.un_dispatch_benchmark_calls)) {
+        return false;
+      }
+    } else if (s_arg == "--device" && i + 1 < argc) {
+      out_config.s_device = argv[++i];
+    } else if (s_arg == "--farm" && i + 1 < argc) {
+      if (!ParseUint32(argv[0], s_arg, argv[++i], 1, UINT32_MAX, out_config.un_farm_contexts_per_device)) {
+        return false;
+      }
+      out_config.b_headless = true;
+    } else if (s_arg == "--trace" && i + 1 < argc) {
+      out_config.s_trace_path = argv[++i];
+    } else if (s_arg == "--output" && i + 1 < argc) {
+      out_config.s_output_path = argv[++i];
+      out_config.b_headless = true;
+    } else if (s_arg == "--output-format" && i + 1 < argc) {
+      std::string s_format = argv[++i];
+      if (s_format == "rgba") {
+        opt_output_format = ReadbackFormat::kRawRgba;
+      } else if (s_format == "y4m") {
+        opt_output_format = ReadbackFormat::kY4m;
+      } else {
+        std::cerr << "Unknown output format: " << s_format << " (expected rgba or y4m)" << std::endl;
+        return false;
+      }
+    } else if (s_arg == "--pipeline-cache" && i + 1 < argc) {
+      out_config.s_pipeline_cache_path = argv[++i];
+    } else if (s_arg == "--no-pipeline-cache") {
+      out_config.s_pipeline_cache_path.clear();
+    } else {
+      std::cerr << "Unknown argument: " << s_arg << std::endl;
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  if (!out_config.s_output_path.empty()) {
+    if (out_config.un_farm_contexts_per_device > 0) {
+      std::cerr << "--output streams one context's frames and cannot be combined with --farm" << std::endl;
+      return false;
+    }
+
+    const std::string s_y4m_extension = ".y4m";
+    const std::string& s_path = out_config.s_output_path;
+    bool b_y4m_path = s_path.size() >= s_y4m_extension.size() &&
+                      s_path.compare(s_path.size() - s_y4m_extension.size(), std::string::npos, s_y4m_extension) == 0;
+    out_config.output_format =
+        opt_output_format.value_or(b_y4m_path ? ReadbackFormat::kY4m : ReadbackFormat::kRawRgba);
+  }
+
+  return true;
+}
+
+static bool WriteBenchmarkReport(const ProgramConfig& config, const Program& program, uint32_t un_frames,
+                                 float f_wall_ms, const FrameStats& frame_stats) {
+  std::ofstream file;
+  if (!config.s_benchmark_output.empty()) {
+    file.open(config.s_benchmark_output);
+    if (!file.is_open()) {
+      std::cerr << "Could not open benchmark output " << config.s_benchmark_output << std::endl;
+      return false;
+    }
+  }
+  std::ostream& out = config.s_benchmark_output.empty() ? std::cout : file;
+
+  out << "{\n";
+  out << "  \"device\": ";
+  WriteJsonString(out, program.GetDeviceName().c_str());
+  out << ",\n";
+  out << "  \"headless\": " << (config.b_headless ? "true" : "false") << ",\n";
+  if (!config.b_headless) {
+    out << "  \"present_mode\": \"" << PresentModeName(program.GetPresentMode()) << "\",\n";
+    out << "  \"swapchain_images\": " << program.GetSwapchainImageCount() << ",\n";
+    out << "  \"latency_source\": \"" << (program.IsPresentWaitSupported() ? "present_wait" : "queue_present")
+        << "\",\n";
+  }
+  out << "  \"validation\": \"" << ValidationTierName(program.GetValidationTier()) << "\",\n";
+  out << "  \"rendering\": \"" << (program.IsDynamicRendering() ? "dynamic" : "render_pass") << "\",\n";
+  out << "  \"synchronization2\": " << (program.IsSynchronization2() ? "true" : "false") << ",\n";
+  out << "  \"gpu_culling\": " << (program.IsGpuCulling() ? "true" : "false") << ",\n";
+  out << "  \"cpu_culling\": " << (program.IsCpuCulling() ? "true" : "false") << ",\n";
+  if (program.IsCpuCulling()) {
+    out << "  \"cpu_cull_kernel\": \"" << SceneCore::GetKernelName(program.GetCpuCullKernel()) << "\",\n";
+  }
+  out << "  \"scene_scale\": " << config.f_scene_scale << ",\n";
+  out << "  \"frames_in_flight\": " << config.un_frames_in_flight << ",\n";
+  out << "  \"fps_limit\": " << config.f_fps_limit << ",\n";
+  out << "  \"frames\": " << un_frames << ",\n";
+  out << "  \"warmup_frames\": " << config.un_benchmark_warmup_frames << ",\n";
+  out << "  \"wall_ms\": " << f_wall_ms << ",\n";
+  out << "  \"fps\": " << (f_wall_ms > 0.f ? un_frames * 1000.f / f_wall_ms : 0.f) << ",\n";
+  out << "  \"memory\": ";
+  program.GetMemoryStats().WriteJson(out);
+  out << ",\n";
+  out << "  \"render_graph\": ";
+  program.GetRenderGraphStats().WriteJson(out);
+  out << ",\n";
+  out << "  \"draw_queue\": ";
+  program.GetDrawQueueStats().WriteJson(out);
+  out << ",\n";
+  if (!config.s_mesh_path.empty()) {
+    out << "  \"mesh\": ";
+    program.GetMeshLoadStats().WriteJson(out);
+    out << ",\n";
+  }
+  if (!config.s_output_path.empty()) {
+    out << "  \"readback\": ";
+    program.GetReadbackStats().WriteJson(out);
+    out << ",\n";
+  }
+  out << "  \"metrics\": ";
+  frame_stats.WriteJson(out);
+  out << "\n}" << std::endl;
+
+  return true;
+}
+
+//runs frames until the window closes or the configured frame count is reached. a dispatch benchmark runs instead
+static bool RunFrames(Program& program, const ProgramConfig& config, GLFWwindow* window) {
+  if (config.un_dispatch_benchmark_calls > 0) {
+    return program.RunDispatchBenchmark(config.un_dispatch_benchmark_calls);
+  }
+
+  FrameStats frame_stats{};
+  uint32_t un_measured_frames = 0;
+  std::optional<std::chrono::steady_clock::time_point> opt_measure_start;
+
+  //sleeping before input is polled, not after the frame is built, keeps the limiter from adding input latency
+  using FrameDuration = std::chrono::steady_clock::duration;
+  FrameDuration frame_period = config.f_fps_limit > 0.f
+                                   ? std::chrono::duration_cast<FrameDuration>(
+                                         std::chrono::duration<double>(1.0 / config.f_fps_limit))
+                                   : FrameDuration::zero();
+  auto next_frame_time = std::chrono::steady_clock::now();
+
+  for (uint32_t un_frame = 0; config.un_frame_count == 0 || un_frame < config.un_frame_count; un_frame++) {
+    if (frame_period > FrameDuration::zero()) {
+      TRACE_SCOPE("FpsLimit");
+      std::this_thread::sleep_until(next_frame_time);
+
+      //a frame that overran its slot starts a new schedule instead of bursting to catch up
+      next_frame_time = std::max(next_frame_time + frame_period, std::chrono::steady_clock::now());
+    }
+
+    if (window) {
+      if (glfwWindowShouldClose(window)) {
+        break;
+      }
+      TRACE_SCOPE("PollEvents");
+      glfwPollEvents();
+    }
+
+    if (config.b_benchmark && un_frame == config.un_benchmark_warmup_frames) {
+      opt_measure_start = std::chrono::steady_clock::now();
+    }
+
+    if (!program.Tick()) {
+      return false;
+    }
+
+    if (opt_measure_start.has_value()) {
+      frame_stats.Add(program.GetLastFrameTiming());
+      un_measured_frames++;
+    }
+  }
+
+  if (!config.b_benchmark) {
+    return true;
+  }
+
+  if (!opt_measure_start.has_value() || un_measured_frames == 0) {
+    std::cerr << "Benchmark ended before the warmup frames completed" << std::endl;
+    return false;
+  }
+
+  float f_wall_ms = MillisecondsSince(opt_measure_start.value());
+  program.FlushReadback();
+  return WriteBenchmarkReport(config, program, un_measured_frames, f_wall_ms, frame_stats);
+}
+
+//culls the --instances grid (default CULL_BENCHMARK_DEFAULT_INSTANCES) un_iterations times with every kernel the CPU
+//supports on one thread, then with the best kernel on a pool of one thread per hardware thread, and prints
+//instances per second as JSON. needs no Vulkan device
+static bool RunCullBenchmark(const ProgramConfig& config) {
+  uint32_t un_count = config.un_instance_count > 0 ? config.un_instance_count : CULL_BENCHMARK_DEFAULT_INSTANCES;
+  SceneCore scene_core;
+  scene_core.Init(BuildInstanceGrid(un_count, config.f_scene_scale));
+  SceneCore::Frustum frustum = SceneCore::ExtractFrustum(glm::mat4(1.f));
+
+  std::vector<InstanceData> v_out(un_count);
+  uint32_t un_visible = 0;
+
+  //best of 5 rounds, so warmup and clock ramping do not count
+  auto Measure = [&](ThreadPool* p_thread_pool) {
+    double f_best_s = std::numeric_limits<double>::max();
+    for (uint32_t un_round = 0; un_round < 5; un_round++) {
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t i = 0; i < config.un_cull_benchmark_iterations; i++) {
+        un_visible = scene_core.Cull(p_thread_pool, frustum, 0.f, v_out.data());
+      }
+      f_best_s = std::min(f_best_s, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return static_cast<double>(un_count) * config.un_cull_benchmark_iterations / f_best_s;
+  };
+
+  std::cout << "{\n";
+  std::cout << "  \"instances\": " << un_count << ",\n";
+  std::cout << "  \"scene_scale\": " << config.f_scene_scale << ",\n";
+  std::cout << "  \"iterations\": " << config.un_cull_benchmark_iterations << ",\n";
+  std::cout << "  \"single_thread_instances_per_s\": {";
+  const char* p_separator = "";
+  for (SceneKernel kernel : {SceneKernel::kScalar, SceneKernel::kSse, SceneKernel::kAvx2}) {
+    if (SceneCore::IsKernelSupported(kernel)) {
+      scene_core.SetKernel(kernel);
+      std::cout << p_separator << "\"" << SceneCore::GetKernelName(kernel) << "\": " << Measure(nullptr);
+      p_separator = ", ";
+    }
+  }
+  std::cout << "},\n";
+
+  SceneKernel best_kernel = SceneCore::GetBestKernel();
+  scene_core.SetKernel(best_kernel);
+  ThreadPool thread_pool(std::max(std::thread::hardware_concurrency(), 1u));
+  double f_threaded_rate = Measure(&thread_pool);
+
+  std::cout << "  \"threads\": " << thread_pool.GetThreadCount() << ",\n";
+  std::cout << "  \"threaded_kernel\": \"" << SceneCore::GetKernelName(best_kernel) << "\",\n";
+  std::cout << "  \"threaded_instances_per_s\": " << f_threaded_rate << ",\n";
+  std::cout << "  \"threaded_instances_per_s_per_core\": " << f_threaded_rate / thread_pool.GetThreadCount() << ",\n";
+  std::cout << "  \"visible\": " << un_visible << "\n";
+  std::cout << "}" << std::endl;
+
+  return true;
+}
+
+//indices of the devices a headless context can use, in vkEnumeratePhysicalDevices order. uses its own short-lived
+//instance, every farm context creates another one
+static std::optional<std::vector<uint32_t>> ListFarmDevices(const ProgramConfig& config) {
+  VkApplicationInfo application_info = {
+      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+      .pNext = nullptr,
+      .pApplicationName = "Hello Vulkan",
+      .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+      .pEngineName = "No Engine",
+      .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+      .apiVersion = VK_API_VERSION_1_2,
+  };
+  VkInstanceCreateInfo instance_create_info = {
+      .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .pApplicationInfo = &application_info,
+      .enabledLayerCount = 0,
+      .ppEnabledLayerNames = nullptr,
+      .enabledExtensionCount = 0,
+      .ppEnabledExtensionNames = nullptr,
+  };
+  VkInstance vkinstance;
+  if (vkCreateInstance(&instance_create_info, nullptr, &vkinstance) != VK_SUCCESS) {
+    std::cerr << "[Farm] Could not create an instance to enumerate devices" << std::endl;
+    return std::nullopt;
+  }
+
+  std::vector<uint32_t> v_device_indices{};
+  for (const PhysicalDeviceCandidate& candidate : RankPhysicalDevices(vkinstance, VK_NULL_HANDLE)) {
+    bool b_selected = config.s_device.empty() || MatchesDeviceOverride(candidate, config.s_device);
+    if (b_selected && candidate.opt_score.has_value()) {
+      v_device_indices.push_back(candidate.un_index);
+    } else if (b_selected) {
+      std::cout << "[Farm] Skipping device " << candidate.un_index << ": " << candidate.s_name << ", "
+                << candidate.s_reason << std::endl;
+    }
+  }
+
+  vkDestroyInstance(vkinstance, nullptr);
+  return v_device_indices;
+}
+
+//renders config.un_frame_count headless frames across every usable device at once. each context is a full Program
+//(instance, device, queues, pipelines) owned by one thread, so contexts share no Vulkan objects and need no locks.
+//frames are handed out from a shared counter, which balances the load when devices differ in speed
+static bool RunFarm(const ProgramConfig& config) {
+  std::optional<std::vector<uint32_t>> opt_device_indices = ListFarmDevices(config);
+  if (!opt_device_indices.has_value()) {
+    return false;
+  }
+  if (opt_device_indices->empty()) {
+    std::cerr << "[Farm] No suitable physical device" << std::endl;
+    return false;
+  }
+
+  struct FarmContext {
+    ProgramConfig config;
+    uint32_t un_device_index;
+    std::string s_device_name;
+    uint32_t un_frames = 0;
+    bool b_ok = false;
+  };
+
+  std::vector<FarmContext> v_contexts{};
+  for (uint32_t un_device_index : opt_device_indices.value()) {
+    for (uint32_t i = 0; i < config.un_farm_contexts_per_device; i++) {
+      FarmContext context = {
+          .config = config,
+          .un_device_index = un_device_index,
+      };
+      context.config.s_device = std::to_string(un_device_index);
+      context.config.b_benchmark = false;
+
+      //pipeline caches are per device, and only one context of each may write the file
+      if (!config.s_pipeline_cache_path.empty()) {
+        context.config.s_pipeline_cache_path =
+            i == 0 ? config.s_pipeline_cache_path + "." + std::to_string(un_device_index) : "";
+      }
+
+      v_contexts.push_back(std::move(context));
+    }
+  }
+
+  std::atomic<uint32_t> un_next_frame{0};
+
+  //the clock starts once every context has finished Init, successfully or not, so device and pipeline creation are
+  //not counted as frame time
+  std::latch initialized(static_cast<std::ptrdiff_t>(v_contexts.size()));
+
+  std::vector<std::thread> v_threads{};
+  for (FarmContext& context : v_contexts) {
+    v_threads.emplace_back([&context, &un_next_frame, &initialized, un_frame_count = config.un_frame_count]() {
+      Tracer::Get().SetThreadName("Farm worker");
+
+      Program program(nullptr, context.config);
+      bool b_initialized = program.Init();
+      initialized.arrive_and_wait();
+      if (!b_initialized) {
+        return;
+      }
+      context.s_device_name = program.GetDeviceName();
+
+      context.b_ok = true;
+      while (un_next_frame.fetch_add(1, std::memory_order_relaxed) < un_frame_count) {
+        if (!program.Tick()) {
+          context.b_ok = false;
+          break;
+        }
+        context.un_frames++;
+      }
+    });
+  }
+
+  initialized.wait();
+  auto start = std::chrono::steady_clock::now();
+  for (std::thread& thread : v_threads) {
+    thread.join();
+  }
+  float f_wall_ms = MillisecondsSince(start);
+
+  bool b_ok = true;
+  uint32_t un_total_frames = 0;
+  std::cout << "{\n  \"contexts\": [\n";
+  for (size_t i = 0; i < v_contexts.size(); i++) {
+    const FarmContext& context = v_contexts[i];
+    b_ok = b_ok && context.b_ok;
+    un_total_frames += context.un_frames;
+    std::cout << "    {\"device_index\": " << context.un_device_index << ", \"device\": ";
+    WriteJsonString(std::cout, context.s_device_name.c_str());
+    std::cout << ", \"ok\": " << (context.b_ok ? "true" : "false") << ", \"frames\": " << context.un_frames << "}"
+              << (i + 1 < v_contexts.size() ? "," : "") << "\n";
+  }
+  std::cout << "  ],\n";
+  std::cout << "  \"frames\": " << un_total_frames << ",\n";
+  std::cout << "  \"wall_ms\": " << f_wall_ms << ",\n";
+  std::cout << "  \"fps\": " << (f_wall_ms > 0.f ? un_total_frames * 1000.f / f_wall_ms : 0.f) << "\n";
+  std::cout << "}" << std::endl;
+
+  return b_ok;
+}
+
+int main(int argc, char** argv) {
+  ProgramConfig config{};
+  if (!ParseCommandLine(argc, argv, config)) {
+    return 1;
+  }
+
+  if (!config.s_trace_path.empty()) {
+    Tracer::Get().Enable(true);
+    Tracer::Get().SetThreadName("Main");
+  }
+
+  if (config.un_cull_benchmark_iterations > 0) {
+    return RunCullBenchmark(config) ? 0 : 1;
+  }
+
+  //written once the program is destroyed, so every thread that records has been joined
+  auto WriteTrace = [&]() {
+    if (!config.s_trace_path.empty() && Tracer::Get().WriteChromeTrace(config.s_trace_path)) {
+      std::cout << "[Program] Trace written to " << config.s_trace_path << std::endl;
+    }
+  };
+
+  if (config.b_headless) {
+    if (config.un_frame_count == 0) {
+      config.un_frame_count = HEADLESS_DEFAULT_FRAME_COUNT;
+    }
+
+    if (config.un_farm_contexts_per_device > 0) {
+      int n_result = RunFarm(config) ? 0 : 1;
+      WriteTrace();
+      return n_result;
+    }
+
+    int n_result = 0;
+    {
+      Program program(nullptr, config);
+      if (!program.Init() || !RunFrames(program, config, nullptr)) {
+        n_result = 1;
+      }
+    }
+
+    WriteTrace();
+    return n_result;
+  }
+
   glfwInit();
 
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+  glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
   GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Hello Vulkan", nullptr, nullptr);
 
+  int n_result = 0;
   {
-    Program program(window);
+    Program program(window, config);
     if (!program.Init()) {
       return 1;
     }
 
-    while (!glfwWindowShouldClose(window)) {
-      glfwPollEvents();
+    glfwSetWindowUserPointer(window, &program);
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow* p_window, int, int) {
+      static_cast<Program*>(glfwGetWindowUserPointer(p_window))->OnFramebufferResized();
+    });
 
-      program.Tick();
+    if (!RunFrames(program, config, window)) {
+      n_result = 1;
     }
   }
 
   glfwDestroyWindow(window);
   glfwTerminate();
 
-  return 0;
-}
\ No newline at end of file
+  WriteTrace();
+
+  return n_result;
+}
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
+#include "vulkan/vulkan.h"
+
+//how a resource is laid out in memory. linear and optimal resources never share a block when the device reports a
+//bufferImageGranularity above 1, which keeps neighbouring allocations from aliasing the same granularity page.
+enum class MemoryLayoutKind {
+  kLinear,   //buffers and linear-tiling images
+  kOptimal,  //optimal-tiling images
+};
+
+struct MemoryAllocation {
+  VkDeviceMemory vkmemory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+
+  //points at offset inside the persistently mapped block, null when the memory is not host visible
+  void* p_mapped = nullptr;
+
+  uint32_t un_memory_type = 0;
+  uint32_t un_pool = 0;
+  uint32_t un_block = 0;
+  bool b_dedicated = false;
+};
+
+struct MemoryArenaStats {
+  VkDeviceSize reserved_bytes = 0;  //sum of every VkDeviceMemory owned by the arena
+  VkDeviceSize used_bytes = 0;      //bytes handed out to live allocations
+  uint32_t un_device_memory_count = 0;  //vkAllocateMemory calls currently outstanding
+  uint32_t un_allocation_count = 0;
+
+  //1 - largest free range / total free bytes across the sub-allocated blocks, 0 means all free space is contiguous
+  float f_fragmentation = 0.f;
+
+  void WriteJson(std::ostream& out) const {
+    out << "{\"reserved_bytes\": " << reserved_bytes << ", \"used_bytes\": " << used_bytes
+        << ", \"device_memory_count\": " << un_device_memory_count
+        << ", \"allocation_count\": " << un_allocation_count << ", \"fragmentation\": " << f_fragmentation << "}";
+  }
+};
+
+//grabs large VkDeviceMemory blocks per memory type and sub-allocates resources out of them from a best-fit free list
+//with coalescing. per-frame data lives in a FrameRing instead.
+class DeviceMemoryArena : VkDeviceDispatch {
+ public:
+  static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+  bool Init(VkPhysicalDevice vkphysical_device, VkDevice vkdevice, const VkDeviceDispatch& dispatch,
+            VkDeviceSize block_size = DEFAULT_BLOCK_SIZE) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    m_block_size = block_size;
+
+    vkGetPhysicalDeviceMemoryProperties(vkphysical_device, &m_memory_properties);
+
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(vkphysical_device, &physical_device_properties);
+    m_buffer_image_granularity = physical_device_properties.limits.bufferImageGranularity;
+    m_non_coherent_atom_size = physical_device_properties.limits.nonCoherentAtomSize;
+
+    mv_pools.resize(m_memory_properties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < mv_pools.size(); i++) {
+      mv_pools[i].un_memory_type = i / 2;
+    }
+
+    return true;
+  }
+
+  void Destroy() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (Pool& pool : mv_pools) {
+      for (auto& block : pool.v_blocks) {
+        if (block) {
+          vkFreeMemory(m_vkdevice, block->vkmemory, nullptr);
+        }
+      }
+      pool.v_blocks.clear();
+    }
+
+    m_dedicated_reserved = 0;
+    m_undedicated_count = 0;
+  }
+
+  //picks the first memory type with all of the required and preferred flags, then any with just the required ones
+  std::optional<uint32_t> FindMemoryType(uint32_t un_type_bits, VkMemoryPropertyFlags required,
+                                         VkMemoryPropertyFlags preferred = 0) const {
+    for (VkMemoryPropertyFlags flags : {required | preferred, required}) {
+      for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++) {
+        if ((un_type_bits & (1u << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & flags) == flags) {
+          return i;
+        }
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  bool IsHostCoherent(uint32_t un_memory_type) const {
+    return m_memory_properties.memoryTypes[un_memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  }
+
+  VkDeviceSize GetNonCoherentAtomSize() const { return m_non_coherent_atom_size; }
+
+  bool Allocate(VkMemoryRequirements memory_requirements, VkMemoryPropertyFlags required,
+                VkMemoryPropertyFlags preferred, MemoryLayoutKind kind, MemoryAllocation& out_allocation) {
+    std::optional<uint32_t> opt_memory_type =
+        FindMemoryType(memory_requirements.memoryTypeBits, required, preferred);
+    if (!opt_memory_type.has_value()) {
+      std::cout << "[MemoryArena] No memory type with properties " << required << std::endl;
+      return false;
+    }
+    uint32_t un_memory_type = opt_memory_type.value();
+
+    //flushes and invalidates round out to whole atoms, which must never reach into a neighbouring allocation
+    VkMemoryPropertyFlags memory_type_flags = m_memory_properties.memoryTypes[un_memory_type].propertyFlags;
+    if ((memory_type_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+        !(memory_type_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+      memory_requirements.alignment = std::max(memory_requirements.alignment, m_non_coherent_atom_size);
+      memory_requirements.size = AlignUp(memory_requirements.size, m_non_coherent_atom_size);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    //anything larger than half a block would waste most of it, so it gets memory of its own
+    if (memory_requirements.size > GetBlockSize(un_memory_type) / 2) {
+      return AllocateDedicated(memory_requirements.size, un_memory_type, out_allocation);
+    }
+
+    uint32_t un_pool = un_memory_type * 2;
+    if (kind == MemoryLayoutKind::kOptimal && m_buffer_image_granularity > 1) {
+      un_pool++;
+    }
+    Pool& pool = mv_pools[un_pool];
+
+    for (uint32_t i = 0; i < pool.v_blocks.size(); i++) {
+      if (pool.v_blocks[i] && SubAllocate(*pool.v_blocks[i], memory_requirements, out_allocation)) {
+        out_allocation.un_memory_type = un_memory_type;
+        out_allocation.un_pool = un_pool;
+        out_allocation.un_block = i;
+        return true;
+      }
+    }
+
+    auto block = std::make_unique<Block>();
+    if (!AllocateDeviceMemory(GetBlockSize(un_memory_type), un_memory_type, block->vkmemory, block->p_mapped)) {
+      return false;
+    }
+    block->size = GetBlockSize(un_memory_type);
+    block->map_free_ranges[0] = block->size;
+
+    SubAllocate(*block, memory_requirements, out_allocation);
+    out_allocation.un_memory_type = un_memory_type;
+    out_allocation.un_pool = un_pool;
+    out_allocation.un_block = static_cast<uint32_t>(pool.v_blocks.size());
+    pool.v_blocks.push_back(std::move(block));
+
+    return true;
+  }
+
+  void Free(const MemoryAllocation& allocation) {
+    if (allocation.vkmemory == VK_NULL_HANDLE) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (allocation.b_dedicated) {
+      vkFreeMemory(m_vkdevice, allocation.vkmemory, nullptr);
+      m_dedicated_reserved -= allocation.size;
+      m_dedicated_used -= allocation.size;
+      m_undedicated_count--;
+      return;
+    }
+
+    std::unique_ptr<Block>& block = mv_pools[allocation.un_pool].v_blocks[allocation.un_block];
+    block->used -= allocation.size;
+    block->un_allocation_count--;
+
+    //insert the range back and merge it with its free neighbours
+    VkDeviceSize offset = allocation.offset;
+    VkDeviceSize size = allocation.size;
+
+    auto next = block->map_free_ranges.lower_bound(offset);
+    if (next != block->map_free_ranges.end() && offset + size == next->first) {
+      size += next->second;
+      next = block->map_free_ranges.erase(next);
+    }
+    if (next != block->map_free_ranges.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == offset) {
+        offset = prev->first;
+        size += prev->second;
+        block->map_free_ranges.erase(prev);
+      }
+    }
+    block->map_free_ranges[offset] = size;
+
+    //keep one empty block around per pool so a free/allocate pattern doesn't thrash vkAllocateMemory
+    if (block->un_allocation_count == 0) {
+      uint32_t un_empty_blocks = 0;
+      for (const auto& pool_block : mv_pools[allocation.un_pool].v_blocks) {
+        if (pool_block && pool_block->un_allocation_count == 0) {
+          un_empty_blocks++;
+        }
+      }
+      if (un_empty_blocks > 1) {
+        vkFreeMemory(m_vkdevice, block->vkmemory, nullptr);
+        block.reset();
+      }
+    }
+  }
+
+  bool CreateBuffer(const VkBufferCreateInfo& buffer_create_info, VkMemoryPropertyFlags required,
+                    VkMemoryPropertyFlags preferred, VkBuffer& out_buffer, MemoryAllocation& out_allocation) {
+    b_qualify_vk(vkCreateBuffer(m_vkdevice, &buffer_create_info, nullptr, &out_buffer));
+
+    VkMemoryRequirements memory_requirements;
+    vkGetBufferMemoryRequirements(m_vkdevice, out_buffer, &memory_requirements);
+
+    if (!Allocate(memory_requirements, required, preferred, MemoryLayoutKind::kLinear, out_allocation)) {
+      vkDestroyBuffer(m_vkdevice, out_buffer, nullptr);
+      out_buffer = VK_NULL_HANDLE;
+      return false;
+    }
+
+    VkResult result = vkBindBufferMemory(m_vkdevice, out_buffer, out_allocation.vkmemory, out_allocation.offset);
+    if (result != VK_SUCCESS) {
+      std::cout << "[MemoryArena] vkBindBufferMemory failed: " << result << std::endl;
+      DestroyBuffer(out_buffer, out_allocation);
+      out_buffer = VK_NULL_HANDLE;
+      return false;
+    }
+    return true;
+  }
+
+  bool CreateImage(const VkImageCreateInfo& image_create_info, VkMemoryPropertyFlags required,
+                   VkMemoryPropertyFlags preferred, VkImage& out_image, MemoryAllocation& out_allocation) {
+    b_qualify_vk(vkCreateImage(m_vkdevice, &image_create_info, nullptr, &out_image));
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(m_vkdevice, out_image, &memory_requirements);
+
+    MemoryLayoutKind kind =
+        image_create_info.tiling == VK_IMAGE_TILING_LINEAR ? MemoryLayoutKind::kLinear : MemoryLayoutKind::kOptimal;
+    if (!Allocate(memory_requirements, required, preferred, kind, out_allocation)) {
+      vkDestroyImage(m_vkdevice, out_image, nullptr);
+      out_image = VK_NULL_HANDLE;
+      return false;
+    }
+
+    VkResult result = vkBindImageMemory(m_vkdevice, out_image, out_allocation.vkmemory, out_allocation.offset);
+    if (result != VK_SUCCESS) {
+      std::cout << "[MemoryArena] vkBindImageMemory failed: " << result << std::endl;
+      DestroyImage(out_image, out_allocation);
+      out_image = VK_NULL_HANDLE;
+      return false;
+    }
+    return true;
+  }
+
+  void DestroyBuffer(VkBuffer buffer, const MemoryAllocation& allocation) {
+    vkDestroyBuffer(m_vkdevice, buffer, nullptr);
+    Free(allocation);
+  }
+
+  void DestroyImage(VkImage image, const MemoryAllocation& allocation) {
+    vkDestroyImage(m_vkdevice, image, nullptr);
+    Free(allocation);
+  }
+
+  //makes host writes visible to the device, a no-op for coherent memory
+  bool Flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (IsHostCoherent(allocation.un_memory_type)) {
+      return true;
+    }
+
+    VkMappedMemoryRange range = GetAtomAlignedRange(allocation, offset, size);
+    b_qualify_vk(vkFlushMappedMemoryRanges(m_vkdevice, 1, &range));
+    return true;
+  }
+
+  //makes device writes visible to the host, a no-op for coherent memory
+  bool Invalidate(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (IsHostCoherent(allocation.un_memory_type)) {
+      return true;
+    }
+
+    VkMappedMemoryRange range = GetAtomAlignedRange(allocation, offset, size);
+    b_qualify_vk(vkInvalidateMappedMemoryRanges(m_vkdevice, 1, &range));
+    return true;
+  }
+
+  MemoryArenaStats GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryArenaStats stats{};
+    stats.reserved_bytes = m_dedicated_reserved;
+    stats.used_bytes = m_dedicated_used;
+    stats.un_device_memory_count = m_undedicated_count;
+    stats.un_allocation_count = m_undedicated_count;
+
+    VkDeviceSize total_free = 0;
+    VkDeviceSize largest_free = 0;
+    for (const Pool& pool : mv_pools) {
+      for (const auto& block : pool.v_blocks) {
+        if (!block) {
+          continue;
+        }
+
+        stats.reserved_bytes += block->size;
+        stats.used_bytes += block->used;
+        stats.un_device_memory_count++;
+        stats.un_allocation_count += block->un_allocation_count;
+
+        for (const auto& [offset, size] : block->map_free_ranges) {
+          total_free += size;
+          largest_free = std::max(largest_free, size);
+        }
+      }
+    }
+    stats.f_fragmentation = total_free > 0 ? 1.f - static_cast<float>(largest_free) / total_free : 0.f;
+
+    return stats;
+  }
+
+ private:
+  struct Block {
+    VkDeviceMemory vkmemory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* p_mapped = nullptr;
+
+    std::map<VkDeviceSize, VkDeviceSize> map_free_ranges;  //offset -> size
+    VkDeviceSize used = 0;
+    uint32_t un_allocation_count = 0;
+  };
+
+  struct Pool {
+    uint32_t un_memory_type = 0;
+    std::vector<std::unique_ptr<Block>> v_blocks;  //freed blocks leave a null slot so indices stay stable
+  };
+
+  static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+  }
+
+  //small heaps, such as the 256MB BAR heap, get proportionally smaller blocks
+  VkDeviceSize GetBlockSize(uint32_t un_memory_type) const {
+    uint32_t un_heap = m_memory_properties.memoryTypes[un_memory_type].heapIndex;
+    VkDeviceSize heap_size = m_memory_properties.memoryHeaps[un_heap].size;
+    return std::min(m_block_size, std::max<VkDeviceSize>(heap_size / 8, 1024 * 1024));
+  }
+
+  VkMappedMemoryRange GetAtomAlignedRange(const MemoryAllocation& allocation, VkDeviceSize offset,
+                                          VkDeviceSize size) const {
+    VkDeviceSize begin = (allocation.offset + offset) / m_non_coherent_atom_size * m_non_coherent_atom_size;
+    VkDeviceSize end = AlignUp(allocation.offset + offset + size, m_non_coherent_atom_size);
+
+    return {
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .pNext = nullptr,
+        .memory = allocation.vkmemory,
+        .offset = begin,
+        .size = end - begin,
+    };
+  }
+
+  bool AllocateDeviceMemory(VkDeviceSize size, uint32_t un_memory_type, VkDeviceMemory& out_memory,
+                            void*& out_mapped) {
+    VkMemoryAllocateInfo memory_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .allocationSize = size,
+        .memoryTypeIndex = un_memory_type,
+    };
+    b_qualify_vk(vkAllocateMemory(m_vkdevice, &memory_allocate_info, nullptr, &out_memory));
+
+    out_mapped = nullptr;
+    if (m_memory_properties.memoryTypes[un_memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+      VkResult result = vkMapMemory(m_vkdevice, out_memory, 0, VK_WHOLE_SIZE, 0, &out_mapped);
+      if (result != VK_SUCCESS) {
+        std::cout << "[MemoryArena] vkMapMemory failed: " << result << std::endl;
+        vkFreeMemory(m_vkdevice, out_memory, nullptr);
+        out_memory = VK_NULL_HANDLE;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool AllocateDedicated(VkDeviceSize size, uint32_t un_memory_type, MemoryAllocation& out_allocation) {
+    VkDeviceMemory vkmemory;
+    void* p_mapped;
+    if (!AllocateDeviceMemory(size, un_memory_type, vkmemory, p_mapped)) {
+      return false;
+    }
+
+    m_dedicated_reserved += size;
+    m_dedicated_used += size;
+    m_undedicated_count++;
+
+    out_allocation = {
+        .vkmemory = vkmemory,
+        .offset = 0,
+        .size = size,
+        .p_mapped = p_mapped,
+        .un_memory_type = un_memory_type,
+        .un_pool = 0,
+        .un_block = 0,
+        .b_dedicated = true,
+    };
+
+    return true;
+  }
+
+  //best fit: the smallest free range that still holds the aligned allocation
+  bool SubAllocate(Block& block, const VkMemoryRequirements& memory_requirements, MemoryAllocation& out_allocation) {
+    auto best = block.map_free_ranges.end();
+    VkDeviceSize best_size = UINT64_MAX;
+
+    for (auto it = block.map_free_ranges.begin(); it != block.map_free_ranges.end(); ++it) {
+      VkDeviceSize aligned_offset = AlignUp(it->first, memory_requirements.alignment);
+      if (aligned_offset + memory_requirements.size <= it->first + it->second && it->second < best_size) {
+        best = it;
+        best_size = it->second;
+      }
+    }
+
+    if (best == block.map_free_ranges.end()) {
+      return false;
+    }
+
+    VkDeviceSize range_offset = best->first;
+    VkDeviceSize range_end = best->first + best->second;
+    VkDeviceSize aligned_offset = AlignUp(range_offset, memory_requirements.alignment);
+    block.map_free_ranges.erase(best);
+
+    //the alignment padding in front and the tail both stay on the free list
+    if (aligned_offset > range_offset) {
+      block.map_free_ranges[range_offset] = aligned_offset - range_offset;
+    }
+    if (aligned_offset + memory_requirements.size < range_end) {
+      block.map_free_ranges[aligned_offset + memory_requirements.size] =
+          range_end - (aligned_offset + memory_requirements.size);
+    }
+
+    block.used += memory_requirements.size;
+    block.un_allocation_count++;
+
+    out_allocation = {
+        .vkmemory = block.vkmemory,
+        .offset = aligned_offset,
+        .size = memory_requirements.size,
+        .p_mapped = block.p_mapped ? static_cast<char*>(block.p_mapped) + aligned_offset : nullptr,
+        .un_memory_type = 0,
+        .un_pool = 0,
+        .un_block = 0,
+        .b_dedicated = false,
+    };
+
+    return true;
+  }
+
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memory_properties{};
+  VkDeviceSize m_block_size = DEFAULT_BLOCK_SIZE;
+  VkDeviceSize m_buffer_image_granularity = 1;
+  VkDeviceSize m_non_coherent_atom_size = 1;
+
+  mutable std::mutex m_mutex;
+
+  std::vector<Pool> mv_pools;  //two per memory type, indexed memory_type * 2 + (optimal ? 1 : 0)
+
+  VkDeviceSize m_dedicated_reserved = 0;
+  VkDeviceSize m_dedicated_used = 0;
+  uint32_t m_undedicated_count = 0;
+};
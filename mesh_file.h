@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mesh_format.h"
+#include "vulkan/vulkan.h"
+
+static_assert(static_cast<VkFormat>(MeshStreamFormat::kR8G8B8A8Unorm) == VK_FORMAT_R8G8B8A8_UNORM);
+static_assert(static_cast<VkFormat>(MeshStreamFormat::kR16G16Snorm) == VK_FORMAT_R16G16_SNORM);
+static_assert(static_cast<VkFormat>(MeshStreamFormat::kR16G16B16A16Snorm) == VK_FORMAT_R16G16B16A16_SNORM);
+static_assert(static_cast<VkFormat>(MeshStreamFormat::kR16G16B16A16Sfloat) == VK_FORMAT_R16G16B16A16_SFLOAT);
+static_assert(static_cast<VkFormat>(MeshStreamFormat::kR32G32B32Sfloat) == VK_FORMAT_R32G32B32_SFLOAT);
+
+struct MeshLoadStats {
+  uint32_t un_vertex_count = 0;
+  uint32_t un_index_count = 0;
+  uint32_t un_lod_count = 0;
+  uint32_t un_meshlet_count = 0;
+  uint64_t un_bytes = 0;  //vertex and index bytes copied out of the mapping
+  float f_load_ms = 0.f;  //from opening the file until the last byte was in the staging ring
+
+  void WriteJson(std::ostream& out) const {
+    out << "{\"vertices\": " << un_vertex_count << ", \"indices\": " << un_index_count << ", \"lods\": " << un_lod_count
+        << ", \"meshlets\": " << un_meshlet_count << ", \"bytes\": " << un_bytes << ", \"load_ms\": " << f_load_ms
+        << ", \"mb_per_s\": " << (f_load_ms > 0.f ? un_bytes / (1024.0 * 1024.0) / (f_load_ms / 1000.0) : 0.0) << "}";
+  }
+};
+
+//read-only mapping of a .mesh file (mesh_format.h). Init only checks that the header and tables describe sections
+//inside the file, nothing is parsed or copied: the streams and indices are read straight out of the mapping, so the
+//first touch of a page is the only read of it and loading runs at the speed of the disk and the page cache
+class MeshFile {
+ public:
+  MeshFile() = default;
+  MeshFile(const MeshFile&) = delete;
+  MeshFile& operator=(const MeshFile&) = delete;
+  ~MeshFile() { Destroy(); }
+
+  bool Init(const std::string& s_path) {
+    if (!Map(s_path)) {
+      std::cerr << "[MeshFile] Could not map " << s_path << std::endl;
+      return false;
+    }
+
+    if (!Validate()) {
+      std::cerr << "[MeshFile] " << s_path << " is not a valid version " << MESH_FILE_VERSION << " mesh file"
+                << std::endl;
+      Destroy();
+      return false;
+    }
+    return true;
+  }
+
+  void Destroy() {
+#ifdef _WIN32
+    if (mp_data != nullptr) {
+      UnmapViewOfFile(mp_data);
+    }
+    if (m_hmapping != nullptr) {
+      CloseHandle(m_hmapping);
+    }
+    if (m_hfile != INVALID_HANDLE_VALUE) {
+      CloseHandle(m_hfile);
+    }
+    m_hmapping = nullptr;
+    m_hfile = INVALID_HANDLE_VALUE;
+#else
+    if (mp_data != nullptr) {
+      munmap(const_cast<uint8_t*>(mp_data), m_unsize);
+    }
+#endif
+    mp_data = nullptr;
+    m_unsize = 0;
+  }
+
+  const MeshFileHeader& GetHeader() const { return *reinterpret_cast<const MeshFileHeader*>(mp_data); }
+
+  const MeshStream& GetStream(uint32_t un_index) const {
+    return reinterpret_cast<const MeshStream*>(mp_data + GetHeader().streams.un_offset)[un_index];
+  }
+  const MeshLod& GetLod(uint32_t un_index) const {
+    return reinterpret_cast<const MeshLod*>(mp_data + GetHeader().lods.un_offset)[un_index];
+  }
+  const MeshMeshlet& GetMeshlet(uint32_t un_index) const {
+    return reinterpret_cast<const MeshMeshlet*>(mp_data + GetHeader().meshlets.un_offset)[un_index];
+  }
+
+  //pointer into the mapping, valid until Destroy
+  const void* GetSectionData(const MeshSection& section) const { return mp_data + section.un_offset; }
+
+  VkIndexType GetIndexType() const {
+    return GetHeader().un_index_size == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  }
+
+ private:
+  bool Map(const std::string& s_path) {
+#ifdef _WIN32
+    m_hfile = CreateFileA(s_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                          FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (m_hfile == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_hfile, &size) || size.QuadPart == 0) {
+      return false;
+    }
+    m_unsize = static_cast<uint64_t>(size.QuadPart);
+
+    m_hmapping = CreateFileMappingA(m_hfile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_hmapping == nullptr) {
+      return false;
+    }
+    mp_data = static_cast<const uint8_t*>(MapViewOfFile(m_hmapping, FILE_MAP_READ, 0, 0, 0));
+    return mp_data != nullptr;
+#else
+    int n_fd = open(s_path.c_str(), O_RDONLY);
+    if (n_fd < 0) {
+      return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(n_fd, &file_stat) != 0 || file_stat.st_size == 0) {
+      close(n_fd);
+      return false;
+    }
+    m_unsize = static_cast<uint64_t>(file_stat.st_size);
+
+    //the mapping keeps the file referenced, the descriptor is not needed past this
+    void* p_mapping = mmap(nullptr, m_unsize, PROT_READ, MAP_PRIVATE, n_fd, 0);
+    close(n_fd);
+    if (p_mapping == MAP_FAILED) {
+      m_unsize = 0;
+      return false;
+    }
+    mp_data = static_cast<const uint8_t*>(p_mapping);
+
+    //the sections are copied out front to back once, so aggressive readahead pays and pages can be dropped behind
+    madvise(p_mapping, m_unsize, MADV_SEQUENTIAL);
+    return true;
+#endif
+  }
+
+  //at least one triangle, every section aligned, inside the file and exactly the size its counts say, every lod and
+  //meshlet inside the index section
+  bool Validate() const {
+    if (m_unsize < sizeof(MeshFileHeader)) {
+      return false;
+    }
+    const MeshFileHeader& header = GetHeader();
+    if (header.un_magic != MESH_FILE_MAGIC || header.un_version != MESH_FILE_VERSION ||
+        (header.un_index_size != 2 && header.un_index_size != 4) || header.un_vertex_count == 0 ||
+        header.un_index_count == 0 || header.un_max_index >= header.un_vertex_count) {
+      return false;
+    }
+
+    if (!IsSectionValid(header.streams, uint64_t{header.un_stream_count} * sizeof(MeshStream)) ||
+        !IsSectionValid(header.indices, uint64_t{header.un_index_count} * header.un_index_size) ||
+        !IsSectionValid(header.lods, uint64_t{header.un_lod_count} * sizeof(MeshLod)) ||
+        !IsSectionValid(header.meshlets, uint64_t{header.un_meshlet_count} * sizeof(MeshMeshlet))) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < header.un_stream_count; i++) {
+      const MeshStream& stream = GetStream(i);
+      if (stream.un_stride == 0 || !IsSectionValid(stream.data, uint64_t{header.un_vertex_count} * stream.un_stride) ||
+          !IsStreamFormatKnown(stream.format)) {
+        return false;
+      }
+    }
+
+    auto IsIndexRangeValid = [&](uint32_t un_first, uint32_t un_count) {
+      return un_count % 3 == 0 && uint64_t{un_first} + un_count <= header.un_index_count;
+    };
+    for (uint32_t i = 0; i < header.un_lod_count; i++) {
+      const MeshLod& lod = GetLod(i);
+      if (!IsIndexRangeValid(lod.un_first_index, lod.un_index_count) ||
+          uint64_t{lod.un_first_meshlet} + lod.un_meshlet_count > header.un_meshlet_count) {
+        return false;
+      }
+    }
+    for (uint32_t i = 0; i < header.un_meshlet_count; i++) {
+      const MeshMeshlet& meshlet = GetMeshlet(i);
+      if (!IsIndexRangeValid(meshlet.un_first_index, meshlet.un_index_count)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //the formats are handed to the vertex input as they are, so nothing outside the enum may get through
+  static bool IsStreamFormatKnown(MeshStreamFormat format) {
+    switch (format) {
+      case MeshStreamFormat::kR8G8B8A8Unorm:
+      case MeshStreamFormat::kR16G16Snorm:
+      case MeshStreamFormat::kR16G16B16A16Snorm:
+      case MeshStreamFormat::kR16G16B16A16Sfloat:
+      case MeshStreamFormat::kR32G32B32Sfloat:
+        return true;
+    }
+    return false;
+  }
+
+  bool IsSectionValid(const MeshSection& section, uint64_t un_expected_size) const {
+    return section.un_offset % MESH_SECTION_ALIGNMENT == 0 && section.un_size == un_expected_size &&
+           section.un_offset <= m_unsize && section.un_size <= m_unsize - section.un_offset;
+  }
+
+  const uint8_t* mp_data = nullptr;
+  uint64_t m_unsize = 0;
+#ifdef _WIN32
+  HANDLE m_hfile = INVALID_HANDLE_VALUE;
+  HANDLE m_hmapping = nullptr;
+#endif
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+//on-disk layout of a .mesh file, written by tools/mesh_converter.cpp and read in place by MeshFile. the file is a
+//MeshFileHeader followed by the sections it points at. every section starts on a MESH_SECTION_ALIGNMENT boundary, so a
+//mapping of the file can be used as the structs below without copying or parsing. everything is little-endian
+const uint32_t MESH_FILE_MAGIC = 0x4853454d;  //"MESH"
+const uint32_t MESH_FILE_VERSION = 3;
+const uint64_t MESH_SECTION_ALIGNMENT = 64;
+
+//meshlet limits, the usual mesh shader sizes
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+//the values are the input locations of shaders/mesh.vert
+enum class MeshAttribute : uint32_t {
+  kPosition = 0,
+  kColor = 1,
+  kNormal = 2,
+};
+
+//element format of a vertex stream. the values are the VkFormat a vertex input attribute reads it with, so the vertex
+//fetch does the conversion to float and the shader only finishes the decode
+enum class MeshStreamFormat : uint32_t {
+  kR8G8B8A8Unorm = 37,       //colors
+  kR16G16Snorm = 78,         //octahedral unit normals
+  kR16G16B16A16Snorm = 92,   //positions
+  kR16G16B16A16Sfloat = 97,  //positions, finer than SNORM near the center of the bounding box
+  kR32G32B32Sfloat = 106,    //unquantized positions
+};
+
+//a byte range of the file
+struct MeshSection {
+  uint64_t un_offset;
+  uint64_t un_size;
+};
+
+//one attribute of every vertex, tightly packed at un_stride bytes per vertex
+struct MeshStream {
+  MeshAttribute attribute;
+  MeshStreamFormat format;
+  uint32_t un_stride;
+  uint32_t un_reserved;
+  MeshSection data;
+};
+
+//the index range drawing the whole mesh at one level of detail. lod 0 is the full mesh, every later one has fewer
+//triangles over the same vertices
+struct MeshLod {
+  uint32_t un_first_index;
+  uint32_t un_index_count;
+  uint32_t un_first_meshlet;
+  uint32_t un_meshlet_count;
+  float f_error;  //largest distance a vertex was moved by the simplification, in model units
+  uint32_t un_reserved[3];
+};
+
+//a run of at most MESHLET_MAX_TRIANGLES triangles of one lod touching at most MESHLET_MAX_VERTICES vertices, with a
+//bounding sphere in model units for culling
+struct MeshMeshlet {
+  uint32_t un_first_index;
+  uint32_t un_index_count;
+  float f_center[3];
+  float f_radius;
+};
+
+struct MeshFileHeader {
+  uint32_t un_magic;
+  uint32_t un_version;
+  uint32_t un_vertex_count;
+  uint32_t un_index_count;  //over every lod
+  uint32_t un_index_size;   //2 or 4 bytes
+  uint32_t un_stream_count;
+  uint32_t un_lod_count;
+  uint32_t un_meshlet_count;
+
+  //largest index of the index section, below un_vertex_count. the loader bounds every index through it instead of
+  //reading the indices
+  uint32_t un_max_index;
+  uint32_t un_reserved;
+
+  //positions of every format are stored inside the bounding box mapped to [-1, 1], and decode to
+  //position * f_position_scale + f_position_offset in model units
+  float f_position_scale[3];
+  float f_position_offset[3];
+
+  MeshSection streams;   //un_stream_count MeshStream
+  MeshSection indices;   //un_index_count indices of un_index_size bytes
+  MeshSection lods;      //un_lod_count MeshLod
+  MeshSection meshlets;  //un_meshlet_count MeshMeshlet
+};
+
+static_assert(std::is_trivially_copyable_v<MeshFileHeader> && sizeof(MeshFileHeader) == 128);
+static_assert(sizeof(MeshStream) == 32 && sizeof(MeshLod) == 32 && sizeof(MeshMeshlet) == 24);
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "trace.h"
+#include "vk_dispatch.h"
+#include "vulkan/vulkan.h"
+
+//compiles pipeline variants on background threads so a new variant never stalls a frame.
+//Get always returns something bindable: the fallback pipeline until the variant has been built and published.
+//publishing only happens in BeginFrame, so every command buffer recorded in a frame sees the same pipeline.
+//Request, BeginFrame and Get must be called from the render thread or from recording threads inside a frame, never
+//concurrently with BeginFrame or Request.
+class PipelineManager : VkDeviceDispatch {
+ public:
+  //specialization constant values, constant_id i takes element i in every stage
+  using VariantKey = std::vector<uint32_t>;
+
+  //builds the pipeline for a variant, called on a worker thread. it must only read state that outlives the manager
+  using BuildFn = std::function<bool(const VariantKey&, VkPipeline&)>;
+
+  void Init(VkDevice vkdevice, const VkDeviceDispatch& dispatch, uint32_t un_thread_count,
+            VkPipeline vkfallback_pipeline, BuildFn build_fn) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    m_vkfallback_pipeline = vkfallback_pipeline;
+    m_build_fn = std::move(build_fn);
+
+    for (uint32_t i = 0; i < un_thread_count; i++) {
+      mv_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+  }
+
+  //waits for builds in progress, drops queued ones and destroys every variant. the fallback belongs to the caller
+  void Destroy() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_bstopping = true;
+      mdq_queue.clear();
+    }
+    m_cv_work.notify_all();
+
+    for (std::thread& worker : mv_workers) {
+      worker.join();
+    }
+    mv_workers.clear();
+
+    BeginFrame();
+    for (VkPipeline pipeline : mv_published) {
+      if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_vkdevice, pipeline, nullptr);
+      }
+    }
+    mv_published.clear();
+    mv_keys.clear();
+  }
+
+  //returns the variant's id, queueing a build the first time a key is seen
+  uint32_t Request(const VariantKey& key) {
+    for (uint32_t i = 0; i < mv_keys.size(); i++) {
+      if (mv_keys[i] == key) {
+        return i;
+      }
+    }
+
+    uint32_t un_variant = static_cast<uint32_t>(mv_keys.size());
+    mv_keys.push_back(key);
+    mv_published.push_back(VK_NULL_HANDLE);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      mdq_queue.push_back({un_variant, key});
+    }
+    m_cv_work.notify_one();
+
+    return un_variant;
+  }
+
+  //publishes variants that finished building since the previous frame
+  void BeginFrame() {
+    std::vector<std::pair<uint32_t, VkPipeline>> v_completed;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      v_completed.swap(mv_completed);
+    }
+
+    for (const auto& [un_variant, pipeline] : v_completed) {
+      mv_published[un_variant] = pipeline;
+    }
+  }
+
+  VkPipeline Get(uint32_t un_variant) const {
+    VkPipeline pipeline = un_variant < mv_published.size() ? mv_published[un_variant] : VK_NULL_HANDLE;
+    return pipeline != VK_NULL_HANDLE ? pipeline : m_vkfallback_pipeline;
+  }
+
+  bool IsReady(uint32_t un_variant) const {
+    return un_variant < mv_published.size() && mv_published[un_variant] != VK_NULL_HANDLE;
+  }
+
+ private:
+  void WorkerLoop() {
+    Tracer::Get().SetThreadName("Pipeline worker");
+
+    while (true) {
+      std::pair<uint32_t, VariantKey> job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv_work.wait(lock, [this]() { return m_bstopping || !mdq_queue.empty(); });
+        if (m_bstopping) {
+          return;
+        }
+        job = std::move(mdq_queue.front());
+        mdq_queue.pop_front();
+      }
+
+      auto build_start = std::chrono::steady_clock::now();
+      VkPipeline pipeline = VK_NULL_HANDLE;
+      bool b_built;
+      {
+        TRACE_SCOPE("BuildPipeline");
+        b_built = m_build_fn(job.second, pipeline);
+      }
+      if (!b_built) {
+        //the fallback keeps being served for this variant
+        std::cout << "[PipelineManager] Failed to build variant " << job.first << std::endl;
+        continue;
+      }
+
+      std::cout << "[PipelineManager] Variant " << job.first << " built in "
+                << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - build_start).count()
+                << "ms" << std::endl;
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      mv_completed.push_back({job.first, pipeline});
+    }
+  }
+
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  VkPipeline m_vkfallback_pipeline = VK_NULL_HANDLE;
+  BuildFn m_build_fn;
+
+  //render thread only
+  std::vector<VariantKey> mv_keys;
+  std::vector<VkPipeline> mv_published;
+
+  std::vector<std::thread> mv_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_cv_work;
+  std::deque<std::pair<uint32_t, VariantKey>> mdq_queue;
+  std::vector<std::pair<uint32_t, VkPipeline>> mv_completed;
+  bool m_bstopping = false;
+};
@@ -0,0 +1,670 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <ostream>
+#include <vector>
+
+#include "memory_arena.h"
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
+#include "vulkan/vulkan.h"
+
+//how a pass touches a resource
+enum class RenderGraphAccess {
+  kColorAttachmentWrite,
+  kTransferRead,
+  kTransferWrite,
+  kComputeRead,
+  kComputeWrite,
+  kComputeReadWrite,  //atomics and other read-modify-writes
+  kIndirectRead,
+  kVertexShaderRead,
+  kFragmentShaderRead,
+};
+
+struct RenderGraphStats {
+  uint32_t un_pass_count = 0;
+  uint32_t un_barrier_batches = 0;  //barrier commands recorded per frame
+  uint32_t un_image_barriers = 0;
+  uint32_t un_buffer_barriers = 0;
+  VkDeviceSize transient_bytes = 0;          //the transient images laid out side by side
+  VkDeviceSize transient_aliased_bytes = 0;  //the memory they actually share
+
+  void WriteJson(std::ostream& out) const {
+    out << "{\"passes\": " << un_pass_count << ", \"barrier_batches\": " << un_barrier_batches
+        << ", \"image_barriers\": " << un_image_barriers << ", \"buffer_barriers\": " << un_buffer_barriers
+        << ", \"transient_bytes\": " << transient_bytes << ", \"transient_aliased_bytes\": " << transient_aliased_bytes
+        << "}";
+  }
+};
+
+//a frame's passes in submission order, each declaring the resources it reads and writes. Compile walks the
+//declarations once per topology and works out every layout transition and hazard, batching the barriers a pass needs
+//into one command recorded right before it. consecutive reads in the same layout share one barrier, and writes are
+//only waited on by the stages that have not seen them yet.
+//transient images live only inside the frame. images whose pass ranges do not overlap are bound to the same memory,
+//the first use of each waits on whatever last touched its bytes, including itself in the previous frame.
+//barriers go through vkCmdPipelineBarrier2 when synchronization2 is enabled, otherwise vkCmdPipelineBarrier. the
+//access table only uses flags both APIs define, so the legacy path can narrow them to 32 bits
+class RenderGraph : VkDeviceDispatch {
+ public:
+  using Resource = uint32_t;
+
+  //records the pass, returns false if recording failed
+  using PassFn = std::function<bool(VkCommandBuffer)>;
+
+  //the state of an imported resource before the first pass and after the last one. layout is ignored for buffers
+  struct ExternalState {
+    VkImageLayout layout;
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+  };
+
+  struct PassAccess {
+    Resource resource;
+    RenderGraphAccess access;
+  };
+
+  //everything one compile created for its transient images
+  struct Transients {
+    std::vector<VkImage> v_images;
+    std::vector<VkImageView> v_image_views;
+    MemoryAllocation allocation;
+  };
+
+  void Init(VkDevice vkdevice, const VkDeviceDispatch& dispatch, DeviceMemoryArena& memory_arena,
+            bool b_synchronization2) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    mp_memory_arena = &memory_arena;
+    m_bsynchronization2 = b_synchronization2 && vkCmdPipelineBarrier2 != nullptr;
+  }
+
+  void Destroy() {
+    DestroyTransients(m_transients);
+    m_transients = {};
+  }
+
+  bool IsSynchronization2() const { return m_bsynchronization2; }
+
+  //starts declaring a new topology. frames in flight may still use the previous transients, so they are handed back
+  //for the caller to destroy with DestroyTransients once those frames have completed
+  Transients Reset() {
+    mv_resources.clear();
+    mv_passes.clear();
+    mv_final_barriers.clear();
+    m_stats = {};
+
+    Transients transients = std::move(m_transients);
+    m_transients = {};
+    return transients;
+  }
+
+  void DestroyTransients(const Transients& transients) {
+    for (VkImageView image_view : transients.v_image_views) {
+      vkDestroyImageView(m_vkdevice, image_view, nullptr);
+    }
+    for (VkImage image : transients.v_images) {
+      vkDestroyImage(m_vkdevice, image, nullptr);
+    }
+    mp_memory_arena->Free(transients.allocation);
+  }
+
+  //an image owned outside the graph. the handle is bound every frame with BindImage, it may change between frames
+  Resource ImportImage(const char* p_name, VkImageAspectFlags aspect, ExternalState initial, ExternalState final) {
+    mv_resources.push_back({
+        .p_name = p_name,
+        .b_image = true,
+        .b_transient = false,
+        .aspect = aspect,
+        .initial = initial,
+        .final = final,
+    });
+    return static_cast<Resource>(mv_resources.size() - 1);
+  }
+
+  Resource ImportBuffer(const char* p_name, ExternalState initial, ExternalState final) {
+    mv_resources.push_back({
+        .p_name = p_name,
+        .b_image = false,
+        .b_transient = false,
+        .aspect = 0,
+        .initial = {VK_IMAGE_LAYOUT_UNDEFINED, initial.stages, initial.access},
+        .final = {VK_IMAGE_LAYOUT_UNDEFINED, final.stages, final.access},
+    });
+    return static_cast<Resource>(mv_resources.size() - 1);
+  }
+
+  //an image created by Compile whose contents do not survive the frame. usage should include
+  //VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT when it is only ever an attachment
+  Resource CreateTransientImage(const char* p_name, const VkImageCreateInfo& image_create_info,
+                                VkImageAspectFlags aspect) {
+    mv_resources.push_back({
+        .p_name = p_name,
+        .b_image = true,
+        .b_transient = true,
+        .aspect = aspect,
+        .initial = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE},
+        .final = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE},
+        .image_create_info = image_create_info,
+    });
+    return static_cast<Resource>(mv_resources.size() - 1);
+  }
+
+  //passes run in the order they are added. a resource may appear once per pass
+  void AddPass(const char* p_name, std::vector<PassAccess> v_accesses, PassFn fn) {
+    mv_passes.push_back({
+        .p_name = p_name,
+        .v_accesses = std::move(v_accesses),
+        .fn = std::move(fn),
+    });
+  }
+
+  bool Compile() {
+    if (!CreateTransients()) {
+      return false;
+    }
+
+    //the state each resource is left in by the accesses walked so far
+    struct State {
+      VkImageLayout layout;
+      VkPipelineStageFlags2 write_stages;
+      VkAccessFlags2 write_access;
+      VkPipelineStageFlags2 read_stages;     //stages that read since the last write
+      VkPipelineStageFlags2 visible_stages;  //stages the last write has been made visible to
+    };
+    std::vector<State> v_states(mv_resources.size());
+    for (size_t i = 0; i < mv_resources.size(); i++) {
+      v_states[i] = {
+          .layout = mv_resources[i].initial.layout,
+          .write_stages = mv_resources[i].initial.stages,
+          .write_access = mv_resources[i].initial.access,
+          .read_stages = VK_PIPELINE_STAGE_2_NONE,
+          .visible_stages = VK_PIPELINE_STAGE_2_NONE,
+      };
+    }
+
+    //the first use of a transient has to wait on whatever uses its memory last, which is only known at the end
+    std::vector<std::pair<size_t, size_t>> v_first_transient_uses{};  //(pass, barrier)
+    std::vector<bool> v_bused(mv_resources.size(), false);
+
+    for (size_t un_pass = 0; un_pass < mv_passes.size(); un_pass++) {
+      Pass& pass = mv_passes[un_pass];
+      for (const PassAccess& pass_access : pass.v_accesses) {
+        const ResourceInfo& resource = mv_resources[pass_access.resource];
+        State& state = v_states[pass_access.resource];
+        AccessInfo access = GetAccessInfo(pass_access.access, resource.b_image);
+
+        bool b_first_transient_use = resource.b_transient && !v_bused[pass_access.resource];
+        v_bused[pass_access.resource] = true;
+
+        bool b_layout_change = resource.b_image && state.layout != access.layout;
+        Barrier barrier = {
+            .resource = pass_access.resource,
+            .src_stages = state.write_stages,
+            .src_access = state.write_access,
+            .dst_stages = access.stages,
+            .dst_access = access.access,
+            .old_layout = b_first_transient_use ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout,
+            .new_layout = resource.b_image ? access.layout : VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        bool b_barrier;
+        if (access.b_write || b_layout_change) {
+          //a layout transition is a write too, so earlier readers have to finish before it
+          barrier.src_stages |= state.read_stages;
+          b_barrier = b_first_transient_use || b_layout_change || barrier.src_stages != VK_PIPELINE_STAGE_2_NONE;
+        } else {
+          b_barrier = state.write_stages != VK_PIPELINE_STAGE_2_NONE &&
+                      (state.visible_stages & access.stages) != access.stages;
+        }
+
+        if (access.b_write) {
+          state = {
+              .layout = barrier.new_layout,
+              .write_stages = access.stages,
+              .write_access = access.access,
+              .read_stages = VK_PIPELINE_STAGE_2_NONE,
+              .visible_stages = VK_PIPELINE_STAGE_2_NONE,
+          };
+        } else if (b_layout_change) {
+          //later readers in other stages only need to wait for the transition, it made the data visible already
+          state = {
+              .layout = barrier.new_layout,
+              .write_stages = access.stages,
+              .write_access = VK_ACCESS_2_NONE,
+              .read_stages = access.stages,
+              .visible_stages = access.stages,
+          };
+        } else {
+          state.read_stages |= access.stages;
+          if (b_barrier) {
+            state.visible_stages |= access.stages;
+          }
+        }
+
+        if (b_barrier) {
+          if (b_first_transient_use) {
+            v_first_transient_uses.push_back({un_pass, pass.v_barriers.size()});
+          }
+          pass.v_barriers.push_back(barrier);
+        }
+      }
+    }
+
+    for (const auto& [un_pass, un_barrier] : v_first_transient_uses) {
+      Barrier& barrier = mv_passes[un_pass].v_barriers[un_barrier];
+      barrier.src_stages = VK_PIPELINE_STAGE_2_NONE;
+      barrier.src_access = VK_ACCESS_2_NONE;
+
+      for (Resource i = 0; i < mv_resources.size(); i++) {
+        if (mv_resources[i].b_transient && v_bused[i] && SharesMemory(barrier.resource, i)) {
+          barrier.src_stages |= v_states[i].write_stages | v_states[i].read_stages;
+          barrier.src_access |= v_states[i].write_access;
+        }
+      }
+    }
+
+    //imported resources are handed back in the state the code outside the graph expects
+    for (Resource i = 0; i < mv_resources.size(); i++) {
+      const ResourceInfo& resource = mv_resources[i];
+      const State& state = v_states[i];
+      if (resource.b_transient || !v_bused[i]) {
+        continue;
+      }
+
+      bool b_layout_change = resource.b_image && state.layout != resource.final.layout;
+      bool b_hazard = state.write_access != VK_ACCESS_2_NONE && resource.final.stages != VK_PIPELINE_STAGE_2_NONE;
+      if (b_layout_change || b_hazard) {
+        mv_final_barriers.push_back({
+            .resource = i,
+            .src_stages = state.write_stages | (b_layout_change ? state.read_stages : VK_PIPELINE_STAGE_2_NONE),
+            .src_access = state.write_access,
+            .dst_stages = resource.final.stages,
+            .dst_access = resource.final.access,
+            .old_layout = state.layout,
+            .new_layout = resource.final.layout,
+        });
+      }
+    }
+
+    m_stats.un_pass_count = static_cast<uint32_t>(mv_passes.size());
+    auto CountBatch = [&](const std::vector<Barrier>& v_barriers) {
+      if (!v_barriers.empty()) {
+        m_stats.un_barrier_batches++;
+      }
+      for (const Barrier& barrier : v_barriers) {
+        (mv_resources[barrier.resource].b_image ? m_stats.un_image_barriers : m_stats.un_buffer_barriers)++;
+      }
+    };
+    for (const Pass& pass : mv_passes) {
+      CountBatch(pass.v_barriers);
+    }
+    CountBatch(mv_final_barriers);
+
+    return true;
+  }
+
+  void BindImage(Resource resource, VkImage vkimage) { mv_resources[resource].vkimage = vkimage; }
+  void BindBuffer(Resource resource, VkBuffer vkbuffer) { mv_resources[resource].vkbuffer = vkbuffer; }
+
+  //only valid for transient images, after Compile
+  VkImageView GetImageView(Resource resource) const {
+    return m_transients.v_image_views[mv_resources[resource].un_transient];
+  }
+
+  //records every pass with its barriers, then the transitions back to the imported resources' final states
+  bool Execute(VkCommandBuffer vkcommand_buffer) {
+    for (const Pass& pass : mv_passes) {
+      RecordBarriers(vkcommand_buffer, pass.v_barriers);
+      if (!pass.fn(vkcommand_buffer)) {
+        std::cout << "[RenderGraph] Pass " << pass.p_name << " failed to record" << std::endl;
+        return false;
+      }
+    }
+    RecordBarriers(vkcommand_buffer, mv_final_barriers);
+
+    return true;
+  }
+
+  const RenderGraphStats& GetStats() const { return m_stats; }
+
+ private:
+  struct ResourceInfo {
+    const char* p_name;
+    bool b_image;
+    bool b_transient;
+    VkImageAspectFlags aspect;
+    ExternalState initial;
+    ExternalState final;
+
+    VkImageCreateInfo image_create_info{};  //transient images only
+    uint32_t un_transient = UINT32_MAX;     //index into m_transients
+    VkDeviceSize memory_offset = 0;         //into m_transients.allocation
+    VkDeviceSize memory_size = 0;
+    uint32_t un_first_pass = UINT32_MAX;
+    uint32_t un_last_pass = 0;
+
+    VkImage vkimage = VK_NULL_HANDLE;
+    VkBuffer vkbuffer = VK_NULL_HANDLE;
+  };
+
+  struct Barrier {
+    Resource resource;
+    VkPipelineStageFlags2 src_stages;
+    VkAccessFlags2 src_access;
+    VkPipelineStageFlags2 dst_stages;
+    VkAccessFlags2 dst_access;
+    VkImageLayout old_layout;
+    VkImageLayout new_layout;
+  };
+
+  struct Pass {
+    const char* p_name;
+    std::vector<PassAccess> v_accesses;
+    PassFn fn;
+    std::vector<Barrier> v_barriers;  //recorded right before the pass
+  };
+
+  struct AccessInfo {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+    bool b_write;
+  };
+
+  static AccessInfo GetAccessInfo(RenderGraphAccess access, bool b_image) {
+    switch (access) {
+      case RenderGraphAccess::kColorAttachmentWrite:
+        return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+      case RenderGraphAccess::kTransferRead:
+        return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                b_image ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, false};
+      case RenderGraphAccess::kTransferWrite:
+        return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                b_image ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, true};
+      case RenderGraphAccess::kComputeRead:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                b_image ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED, false};
+      case RenderGraphAccess::kComputeWrite:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                b_image ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED, true};
+      case RenderGraphAccess::kComputeReadWrite:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                b_image ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED, true};
+      case RenderGraphAccess::kIndirectRead:
+        return {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, false};
+      case RenderGraphAccess::kVertexShaderRead:
+        return {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                b_image ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, false};
+      case RenderGraphAccess::kFragmentShaderRead:
+        return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                b_image ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, false};
+    }
+
+    return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, true};
+  }
+
+  static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+  }
+
+  bool LifetimesOverlap(Resource a, Resource b) const {
+    return mv_resources[a].un_first_pass <= mv_resources[b].un_last_pass &&
+           mv_resources[b].un_first_pass <= mv_resources[a].un_last_pass;
+  }
+
+  bool SharesMemory(Resource a, Resource b) const {
+    const ResourceInfo& resource_a = mv_resources[a];
+    const ResourceInfo& resource_b = mv_resources[b];
+    return resource_a.memory_offset < resource_b.memory_offset + resource_b.memory_size &&
+           resource_b.memory_offset < resource_a.memory_offset + resource_a.memory_size;
+  }
+
+  //creates the transient images and packs them into one allocation, largest first. each image goes at the lowest
+  //offset that does not collide with an already placed image whose passes overlap its own
+  bool CreateTransients() {
+    std::vector<Resource> v_transients{};
+    for (Resource i = 0; i < mv_resources.size(); i++) {
+      if (mv_resources[i].b_transient) {
+        v_transients.push_back(i);
+      }
+    }
+    if (v_transients.empty()) {
+      return true;
+    }
+
+    for (uint32_t un_pass = 0; un_pass < mv_passes.size(); un_pass++) {
+      for (const PassAccess& pass_access : mv_passes[un_pass].v_accesses) {
+        ResourceInfo& resource = mv_resources[pass_access.resource];
+        resource.un_first_pass = std::min(resource.un_first_pass, un_pass);
+        resource.un_last_pass = std::max(resource.un_last_pass, un_pass);
+      }
+    }
+
+    VkMemoryRequirements heap_requirements = {
+        .size = 0,
+        .alignment = 1,
+        .memoryTypeBits = UINT32_MAX,
+    };
+    std::vector<VkMemoryRequirements> v_requirements(mv_resources.size());
+    for (Resource i : v_transients) {
+      ResourceInfo& resource = mv_resources[i];
+      resource.un_transient = static_cast<uint32_t>(m_transients.v_images.size());
+
+      VkImage vkimage;
+      b_qualify_vk(vkCreateImage(m_vkdevice, &resource.image_create_info, nullptr, &vkimage));
+      m_transients.v_images.push_back(vkimage);
+      resource.vkimage = vkimage;
+
+      vkGetImageMemoryRequirements(m_vkdevice, vkimage, &v_requirements[i]);
+      heap_requirements.alignment = std::max(heap_requirements.alignment, v_requirements[i].alignment);
+      heap_requirements.memoryTypeBits &= v_requirements[i].memoryTypeBits;
+      resource.memory_size = v_requirements[i].size;
+      m_stats.transient_bytes += v_requirements[i].size;
+    }
+
+    if (heap_requirements.memoryTypeBits == 0) {
+      std::cout << "[RenderGraph] Transient images have no memory type in common" << std::endl;
+      return false;
+    }
+
+    std::vector<Resource> v_order = v_transients;
+    std::stable_sort(v_order.begin(), v_order.end(),
+                     [&](Resource a, Resource b) { return v_requirements[a].size > v_requirements[b].size; });
+
+    std::vector<Resource> v_placed{};
+    for (Resource i : v_order) {
+      ResourceInfo& resource = mv_resources[i];
+      resource.memory_offset = 0;
+
+      bool b_moved = true;
+      while (b_moved) {
+        b_moved = false;
+        for (Resource placed : v_placed) {
+          if (LifetimesOverlap(i, placed) && SharesMemory(i, placed)) {
+            const ResourceInfo& placed_resource = mv_resources[placed];
+            resource.memory_offset =
+                AlignUp(placed_resource.memory_offset + placed_resource.memory_size, v_requirements[i].alignment);
+            b_moved = true;
+          }
+        }
+      }
+
+      v_placed.push_back(i);
+      heap_requirements.size = std::max(heap_requirements.size, resource.memory_offset + resource.memory_size);
+    }
+    m_stats.transient_aliased_bytes = heap_requirements.size;
+
+    if (!mp_memory_arena->Allocate(heap_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                                   MemoryLayoutKind::kOptimal, m_transients.allocation)) {
+      std::cout << "[RenderGraph] Could not allocate " << heap_requirements.size << " bytes of transient memory"
+                << std::endl;
+      return false;
+    }
+
+    for (Resource i : v_transients) {
+      ResourceInfo& resource = mv_resources[i];
+      b_qualify_vk(vkBindImageMemory(m_vkdevice, resource.vkimage, m_transients.allocation.vkmemory,
+                                     m_transients.allocation.offset + resource.memory_offset));
+
+      VkImageViewCreateInfo image_view_create_info = {
+          .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .image = resource.vkimage,
+          .viewType = VK_IMAGE_VIEW_TYPE_2D,
+          .format = resource.image_create_info.format,
+          .components =
+              {
+                  .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+              },
+          .subresourceRange =
+              {
+                  .aspectMask = resource.aspect,
+                  .baseMipLevel = 0,
+                  .levelCount = 1,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1,
+              },
+      };
+      VkImageView vkimage_view;
+      b_qualify_vk(vkCreateImageView(m_vkdevice, &image_view_create_info, nullptr, &vkimage_view));
+      m_transients.v_image_views.push_back(vkimage_view);
+    }
+
+    return true;
+  }
+
+  void RecordBarriers(VkCommandBuffer vkcommand_buffer, const std::vector<Barrier>& v_barriers) {
+    if (v_barriers.empty()) {
+      return;
+    }
+
+    if (m_bsynchronization2) {
+      std::vector<VkImageMemoryBarrier2> v_image_barriers{};
+      std::vector<VkBufferMemoryBarrier2> v_buffer_barriers{};
+      for (const Barrier& barrier : v_barriers) {
+        const ResourceInfo& resource = mv_resources[barrier.resource];
+        if (resource.b_image) {
+          v_image_barriers.push_back({
+              .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+              .pNext = nullptr,
+              .srcStageMask = barrier.src_stages,
+              .srcAccessMask = barrier.src_access,
+              .dstStageMask = barrier.dst_stages,
+              .dstAccessMask = barrier.dst_access,
+              .oldLayout = barrier.old_layout,
+              .newLayout = barrier.new_layout,
+              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+              .image = resource.vkimage,
+              .subresourceRange = GetSubresourceRange(resource),
+          });
+        } else {
+          v_buffer_barriers.push_back({
+              .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+              .pNext = nullptr,
+              .srcStageMask = barrier.src_stages,
+              .srcAccessMask = barrier.src_access,
+              .dstStageMask = barrier.dst_stages,
+              .dstAccessMask = barrier.dst_access,
+              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+              .buffer = resource.vkbuffer,
+              .offset = 0,
+              .size = VK_WHOLE_SIZE,
+          });
+        }
+      }
+
+      VkDependencyInfo dependency_info = {
+          .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+          .pNext = nullptr,
+          .dependencyFlags = 0,
+          .memoryBarrierCount = 0,
+          .pMemoryBarriers = nullptr,
+          .bufferMemoryBarrierCount = static_cast<uint32_t>(v_buffer_barriers.size()),
+          .pBufferMemoryBarriers = v_buffer_barriers.data(),
+          .imageMemoryBarrierCount = static_cast<uint32_t>(v_image_barriers.size()),
+          .pImageMemoryBarriers = v_image_barriers.data(),
+      };
+      vkCmdPipelineBarrier2(vkcommand_buffer, &dependency_info);
+      return;
+    }
+
+    //one legacy barrier command has a single pair of stage masks, the union of every barrier's
+    VkPipelineStageFlags src_stages = 0;
+    VkPipelineStageFlags dst_stages = 0;
+    std::vector<VkImageMemoryBarrier> v_image_barriers{};
+    std::vector<VkBufferMemoryBarrier> v_buffer_barriers{};
+    for (const Barrier& barrier : v_barriers) {
+      const ResourceInfo& resource = mv_resources[barrier.resource];
+      src_stages |= static_cast<VkPipelineStageFlags>(barrier.src_stages);
+      dst_stages |= static_cast<VkPipelineStageFlags>(barrier.dst_stages);
+
+      if (resource.b_image) {
+        v_image_barriers.push_back({
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = static_cast<VkAccessFlags>(barrier.src_access),
+            .dstAccessMask = static_cast<VkAccessFlags>(barrier.dst_access),
+            .oldLayout = barrier.old_layout,
+            .newLayout = barrier.new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = resource.vkimage,
+            .subresourceRange = GetSubresourceRange(resource),
+        });
+      } else {
+        v_buffer_barriers.push_back({
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = static_cast<VkAccessFlags>(barrier.src_access),
+            .dstAccessMask = static_cast<VkAccessFlags>(barrier.dst_access),
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = resource.vkbuffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        });
+      }
+    }
+
+    //the legacy API has no NONE stage
+    vkCmdPipelineBarrier(vkcommand_buffer, src_stages != 0 ? src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         dst_stages != 0 ? dst_stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(v_buffer_barriers.size()), v_buffer_barriers.data(),
+                         static_cast<uint32_t>(v_image_barriers.size()), v_image_barriers.data());
+  }
+
+  static VkImageSubresourceRange GetSubresourceRange(const ResourceInfo& resource) {
+    return {
+        .aspectMask = resource.aspect,
+        .baseMipLevel = 0,
+        .levelCount = VK_REMAINING_MIP_LEVELS,
+        .baseArrayLayer = 0,
+        .layerCount = VK_REMAINING_ARRAY_LAYERS,
+    };
+  }
+
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  DeviceMemoryArena* mp_memory_arena = nullptr;
+  bool m_bsynchronization2 = false;
+
+  std::vector<ResourceInfo> mv_resources;
+  std::vector<Pass> mv_passes;
+  std::vector<Barrier> mv_final_barriers;
+
+  Transients m_transients;
+  RenderGraphStats m_stats;
+};
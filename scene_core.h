@@ -0,0 +1,327 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "thread_pool.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SCENE_CORE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//GCC and Clang only emit AVX2 instructions in functions marked for it, MSVC emits them anywhere. either way the AVX2
+//kernel only runs after the CPU has been checked for it
+#if defined(SCENE_CORE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SCENE_CORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCENE_CORE_TARGET_AVX2
+#endif
+
+//matches InstanceData in shaders/hello.vert
+struct InstanceData {
+  glm::vec4 transform;  //xy offset, z scale, w rotation in radians
+  glm::vec4 color;
+};
+
+//the triangle in hello.vert reaches (+-0.5, 0.5) at scale 1, rotation keeps it inside this radius. matches
+//TRIANGLE_RADIUS in shaders/cull.comp
+const float INSTANCE_BOUNDING_RADIUS = 0.70710678f;
+
+enum class SceneKernel {
+  kScalar,
+  kSse,   //4 instances per step, every x86-64 CPU has SSE2
+  kAvx2,  //8 instances per step, picked at runtime
+};
+
+//heap array starting on a cache line, so SIMD loads are aligned and chunks on different threads never share a line
+template <typename T>
+class CacheAlignedArray {
+  static_assert(std::is_trivial_v<T>, "elements are not constructed");
+
+ public:
+  static constexpr size_t ALIGNMENT = 64;
+
+  //drops the previous contents
+  void Resize(size_t un_count) {
+    mp_data.reset(static_cast<T*>(::operator new[](un_count * sizeof(T), std::align_val_t{ALIGNMENT})));
+    m_uncount = un_count;
+  }
+
+  size_t size() const { return m_uncount; }
+  T* data() { return mp_data.get(); }
+  const T* data() const { return mp_data.get(); }
+  T& operator[](size_t i) { return mp_data.get()[i]; }
+  const T& operator[](size_t i) const { return mp_data.get()[i]; }
+
+ private:
+  struct Deleter {
+    void operator()(T* p) const { ::operator delete[](p, std::align_val_t{ALIGNMENT}); }
+  };
+
+  std::unique_ptr<T, Deleter> mp_data;
+  size_t m_uncount = 0;
+};
+
+//CPU copy of the instances in structure-of-arrays form, culled against the view frustum every frame for devices that
+//cannot cull on the GPU. the frustum test reads only the positions and radii, a few contiguous floats per instance,
+//and runs 4 or 8 instances per instruction. survivors are written to the output, usually the frame's mapped region
+//of the instance ring, with their rotation advanced to the frame's time. the instances lie in the z = 0 plane
+class SceneCore {
+ public:
+  //instances per SIMD step of the widest kernel, the arrays are padded to a multiple of it
+  static constexpr uint32_t SIMD_WIDTH = 8;
+
+  //instances per ParallelFor chunk, a multiple of 64 so every chunk's visibility mask is whole words
+  static constexpr uint32_t CHUNK_SIZE = 4096;
+
+  //normalized clip planes, xyz the normal and w the distance. a sphere is outside if it is behind any of them
+  using Frustum = std::array<glm::vec4, 6>;
+
+  void Init(const std::vector<InstanceData>& v_instances) {
+    m_uncount = static_cast<uint32_t>(v_instances.size());
+    m_unpadded_count = (m_uncount + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+    mv_x.Resize(m_unpadded_count);
+    mv_y.Resize(m_unpadded_count);
+    mv_scale.Resize(m_unpadded_count);
+    mv_rotation.Resize(m_unpadded_count);
+    mv_radius.Resize(m_unpadded_count);
+    mv_colors.resize(m_uncount);
+
+    for (uint32_t i = 0; i < m_unpadded_count; i++) {
+      if (i < m_uncount) {
+        const InstanceData& instance = v_instances[i];
+        mv_x[i] = instance.transform.x;
+        mv_y[i] = instance.transform.y;
+        mv_scale[i] = instance.transform.z;
+        mv_rotation[i] = instance.transform.w;
+        mv_radius[i] = INSTANCE_BOUNDING_RADIUS * instance.transform.z;
+        mv_colors[i] = instance.color;
+      } else {
+        //an infinitely negative radius fails every plane, so the padding is culled without a tail loop
+        mv_x[i] = 0.f;
+        mv_y[i] = 0.f;
+        mv_scale[i] = 0.f;
+        mv_rotation[i] = 0.f;
+        mv_radius[i] = -std::numeric_limits<float>::infinity();
+      }
+    }
+
+    m_kernel = GetBestKernel();
+  }
+
+  uint32_t GetCount() const { return m_uncount; }
+
+  SceneKernel GetKernel() const { return m_kernel; }
+
+  //only supported kernels, see IsKernelSupported
+  void SetKernel(SceneKernel kernel) { m_kernel = kernel; }
+
+  static bool IsKernelSupported(SceneKernel kernel) {
+    switch (kernel) {
+      case SceneKernel::kScalar:
+        return true;
+      case SceneKernel::kSse:
+#ifdef SCENE_CORE_X86
+        return true;
+#else
+        return false;
+#endif
+      case SceneKernel::kAvx2:
+#if defined(SCENE_CORE_X86) && (defined(__GNUC__) || defined(__clang__))
+        return __builtin_cpu_supports("avx2");
+#elif defined(SCENE_CORE_X86) && defined(_MSC_VER)
+      {
+        //the CPU has to support it and the OS has to save the YMM registers
+        int cpu_info[4];
+        __cpuid(cpu_info, 1);
+        bool b_osxsave = (cpu_info[2] & (1 << 27)) != 0;
+        __cpuidex(cpu_info, 7, 0);
+        bool b_avx2 = (cpu_info[1] & (1 << 5)) != 0;
+        return b_osxsave && b_avx2 && (_xgetbv(0) & 6) == 6;
+      }
+#else
+        return false;
+#endif
+    }
+    return false;
+  }
+
+  static SceneKernel GetBestKernel() {
+    for (SceneKernel kernel : {SceneKernel::kAvx2, SceneKernel::kSse}) {
+      if (IsKernelSupported(kernel)) {
+        return kernel;
+      }
+    }
+    return SceneKernel::kScalar;
+  }
+
+  static const char* GetKernelName(SceneKernel kernel) {
+    switch (kernel) {
+      case SceneKernel::kScalar:
+        return "scalar";
+      case SceneKernel::kSse:
+        return "sse";
+      case SceneKernel::kAvx2:
+        return "avx2";
+    }
+    return "unknown";
+  }
+
+  //Gribb-Hartmann planes of a Vulkan projection, depth from 0 to w
+  static Frustum ExtractFrustum(const glm::mat4& view_proj) {
+    auto Row = [&](int i) { return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]); };
+    Frustum frustum = {Row(3) + Row(0), Row(3) - Row(0), Row(3) + Row(1), Row(3) - Row(1), Row(2), Row(3) - Row(2)};
+    for (glm::vec4& plane : frustum) {
+      plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+    return frustum;
+  }
+
+  //writes every instance at least partly inside the frustum to p_out, which needs room for GetCount() instances,
+  //and returns how many were written. with a pool the chunks run in parallel and land in whatever order they finish
+  uint32_t Cull(ThreadPool* p_thread_pool, const Frustum& frustum, float f_angle, InstanceData* p_out) const {
+    std::atomic<uint32_t> un_written{0};
+    if (p_thread_pool == nullptr) {
+      for (uint32_t un_begin = 0; un_begin < m_unpadded_count; un_begin += CHUNK_SIZE) {
+        CullChunk(frustum, f_angle, un_begin, std::min(un_begin + CHUNK_SIZE, m_unpadded_count), p_out, un_written);
+      }
+    } else {
+      p_thread_pool->ParallelFor(m_unpadded_count, CHUNK_SIZE, [&](uint32_t, uint32_t un_begin, uint32_t un_end) {
+        CullChunk(frustum, f_angle, un_begin, un_end, p_out, un_written);
+      });
+    }
+    return un_written.load(std::memory_order_relaxed);
+  }
+
+ private:
+  //tests [un_begin, un_end), then reserves one contiguous run of the output for the survivors and writes them
+  //front to back, which suits write-combined mappings
+  void CullChunk(const Frustum& frustum, float f_angle, uint32_t un_begin, uint32_t un_end, InstanceData* p_out,
+                 std::atomic<uint32_t>& un_written) const {
+    uint64_t un_visible[CHUNK_SIZE / 64] = {};
+    switch (m_kernel) {
+      case SceneKernel::kScalar:
+        TestScalar(frustum, un_begin, un_end, un_visible);
+        break;
+#ifdef SCENE_CORE_X86
+      case SceneKernel::kSse:
+        TestSse(frustum, un_begin, un_end, un_visible);
+        break;
+      case SceneKernel::kAvx2:
+        TestAvx2(frustum, un_begin, un_end, un_visible);
+        break;
+#else
+      default:
+        TestScalar(frustum, un_begin, un_end, un_visible);
+        break;
+#endif
+    }
+
+    uint32_t un_word_count = (un_end - un_begin + 63) / 64;
+    uint32_t un_visible_count = 0;
+    for (uint32_t w = 0; w < un_word_count; w++) {
+      un_visible_count += static_cast<uint32_t>(std::popcount(un_visible[w]));
+    }
+    if (un_visible_count == 0) {
+      return;
+    }
+
+    InstanceData* p_next = p_out + un_written.fetch_add(un_visible_count, std::memory_order_relaxed);
+    for (uint32_t w = 0; w < un_word_count; w++) {
+      for (uint64_t un_bits = un_visible[w]; un_bits != 0; un_bits &= un_bits - 1) {
+        uint32_t i = un_begin + 64 * w + static_cast<uint32_t>(std::countr_zero(un_bits));
+        *p_next++ = {
+            .transform = glm::vec4(mv_x[i], mv_y[i], mv_scale[i], mv_rotation[i] + f_angle),
+            .color = mv_colors[i],
+        };
+      }
+    }
+  }
+
+  void TestScalar(const Frustum& frustum, uint32_t un_begin, uint32_t un_end, uint64_t* p_visible) const {
+    for (uint32_t i = un_begin; i < un_end; i++) {
+      bool b_visible = true;
+      for (const glm::vec4& plane : frustum) {
+        b_visible = b_visible && plane.x * mv_x[i] + plane.y * mv_y[i] + plane.w >= -mv_radius[i];
+      }
+      p_visible[(i - un_begin) / 64] |= uint64_t{b_visible} << ((i - un_begin) % 64);
+    }
+  }
+
+#ifdef SCENE_CORE_X86
+  void TestSse(const Frustum& frustum, uint32_t un_begin, uint32_t un_end, uint64_t* p_visible) const {
+    __m128 plane_x[6], plane_y[6], plane_w[6];
+    for (int p = 0; p < 6; p++) {
+      plane_x[p] = _mm_set1_ps(frustum[p].x);
+      plane_y[p] = _mm_set1_ps(frustum[p].y);
+      plane_w[p] = _mm_set1_ps(frustum[p].w);
+    }
+
+    const __m128 sign = _mm_set1_ps(-0.f);
+    for (uint32_t i = un_begin; i < un_end; i += 4) {
+      __m128 x = _mm_load_ps(&mv_x[i]);
+      __m128 y = _mm_load_ps(&mv_y[i]);
+      __m128 neg_radius = _mm_xor_ps(_mm_load_ps(&mv_radius[i]), sign);
+
+      __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int p = 0; p < 6; p++) {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)), plane_w[p]);
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, neg_radius));
+      }
+      p_visible[(i - un_begin) / 64] |= uint64_t(_mm_movemask_ps(visible)) << ((i - un_begin) % 64);
+    }
+  }
+
+  SCENE_CORE_TARGET_AVX2 void TestAvx2(const Frustum& frustum, uint32_t un_begin, uint32_t un_end,
+                                       uint64_t* p_visible) const {
+    __m256 plane_x[6], plane_y[6], plane_w[6];
+    for (int p = 0; p < 6; p++) {
+      plane_x[p] = _mm256_set1_ps(frustum[p].x);
+      plane_y[p] = _mm256_set1_ps(frustum[p].y);
+      plane_w[p] = _mm256_set1_ps(frustum[p].w);
+    }
+
+    const __m256 sign = _mm256_set1_ps(-0.f);
+    for (uint32_t i = un_begin; i < un_end; i += 8) {
+      __m256 x = _mm256_load_ps(&mv_x[i]);
+      __m256 y = _mm256_load_ps(&mv_y[i]);
+      __m256 neg_radius = _mm256_xor_ps(_mm256_load_ps(&mv_radius[i]), sign);
+
+      __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+      for (int p = 0; p < 6; p++) {
+        __m256 distance =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[p], x), _mm256_mul_ps(plane_y[p], y)), plane_w[p]);
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, neg_radius, _CMP_GE_OQ));
+      }
+      p_visible[(i - un_begin) / 64] |= uint64_t(_mm256_movemask_ps(visible)) << ((i - un_begin) % 64);
+    }
+  }
+#endif
+
+  uint32_t m_uncount = 0;
+  uint32_t m_unpadded_count = 0;
+  SceneKernel m_kernel = SceneKernel::kScalar;
+
+  CacheAlignedArray<float> mv_x;
+  CacheAlignedArray<float> mv_y;
+  CacheAlignedArray<float> mv_scale;
+  CacheAlignedArray<float> mv_rotation;
+  CacheAlignedArray<float> mv_radius;
+  std::vector<glm::vec4> mv_colors;  //only read for survivors, so kept whole
+};
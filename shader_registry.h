@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//SPIR-V compiled by the compile_shaders target, embedded in the binary so startup does no file I/O and does not
+//depend on the working directory. the arrays are uint32_t, so pCode is always 4-byte aligned
+struct EmbeddedShader {
+  const char* p_name;  //source file name, e.g. "hello.vert"
+  const uint32_t* p_code;
+  size_t n_size;  //in bytes, as VkShaderModuleCreateInfo::codeSize expects
+};
+
+//generated by cmake/EmbedShaders.cmake, defines k_embedded_shaders
+#include "embedded_shaders.h"
+
+inline const EmbeddedShader* FindEmbeddedShader(std::string_view name) {
+  for (const EmbeddedShader& shader : k_embedded_shaders) {
+    if (name == shader.p_name) {
+      return &shader;
+    }
+  }
+
+  return nullptr;
+}
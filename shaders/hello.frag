@@ -1,9 +1,19 @@
 #version 450
 
+// 0 vertex colors, 1 grayscale, 2 inverted. specialized at pipeline creation, so the branch is compiled away
+layout(constant_id = 0) const uint COLOR_MODE = 0;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (COLOR_MODE == 1) {
+        color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+    } else if (COLOR_MODE == 2) {
+        color = vec3(1.0) - color;
+    }
+
+    outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,5 +1,19 @@
 #version 450
 
+struct InstanceData {
+    vec4 transform; // xy offset, z scale, w rotation in radians
+    vec4 color;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+layout(std140, set = 0, binding = 1) uniform FrameUniforms {
+    mat4 view_proj;
+    vec4 time; // x seconds since start, y frame delta in seconds, z spin speed in radians per second
+} frame;
+
 layout(location = 0) out vec3 fragColor;
 
 vec2 positions[3] = vec2[](
@@ -15,6 +29,14 @@ vec3(0.0, 0.0, 1.0)
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    InstanceData instance = instances[gl_InstanceIndex];
+
+    vec2 local = positions[gl_VertexIndex] * instance.transform.z;
+    float rotation = instance.transform.w + frame.time.x * frame.time.z;
+    float s = sin(rotation);
+    float c = cos(rotation);
+
+    vec2 world = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + instance.transform.xy;
+    gl_Position = frame.view_proj * vec4(world, 0.0, 1.0);
+    fragColor = colors[gl_VertexIndex] * instance.color.rgb;
+}
@@ -0,0 +1,47 @@
+#version 450
+
+// vertex inputs at the locations of MeshAttribute in mesh_format.h. the vertex fetch already turned the SNORM, half
+// and UNORM streams into floats, only the bounding box and octahedral decodes are left
+layout(location = 0) in vec4 position; // xyz inside the bounding box mapped to [-1, 1]
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normal; // octahedral
+
+layout(std140, set = 0, binding = 1) uniform FrameUniforms {
+    mat4 view_proj;
+    vec4 time; // x seconds since start, y frame delta in seconds, z spin speed in radians per second
+} frame;
+
+// matches MeshPushConstants in main.cpp
+layout(push_constant) uniform MeshPushConstants {
+    vec4 position_scale; // xyz, MeshFileHeader::f_position_scale
+    vec4 position_offset; // xyz, MeshFileHeader::f_position_offset
+    vec4 placement; // xyz added to the model space position, then scaled by w to fit the mesh into the view
+} mesh;
+
+layout(location = 0) out vec3 fragColor;
+
+// mirrors EncodeOctahedral in tools/mesh_converter.cpp
+vec3 DecodeOctahedral(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+void main() {
+    vec3 model = position.xyz * mesh.position_scale.xyz + mesh.position_offset.xyz;
+    vec3 local = (model + mesh.placement.xyz) * mesh.placement.w;
+    vec3 n = DecodeOctahedral(normal);
+
+    // around the vertical axis at the --spin speed, like the instances
+    float rotation = frame.time.x * frame.time.z;
+    float s = sin(rotation);
+    float c = cos(rotation);
+    local = vec3(c * local.x + s * local.z, local.y, -s * local.x + c * local.z);
+    n = vec3(c * n.x + s * n.z, n.y, -s * n.x + c * n.z);
+
+    // y up and +z towards the viewer, so the mesh is upright and its near side has the smaller depth
+    gl_Position = frame.view_proj * vec4(local.x * 0.9, -local.y * 0.9, 0.5 - local.z * 0.45, 1.0);
+    fragColor = color.rgb * (0.25 + 0.75 * max(dot(n, normalize(vec3(0.4, 0.6, 0.7))), 0.0));
+}
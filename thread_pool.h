@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//fixed set of worker threads that all run the same job and are joined before the call returns.
+//every worker keeps its index for its lifetime, so callers can give each one private per-thread resources.
+class ThreadPool {
+ public:
+  explicit ThreadPool(uint32_t un_thread_count) {
+    for (uint32_t i = 0; i < un_thread_count; i++) {
+      mv_workers.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_bstopping = true;
+    }
+    m_cv_work.notify_all();
+
+    for (std::thread& worker : mv_workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  uint32_t GetThreadCount() const { return static_cast<uint32_t>(mv_workers.size()); }
+
+  //calls fn(thread_index) once on every worker and blocks until all of them have returned
+  void Run(const std::function<void(uint32_t)>& fn) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_job = &fn;
+      m_unremaining = GetThreadCount();
+      m_ungeneration++;
+    }
+    m_cv_work.notify_all();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this]() { return m_unremaining == 0; });
+    m_job = nullptr;
+  }
+
+  //splits [0, un_count) into chunks of un_chunk_size that the workers pull until none are left,
+  //calling fn(thread_index, begin, end) for each chunk
+  void ParallelFor(uint32_t un_count, uint32_t un_chunk_size,
+                   const std::function<void(uint32_t, uint32_t, uint32_t)>& fn) {
+    un_chunk_size = std::max(un_chunk_size, 1u);
+    std::atomic<uint32_t> un_next{0};
+
+    Run([&](uint32_t un_thread_index) {
+      while (true) {
+        uint32_t un_begin = un_next.fetch_add(un_chunk_size, std::memory_order_relaxed);
+        if (un_begin >= un_count) {
+          break;
+        }
+        fn(un_thread_index, un_begin, std::min(un_begin + un_chunk_size, un_count));
+      }
+    });
+  }
+
+ private:
+  void WorkerLoop(uint32_t un_thread_index) {
+    uint64_t un_seen_generation = 0;
+
+    while (true) {
+      const std::function<void(uint32_t)>* job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv_work.wait(lock, [&]() { return m_bstopping || m_ungeneration != un_seen_generation; });
+        if (m_bstopping) {
+          return;
+        }
+        un_seen_generation = m_ungeneration;
+        job = m_job;
+      }
+
+      (*job)(un_thread_index);
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_unremaining--;
+        if (m_unremaining == 0) {
+          m_cv_done.notify_one();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> mv_workers;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv_work;
+  std::condition_variable m_cv_done;
+
+  const std::function<void(uint32_t)>* m_job = nullptr;
+  uint32_t m_unremaining = 0;
+  uint64_t m_ungeneration = 0;
+  bool m_bstopping = false;
+};
@@ -0,0 +1,801 @@
+//converts a Wavefront OBJ into the .mesh format of mesh_format.h, which the program maps and uploads without parsing.
+//positions are quantized to SNORM16 or half floats inside the bounding box, normals to octahedral SNORM16 and colors to
+//UNORM8, 16 bytes per vertex instead of 36. lower levels of detail are built by vertex clustering over the same
+//vertices. every level is reordered for the post-transform vertex cache and then for overdraw, the vertices are
+//renumbered in the order the indices first use them, and every level is split into meshlets with bounding spheres
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mesh_format.h"
+
+//LRU size the vertex cache optimization scores for, what Forsyth's scoring function was tuned with
+const uint32_t VERTEX_CACHE_SIZE = 32;
+//FIFO size the ACMR is reported for and overdraw clusters are split by, closer to what GPUs actually reuse
+const uint32_t FIFO_CACHE_SIZE = 16;
+
+using Vec3 = std::array<float, 3>;
+
+static Vec3 Sub(const Vec3& a, const Vec3& b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+static Vec3 Cross(const Vec3& a, const Vec3& b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+static float Dot(const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+static float Distance(const Vec3& a, const Vec3& b) { return std::sqrt(Dot(Sub(a, b), Sub(a, b))); }
+static Vec3 Normalize(const Vec3& v, const Vec3& fallback) {
+  float f_length = std::sqrt(Dot(v, v));
+  return f_length > 0.f ? Vec3{v[0] / f_length, v[1] / f_length, v[2] / f_length} : fallback;
+}
+
+struct ObjMesh {
+  //one vertex per distinct position and normal pair of the OBJ
+  std::vector<Vec3> v_positions;
+  std::vector<Vec3> v_normals;
+  std::vector<Vec3> v_colors;  //the "v x y z r g b" extension, white where a vertex has none
+
+  std::vector<uint32_t> v_indices;  //lod 0, followed by the coarser levels once they are built
+};
+
+struct ConverterConfig {
+  std::string s_input_path;
+  std::string s_output_path;
+  uint32_t un_lod_count = 4;  //upper bound, levels that would not remove any triangles are not written
+  MeshStreamFormat position_format = MeshStreamFormat::kR16G16B16A16Snorm;
+  bool b_optimize = true;  //vertex cache, overdraw and vertex fetch ordering
+};
+
+//v, vn and f records only, faces with more than three corners are split into fans and texture coordinates are
+//skipped. corners without a normal get the area-weighted average of the faces around their position
+static bool ReadObj(const std::string& s_path, ObjMesh& out_mesh) {
+  std::ifstream file(s_path);
+  if (!file.is_open()) {
+    std::cerr << "Could not open " << s_path << std::endl;
+    return false;
+  }
+
+  std::vector<Vec3> v_obj_positions, v_obj_colors, v_obj_normals;
+  std::unordered_map<uint64_t, uint32_t> corner_vertices;  //obj position << 32 | obj normal, to vertex
+  std::vector<uint32_t> v_vertex_positions;               //obj position of every vertex
+  std::vector<bool> v_normal_missing;
+
+  //1-based, negative counts back from the last record read so far. anything but a whole number is out of range
+  auto ResolveIndex = [](const std::string& s_index, size_t un_count, uint32_t& out_index) {
+    long long n_index = 0;
+    const char* p_end = s_index.data() + s_index.size();
+    auto [p_parsed, error] = std::from_chars(s_index.data(), p_end, n_index);
+    if (error != std::errc() || p_parsed != p_end) {
+      return false;
+    }
+    long long n_resolved = n_index < 0 ? static_cast<long long>(un_count) + n_index : n_index - 1;
+    out_index = static_cast<uint32_t>(n_resolved);
+    return n_index != 0 && n_resolved >= 0 && n_resolved < static_cast<long long>(un_count);
+  };
+
+  std::string s_line;
+  std::vector<uint32_t> v_face;
+  for (uint32_t un_line = 1; std::getline(file, s_line); un_line++) {
+    std::istringstream line(s_line);
+    std::string s_type;
+    line >> s_type;
+
+    if (s_type == "v") {
+      Vec3 position{}, color = {1.f, 1.f, 1.f};
+      line >> position[0] >> position[1] >> position[2];
+      if (line.fail()) {
+        std::cerr << s_path << ":" << un_line << ": vertex needs three coordinates" << std::endl;
+        return false;
+      }
+      line >> color[0] >> color[1] >> color[2];
+      v_obj_positions.push_back(position);
+      v_obj_colors.push_back(line.fail() ? Vec3{1.f, 1.f, 1.f} : color);
+    } else if (s_type == "vn") {
+      Vec3 normal{};
+      line >> normal[0] >> normal[1] >> normal[2];
+      v_obj_normals.push_back(Normalize(normal, {0.f, 0.f, 1.f}));
+    } else if (s_type == "f") {
+      v_face.clear();
+      for (std::string s_corner; line >> s_corner;) {
+        size_t un_first_slash = s_corner.find('/');
+        size_t un_second_slash =
+            un_first_slash == std::string::npos ? std::string::npos : s_corner.find('/', un_first_slash + 1);
+
+        uint32_t un_position, un_normal = UINT32_MAX;
+        bool b_valid = ResolveIndex(s_corner.substr(0, un_first_slash), v_obj_positions.size(), un_position);
+        if (b_valid && un_second_slash != std::string::npos && un_second_slash + 1 < s_corner.size()) {
+          b_valid = ResolveIndex(s_corner.substr(un_second_slash + 1), v_obj_normals.size(), un_normal);
+        }
+        if (!b_valid) {
+          std::cerr << s_path << ":" << un_line << ": face refers to a missing vertex or normal" << std::endl;
+          return false;
+        }
+
+        auto [it, b_inserted] = corner_vertices.try_emplace(uint64_t{un_position} << 32 | un_normal,
+                                                            static_cast<uint32_t>(out_mesh.v_positions.size()));
+        if (b_inserted) {
+          out_mesh.v_positions.push_back(v_obj_positions[un_position]);
+          out_mesh.v_colors.push_back(v_obj_colors[un_position]);
+          out_mesh.v_normals.push_back(un_normal == UINT32_MAX ? Vec3{} : v_obj_normals[un_normal]);
+          v_vertex_positions.push_back(un_position);
+          v_normal_missing.push_back(un_normal == UINT32_MAX);
+        }
+        v_face.push_back(it->second);
+      }
+      for (size_t i = 2; i < v_face.size(); i++) {
+        out_mesh.v_indices.insert(out_mesh.v_indices.end(), {v_face[0], v_face[i - 1], v_face[i]});
+      }
+    }
+  }
+
+  if (out_mesh.v_indices.empty()) {
+    std::cerr << s_path << " has no faces" << std::endl;
+    return false;
+  }
+
+  //the cross product's length is twice the triangle's area, so summing it weights every face by its area
+  std::vector<Vec3> v_position_normals(v_obj_positions.size(), Vec3{});
+  for (size_t i = 0; i < out_mesh.v_indices.size(); i += 3) {
+    const Vec3& a = out_mesh.v_positions[out_mesh.v_indices[i]];
+    Vec3 face_normal = Cross(Sub(out_mesh.v_positions[out_mesh.v_indices[i + 1]], a),
+                             Sub(out_mesh.v_positions[out_mesh.v_indices[i + 2]], a));
+    for (size_t j = i; j < i + 3; j++) {
+      Vec3& normal = v_position_normals[v_vertex_positions[out_mesh.v_indices[j]]];
+      normal = {normal[0] + face_normal[0], normal[1] + face_normal[1], normal[2] + face_normal[2]};
+    }
+  }
+  for (size_t i = 0; i < out_mesh.v_normals.size(); i++) {
+    if (v_normal_missing[i]) {
+      out_mesh.v_normals[i] = Normalize(v_position_normals[v_vertex_positions[i]], {0.f, 0.f, 1.f});
+    }
+  }
+  return true;
+}
+
+//collapses every vertex onto the first vertex of its cell in a grid of un_grid cells along the longest axis of the
+//bounding box, and drops the triangles that became degenerate. out_error is the furthest any vertex moved
+static std::vector<uint32_t> SimplifyByClustering(const ObjMesh& mesh, const std::vector<uint32_t>& v_indices,
+                                                  const Vec3& min, float f_extent, uint32_t un_grid,
+                                                  float& out_error) {
+  const float f_cell_size = f_extent / static_cast<float>(un_grid);
+  std::unordered_map<uint64_t, uint32_t> cell_representatives;
+  std::vector<uint32_t> v_remap(mesh.v_positions.size(), UINT32_MAX);
+  out_error = 0.f;
+
+  auto Remap = [&](uint32_t un_vertex) {
+    if (v_remap[un_vertex] == UINT32_MAX) {
+      const Vec3& position = mesh.v_positions[un_vertex];
+      uint64_t un_cell = 0;
+      for (int axis = 0; axis < 3; axis++) {
+        uint64_t un_coordinate = std::min(static_cast<uint64_t>((position[axis] - min[axis]) / f_cell_size),
+                                          static_cast<uint64_t>(un_grid - 1));
+        un_cell = un_cell * un_grid + un_coordinate;
+      }
+      uint32_t un_representative = cell_representatives.try_emplace(un_cell, un_vertex).first->second;
+      v_remap[un_vertex] = un_representative;
+      out_error = std::max(out_error, Distance(position, mesh.v_positions[un_representative]));
+    }
+    return v_remap[un_vertex];
+  };
+
+  std::vector<uint32_t> v_simplified;
+  for (size_t i = 0; i < v_indices.size(); i += 3) {
+    uint32_t un_a = Remap(v_indices[i]), un_b = Remap(v_indices[i + 1]), un_c = Remap(v_indices[i + 2]);
+    if (un_a != un_b && un_b != un_c && un_c != un_a) {
+      v_simplified.insert(v_simplified.end(), {un_a, un_b, un_c});
+    }
+  }
+  return v_simplified;
+}
+
+//appends the coarser levels' indices to the mesh's and returns every level, each one clustered from lod 0 on a grid
+//half as fine as the previous one. the meshlet ranges are filled in later
+static std::vector<MeshLod> BuildLods(const ConverterConfig& config, ObjMesh& mesh) {
+  std::vector<MeshLod> v_lods = {{
+      .un_first_index = 0,
+      .un_index_count = static_cast<uint32_t>(mesh.v_indices.size()),
+      .un_first_meshlet = 0,
+      .un_meshlet_count = 0,
+      .f_error = 0.f,
+      .un_reserved = {},
+  }};
+
+  Vec3 min = mesh.v_positions[0], max = min;
+  for (const Vec3& position : mesh.v_positions) {
+    for (int axis = 0; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], position[axis]);
+      max[axis] = std::max(max[axis], position[axis]);
+    }
+  }
+  const float f_extent = std::max({max[0] - min[0], max[1] - min[1], max[2] - min[2]});
+
+  //a surface of n vertices crosses about n cells of a sqrt(n) grid, so coarser levels start there
+  const std::vector<uint32_t> v_lod0_indices = mesh.v_indices;
+  uint32_t un_grid = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<double>(mesh.v_positions.size()))));
+  while (v_lods.size() < config.un_lod_count && un_grid >= 2 && f_extent > 0.f) {
+    float f_error;
+    std::vector<uint32_t> v_simplified = SimplifyByClustering(mesh, v_lod0_indices, min, f_extent, un_grid, f_error);
+    un_grid /= 2;
+    if (v_simplified.empty()) {
+      break;
+    }
+    if (v_simplified.size() == v_lods.back().un_index_count) {
+      continue;  //the grid is still finer than the mesh
+    }
+
+    v_lods.push_back({
+        .un_first_index = static_cast<uint32_t>(mesh.v_indices.size()),
+        .un_index_count = static_cast<uint32_t>(v_simplified.size()),
+        .un_first_meshlet = 0,
+        .un_meshlet_count = 0,
+        .f_error = f_error,
+        .un_reserved = {},
+    });
+    mesh.v_indices.insert(mesh.v_indices.end(), v_simplified.begin(), v_simplified.end());
+  }
+  return v_lods;
+}
+
+//average cache miss ratio, vertex shader invocations per triangle with a FIFO_CACHE_SIZE entry FIFO. 0.5 is the
+//floor for a large regular grid, 3 means no reuse at all
+static float SimulateAcmr(const uint32_t* p_indices, uint32_t un_index_count, uint32_t un_vertex_count) {
+  //a vertex is cached while fewer than FIFO_CACHE_SIZE misses happened since its own
+  std::vector<uint32_t> v_miss_time(un_vertex_count, 0);
+  uint32_t un_misses = 0;
+  for (uint32_t i = 0; i < un_index_count; i++) {
+    uint32_t& un_time = v_miss_time[p_indices[i]];
+    if (un_time == 0 || un_misses - un_time >= FIFO_CACHE_SIZE) {
+      un_time = ++un_misses;
+    }
+  }
+  return un_index_count > 0 ? 3.f * un_misses / un_index_count : 0.f;
+}
+
+//Forsyth's score: vertices of the last triangle are slightly penalized so strips do not degenerate, older cache
+//entries are worth less, and vertices with few triangles left are boosted so they are finished and leave the cache
+static float VertexCacheScore(int32_t n_cache_position, uint32_t un_live_triangles) {
+  if (un_live_triangles == 0) {
+    return -1.f;
+  }
+  float f_score = 0.f;
+  if (n_cache_position >= 0 && n_cache_position < 3) {
+    f_score = 0.75f;
+  } else if (n_cache_position >= 3) {
+    f_score = std::pow(1.f - (n_cache_position - 3) / static_cast<float>(VERTEX_CACHE_SIZE - 3), 1.5f);
+  }
+  return f_score + 2.f / std::sqrt(static_cast<float>(un_live_triangles));
+}
+
+//Tom Forsyth's linear-speed vertex cache optimization: repeatedly emits the best scoring triangle around the simulated
+//LRU cache, falling back to the next unemitted one in input order when no cached vertex has any left
+static void OptimizeVertexCache(uint32_t* p_indices, uint32_t un_index_count, uint32_t un_vertex_count) {
+  const uint32_t un_triangle_count = un_index_count / 3;
+
+  //the triangles around every vertex, the first v_live of them not emitted yet
+  std::vector<uint32_t> v_live(un_vertex_count, 0);
+  for (uint32_t i = 0; i < un_index_count; i++) {
+    v_live[p_indices[i]]++;
+  }
+  std::vector<uint32_t> v_adjacency_offsets(un_vertex_count + 1, 0);
+  std::partial_sum(v_live.begin(), v_live.end(), v_adjacency_offsets.begin() + 1);
+  std::vector<uint32_t> v_adjacency(un_index_count);
+  {
+    std::vector<uint32_t> v_fill(v_adjacency_offsets.begin(), v_adjacency_offsets.end() - 1);
+    for (uint32_t i = 0; i < un_index_count; i++) {
+      v_adjacency[v_fill[p_indices[i]]++] = i / 3;
+    }
+  }
+
+  std::vector<float> v_score(un_vertex_count);
+  for (uint32_t i = 0; i < un_vertex_count; i++) {
+    v_score[i] = VertexCacheScore(-1, v_live[i]);
+  }
+  auto TriangleScore = [&](uint32_t un_triangle) {
+    return v_score[p_indices[3 * un_triangle]] + v_score[p_indices[3 * un_triangle + 1]] +
+           v_score[p_indices[3 * un_triangle + 2]];
+  };
+
+  std::vector<bool> v_emitted(un_triangle_count, false);
+  std::vector<uint32_t> v_output;
+  v_output.reserve(un_index_count);
+  std::vector<uint32_t> v_cache, v_next_cache;
+  uint32_t un_cursor = 0;
+
+  int64_t n_best = -1;
+  float f_best_score = -std::numeric_limits<float>::max();
+  for (uint32_t i = 0; i < un_triangle_count; i++) {
+    if (TriangleScore(i) > f_best_score) {
+      f_best_score = TriangleScore(i);
+      n_best = i;
+    }
+  }
+
+  for (uint32_t un_emitted = 0; un_emitted < un_triangle_count; un_emitted++) {
+    if (n_best < 0) {
+      while (v_emitted[un_cursor]) {
+        un_cursor++;
+      }
+      n_best = un_cursor;
+    }
+    const uint32_t un_triangle = static_cast<uint32_t>(n_best);
+    v_emitted[un_triangle] = true;
+
+    v_next_cache.clear();
+    for (uint32_t i = 3 * un_triangle; i < 3 * un_triangle + 3; i++) {
+      uint32_t un_vertex = p_indices[i];
+      v_output.push_back(un_vertex);
+
+      uint32_t* p_begin = v_adjacency.data() + v_adjacency_offsets[un_vertex];
+      uint32_t* p_end = p_begin + v_live[un_vertex];
+      uint32_t* p_found = std::find(p_begin, p_end, un_triangle);
+      if (p_found != p_end) {  //a degenerate triangle lists its vertex more than once
+        *p_found = *(p_end - 1);
+        v_live[un_vertex]--;
+      }
+
+      if (std::find(v_next_cache.begin(), v_next_cache.end(), un_vertex) == v_next_cache.end()) {
+        v_next_cache.push_back(un_vertex);
+      }
+    }
+    for (uint32_t un_vertex : v_cache) {
+      if (std::find(v_next_cache.begin(), v_next_cache.end(), un_vertex) == v_next_cache.end()) {
+        v_next_cache.push_back(un_vertex);
+      }
+    }
+    for (size_t i = VERTEX_CACHE_SIZE; i < v_next_cache.size(); i++) {
+      v_score[v_next_cache[i]] = VertexCacheScore(-1, v_live[v_next_cache[i]]);
+    }
+    v_next_cache.resize(std::min<size_t>(v_next_cache.size(), VERTEX_CACHE_SIZE));
+    for (size_t i = 0; i < v_next_cache.size(); i++) {
+      v_score[v_next_cache[i]] = VertexCacheScore(static_cast<int32_t>(i), v_live[v_next_cache[i]]);
+    }
+    std::swap(v_cache, v_next_cache);
+
+    n_best = -1;
+    f_best_score = -std::numeric_limits<float>::max();
+    for (uint32_t un_vertex : v_cache) {
+      const uint32_t* p_adjacent = v_adjacency.data() + v_adjacency_offsets[un_vertex];
+      for (uint32_t i = 0; i < v_live[un_vertex]; i++) {
+        float f_score = TriangleScore(p_adjacent[i]);
+        if (f_score > f_best_score) {
+          f_best_score = f_score;
+          n_best = p_adjacent[i];
+        }
+      }
+    }
+  }
+
+  std::copy(v_output.begin(), v_output.end(), p_indices);
+}
+
+//cuts the cache-ordered triangles into clusters where the FIFO cache starts over (all three vertices miss), so
+//reordering whole clusters keeps the cache hits inside them. clusters facing away from the center of the mesh are put
+//first: on a mostly convex mesh they are in front of whatever lies behind them, so later triangles fail the depth test
+//instead of shading pixels again (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and
+//Reduced Overdraw")
+static void OptimizeOverdraw(const ObjMesh& mesh, uint32_t* p_indices, uint32_t un_index_count) {
+  const uint32_t un_triangle_count = un_index_count / 3;
+
+  std::vector<uint32_t> v_cluster_starts;
+  {
+    std::vector<uint32_t> v_miss_time(mesh.v_positions.size(), 0);
+    uint32_t un_misses = 0;
+    for (uint32_t i = 0; i < un_triangle_count; i++) {
+      uint32_t un_triangle_misses = 0;
+      for (uint32_t j = 3 * i; j < 3 * i + 3; j++) {
+        uint32_t& un_time = v_miss_time[p_indices[j]];
+        if (un_time == 0 || un_misses - un_time >= FIFO_CACHE_SIZE) {
+          un_time = ++un_misses;
+          un_triangle_misses++;
+        }
+      }
+      if (i == 0 || un_triangle_misses == 3) {
+        v_cluster_starts.push_back(i);
+      }
+    }
+    v_cluster_starts.push_back(un_triangle_count);
+  }
+
+  //area-weighted, the cross product's length is twice the area
+  auto AccumulateTriangle = [&](uint32_t un_triangle, Vec3& centroid, Vec3& normal, float& area) {
+    const Vec3& a = mesh.v_positions[p_indices[3 * un_triangle]];
+    const Vec3& b = mesh.v_positions[p_indices[3 * un_triangle + 1]];
+    const Vec3& c = mesh.v_positions[p_indices[3 * un_triangle + 2]];
+    Vec3 face_normal = Cross(Sub(b, a), Sub(c, a));
+    float f_area = std::sqrt(Dot(face_normal, face_normal));
+    for (int axis = 0; axis < 3; axis++) {
+      centroid[axis] += (a[axis] + b[axis] + c[axis]) / 3.f * f_area;
+      normal[axis] += face_normal[axis];
+    }
+    area += f_area;
+  };
+  auto DivideByArea = [](Vec3& centroid, float f_area) {
+    for (float& f_coordinate : centroid) {
+      f_coordinate /= std::max(f_area, std::numeric_limits<float>::min());
+    }
+  };
+
+  Vec3 mesh_centroid{}, mesh_normal{};
+  float f_mesh_area = 0.f;
+  for (uint32_t i = 0; i < un_triangle_count; i++) {
+    AccumulateTriangle(i, mesh_centroid, mesh_normal, f_mesh_area);
+  }
+  DivideByArea(mesh_centroid, f_mesh_area);
+
+  const size_t un_cluster_count = v_cluster_starts.size() - 1;
+  std::vector<float> v_cluster_keys(un_cluster_count);
+  for (size_t i = 0; i < un_cluster_count; i++) {
+    Vec3 centroid{}, normal{};
+    float f_area = 0.f;
+    for (uint32_t j = v_cluster_starts[i]; j < v_cluster_starts[i + 1]; j++) {
+      AccumulateTriangle(j, centroid, normal, f_area);
+    }
+    DivideByArea(centroid, f_area);
+    v_cluster_keys[i] = Dot(Sub(centroid, mesh_centroid), Normalize(normal, {}));
+  }
+
+  std::vector<uint32_t> v_order(un_cluster_count);
+  std::iota(v_order.begin(), v_order.end(), 0);
+  std::stable_sort(v_order.begin(), v_order.end(),
+                   [&](uint32_t a, uint32_t b) { return v_cluster_keys[a] > v_cluster_keys[b]; });
+
+  std::vector<uint32_t> v_output;
+  v_output.reserve(un_index_count);
+  for (uint32_t un_cluster : v_order) {
+    v_output.insert(v_output.end(), p_indices + 3 * v_cluster_starts[un_cluster],
+                    p_indices + 3 * v_cluster_starts[un_cluster + 1]);
+  }
+  std::copy(v_output.begin(), v_output.end(), p_indices);
+}
+
+//renumbers the vertices in the order the indices first use them, so the vertex fetch walks the streams forwards.
+//vertices no level uses are dropped
+static void OptimizeVertexFetch(ObjMesh& mesh) {
+  std::vector<uint32_t> v_remap(mesh.v_positions.size(), UINT32_MAX);
+  uint32_t un_vertex_count = 0;
+  for (uint32_t& un_index : mesh.v_indices) {
+    if (v_remap[un_index] == UINT32_MAX) {
+      v_remap[un_index] = un_vertex_count++;
+    }
+    un_index = v_remap[un_index];
+  }
+
+  auto Reorder = [&](std::vector<Vec3>& v_attribute) {
+    std::vector<Vec3> v_reordered(un_vertex_count);
+    for (size_t i = 0; i < v_attribute.size(); i++) {
+      if (v_remap[i] != UINT32_MAX) {
+        v_reordered[v_remap[i]] = v_attribute[i];
+      }
+    }
+    v_attribute = std::move(v_reordered);
+  };
+  Reorder(mesh.v_positions);
+  Reorder(mesh.v_normals);
+  Reorder(mesh.v_colors);
+}
+
+//greedy split of the triangles of [un_first_index, un_first_index + un_index_count) in index order, a meshlet closes
+//when the next triangle would exceed either limit
+static void BuildMeshlets(const ObjMesh& mesh, uint32_t un_first_index, uint32_t un_index_count,
+                          std::vector<MeshMeshlet>& out_meshlets) {
+  std::vector<uint32_t> v_meshlet_of_vertex(mesh.v_positions.size(), UINT32_MAX);
+  std::vector<uint32_t> v_vertices;
+  MeshMeshlet meshlet{.un_first_index = un_first_index, .un_index_count = 0, .f_center = {}, .f_radius = 0.f};
+
+  auto Close = [&]() {
+    Vec3 min = mesh.v_positions[v_vertices[0]], max = min;
+    for (uint32_t un_vertex : v_vertices) {
+      for (int axis = 0; axis < 3; axis++) {
+        min[axis] = std::min(min[axis], mesh.v_positions[un_vertex][axis]);
+        max[axis] = std::max(max[axis], mesh.v_positions[un_vertex][axis]);
+      }
+    }
+    Vec3 center = {(min[0] + max[0]) / 2.f, (min[1] + max[1]) / 2.f, (min[2] + max[2]) / 2.f};
+    for (uint32_t un_vertex : v_vertices) {
+      meshlet.f_radius = std::max(meshlet.f_radius, Distance(center, mesh.v_positions[un_vertex]));
+    }
+    std::memcpy(meshlet.f_center, center.data(), sizeof(meshlet.f_center));
+    out_meshlets.push_back(meshlet);
+
+    meshlet = {.un_first_index = meshlet.un_first_index + meshlet.un_index_count, .un_index_count = 0,
+               .f_center = {}, .f_radius = 0.f};
+    v_vertices.clear();
+  };
+
+  const std::vector<uint32_t>& v_indices = mesh.v_indices;
+  for (uint32_t i = un_first_index; i < un_first_index + un_index_count; i += 3) {
+    uint32_t un_meshlet = static_cast<uint32_t>(out_meshlets.size());
+    uint32_t un_new_vertices = 0;
+    for (uint32_t j = i; j < i + 3; j++) {
+      un_new_vertices += v_meshlet_of_vertex[v_indices[j]] != un_meshlet ? 1 : 0;
+    }
+    if (v_vertices.size() + un_new_vertices > MESHLET_MAX_VERTICES ||
+        meshlet.un_index_count / 3 == MESHLET_MAX_TRIANGLES) {
+      Close();
+      un_meshlet++;
+    }
+
+    for (uint32_t j = i; j < i + 3; j++) {
+      if (v_meshlet_of_vertex[v_indices[j]] != un_meshlet) {
+        v_meshlet_of_vertex[v_indices[j]] = un_meshlet;
+        v_vertices.push_back(v_indices[j]);
+      }
+    }
+    meshlet.un_index_count += 3;
+  }
+  if (meshlet.un_index_count > 0) {
+    Close();
+  }
+}
+
+//round to nearest even. the inputs are inside [-1, 1], so there is no overflow to infinity to handle
+static uint16_t FloatToHalf(float f_value) {
+  uint32_t un_bits;
+  std::memcpy(&un_bits, &f_value, sizeof(un_bits));
+  uint32_t un_sign = (un_bits >> 16) & 0x8000;
+  int32_t n_exponent = static_cast<int32_t>((un_bits >> 23) & 0xff) - 127 + 15;
+  uint32_t un_mantissa = un_bits & 0x7fffff;
+
+  uint32_t un_shift = 13;
+  if (n_exponent <= 0) {  //subnormal half, the implicit leading bit becomes explicit
+    if (n_exponent < -10) {
+      return static_cast<uint16_t>(un_sign);
+    }
+    un_mantissa |= 0x800000;
+    un_shift = static_cast<uint32_t>(14 - n_exponent);
+    n_exponent = 0;
+  }
+
+  uint32_t un_half = un_sign | static_cast<uint32_t>(n_exponent) << 10 | un_mantissa >> un_shift;
+  uint32_t un_remainder = un_mantissa & ((1u << un_shift) - 1);
+  uint32_t un_halfway = 1u << (un_shift - 1);
+  if (un_remainder > un_halfway || (un_remainder == un_halfway && (un_half & 1) != 0)) {
+    un_half++;  //a carry out of the mantissa correctly bumps the exponent
+  }
+  return static_cast<uint16_t>(un_half);
+}
+
+//octahedral encoding: the unit sphere is projected onto an octahedron and its lower half folded over the upper one,
+//which keeps the error nearly uniform over all directions with only two values. mirrors DecodeOctahedral in
+//shaders/mesh.vert
+static std::array<int16_t, 2> EncodeOctahedral(const Vec3& normal) {
+  float f_l1 = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+  float f_x = normal[0] / f_l1, f_y = normal[1] / f_l1;
+  if (normal[2] < 0.f) {
+    float f_folded_x = (1.f - std::abs(f_y)) * (f_x >= 0.f ? 1.f : -1.f);
+    f_y = (1.f - std::abs(f_x)) * (f_y >= 0.f ? 1.f : -1.f);
+    f_x = f_folded_x;
+  }
+  return {static_cast<int16_t>(std::lround(std::clamp(f_x, -1.f, 1.f) * 32767.f)),
+          static_cast<int16_t>(std::lround(std::clamp(f_y, -1.f, 1.f) * 32767.f))};
+}
+
+//appends sections to the file, each one starting on a MESH_SECTION_ALIGNMENT boundary
+class SectionWriter {
+ public:
+  //reserves the header, which is written over the start of the file once every section is in place
+  explicit SectionWriter(std::ofstream& file) : m_file(file) {
+    MeshFileHeader header{};
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+  MeshSection Write(const void* p_data, uint64_t un_size) {
+    static const char padding[MESH_SECTION_ALIGNMENT] = {};
+    uint64_t un_aligned = (m_unoffset + MESH_SECTION_ALIGNMENT - 1) / MESH_SECTION_ALIGNMENT * MESH_SECTION_ALIGNMENT;
+    m_file.write(padding, static_cast<std::streamsize>(un_aligned - m_unoffset));
+    m_file.write(static_cast<const char*>(p_data), static_cast<std::streamsize>(un_size));
+    m_unoffset = un_aligned + un_size;
+    return {.un_offset = un_aligned, .un_size = un_size};
+  }
+
+  template <typename T>
+  MeshSection Write(const std::vector<T>& v_data) {
+    return Write(v_data.data(), sizeof(T) * v_data.size());
+  }
+
+ private:
+  std::ofstream& m_file;
+  uint64_t m_unoffset = sizeof(MeshFileHeader);
+};
+
+static bool WriteMesh(const ConverterConfig& config, const ObjMesh& mesh, const std::vector<MeshLod>& v_lods,
+                      const std::vector<MeshMeshlet>& v_meshlets) {
+  const uint32_t un_vertex_count = static_cast<uint32_t>(mesh.v_positions.size());
+
+  //positions cover the bounding box, flat axes keep a scale of 1 so decoding never divides by zero
+  Vec3 min = mesh.v_positions[0], max = min;
+  for (const Vec3& position : mesh.v_positions) {
+    for (int axis = 0; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], position[axis]);
+      max[axis] = std::max(max[axis], position[axis]);
+    }
+  }
+  float f_position_scale[3], f_position_offset[3];
+  for (int axis = 0; axis < 3; axis++) {
+    f_position_scale[axis] = max[axis] > min[axis] ? (max[axis] - min[axis]) / 2.f : 1.f;
+    f_position_offset[axis] = (max[axis] + min[axis]) / 2.f;
+  }
+
+  const bool b_half_positions = config.position_format == MeshStreamFormat::kR16G16B16A16Sfloat;
+  std::vector<uint16_t> v_positions(4 * size_t{un_vertex_count});
+  std::vector<uint8_t> v_colors(4 * size_t{un_vertex_count});
+  std::vector<int16_t> v_normals(2 * size_t{un_vertex_count});
+  for (size_t i = 0; i < un_vertex_count; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      float f_normalized =
+          std::clamp((mesh.v_positions[i][axis] - f_position_offset[axis]) / f_position_scale[axis], -1.f, 1.f);
+      v_positions[4 * i + axis] = b_half_positions ? FloatToHalf(f_normalized)
+                                                   : static_cast<uint16_t>(std::lround(f_normalized * 32767.f));
+      v_colors[4 * i + axis] = static_cast<uint8_t>(std::lround(std::clamp(mesh.v_colors[i][axis], 0.f, 1.f) * 255.f));
+    }
+    v_positions[4 * i + 3] = b_half_positions ? FloatToHalf(1.f) : 32767;
+    v_colors[4 * i + 3] = 255;
+
+    std::array<int16_t, 2> octahedral = EncodeOctahedral(mesh.v_normals[i]);
+    v_normals[2 * i] = octahedral[0];
+    v_normals[2 * i + 1] = octahedral[1];
+  }
+
+  std::ofstream file(config.s_output_path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "Could not open " << config.s_output_path << std::endl;
+    return false;
+  }
+  SectionWriter writer(file);
+
+  //in the order the loader copies them, so loading is one sequential pass over the file
+  std::vector<MeshStream> v_streams = {
+      {
+          .attribute = MeshAttribute::kPosition,
+          .format = config.position_format,
+          .un_stride = 4 * sizeof(uint16_t),
+          .un_reserved = 0,
+          .data = writer.Write(v_positions),
+      },
+      {
+          .attribute = MeshAttribute::kColor,
+          .format = MeshStreamFormat::kR8G8B8A8Unorm,
+          .un_stride = 4 * sizeof(uint8_t),
+          .un_reserved = 0,
+          .data = writer.Write(v_colors),
+      },
+      {
+          .attribute = MeshAttribute::kNormal,
+          .format = MeshStreamFormat::kR16G16Snorm,
+          .un_stride = 2 * sizeof(int16_t),
+          .un_reserved = 0,
+          .data = writer.Write(v_normals),
+      },
+  };
+
+  const uint32_t un_index_size = un_vertex_count <= 65536 ? 2 : 4;
+  MeshSection indices;
+  if (un_index_size == 2) {
+    indices = writer.Write(std::vector<uint16_t>(mesh.v_indices.begin(), mesh.v_indices.end()));
+  } else {
+    indices = writer.Write(mesh.v_indices);
+  }
+
+  MeshFileHeader header = {
+      .un_magic = MESH_FILE_MAGIC,
+      .un_version = MESH_FILE_VERSION,
+      .un_vertex_count = un_vertex_count,
+      .un_index_count = static_cast<uint32_t>(mesh.v_indices.size()),
+      .un_index_size = un_index_size,
+      .un_stream_count = static_cast<uint32_t>(v_streams.size()),
+      .un_lod_count = static_cast<uint32_t>(v_lods.size()),
+      .un_meshlet_count = static_cast<uint32_t>(v_meshlets.size()),
+      .un_max_index = *std::max_element(mesh.v_indices.begin(), mesh.v_indices.end()),
+      .un_reserved = 0,
+      .f_position_scale = {f_position_scale[0], f_position_scale[1], f_position_scale[2]},
+      .f_position_offset = {f_position_offset[0], f_position_offset[1], f_position_offset[2]},
+      .streams = {},
+      .indices = indices,
+      .lods = writer.Write(v_lods),
+      .meshlets = writer.Write(v_meshlets),
+  };
+  header.streams = writer.Write(v_streams);
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!file.good()) {
+    std::cerr << "Writing " << config.s_output_path << " failed" << std::endl;
+    return false;
+  }
+
+  std::cout << config.s_output_path << ": " << un_vertex_count << " vertices, " << mesh.v_indices.size() / 3
+            << " triangles over " << v_lods.size() << " lods, " << v_meshlets.size() << " meshlets" << std::endl;
+  return true;
+}
+
+//s_value as a whole decimal number of at least un_min, with nothing after it. from_chars takes no sign, so "-1" is
+//rejected instead of wrapping, the same rule the program applies to its flags
+static bool ParseUint32(std::string_view s_value, uint32_t un_min, uint32_t& out_value) {
+  uint32_t un_value = 0;
+  const char* p_end = s_value.data() + s_value.size();
+  auto [p_parsed, error] = std::from_chars(s_value.data(), p_end, un_value);
+  if (error != std::errc() || p_parsed != p_end || un_value < un_min) {
+    return false;
+  }
+  out_value = un_value;
+  return true;
+}
+
+static bool ParseCommandLine(int argc, char** argv, ConverterConfig& out_config) {
+  std::vector<std::string> v_paths;
+  bool b_valid = true;
+  for (int i = 1; i < argc && b_valid; i++) {
+    std::string s_arg = argv[i];
+    if (s_arg == "--lods" && i + 1 < argc) {
+      b_valid = ParseUint32(argv[++i], 1, out_config.un_lod_count);
+    } else if (s_arg == "--position-format" && i + 1 < argc) {
+      std::string s_format = argv[++i];
+      b_valid = s_format == "snorm16" || s_format == "half";
+      out_config.position_format =
+          s_format == "half" ? MeshStreamFormat::kR16G16B16A16Sfloat : MeshStreamFormat::kR16G16B16A16Snorm;
+    } else if (s_arg == "--no-optimize") {
+      out_config.b_optimize = false;
+    } else if (!s_arg.starts_with("--")) {
+      v_paths.push_back(s_arg);
+    } else {
+      b_valid = false;
+    }
+  }
+
+  if (!b_valid || v_paths.size() != 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " INPUT.obj OUTPUT.mesh [--lods N] [--position-format snorm16|half] [--no-optimize]" << std::endl;
+    return false;
+  }
+  out_config.s_input_path = v_paths[0];
+  out_config.s_output_path = v_paths[1];
+  return true;
+}
+
+int main(int argc, char** argv) {
+  ConverterConfig config{};
+  if (!ParseCommandLine(argc, argv, config)) {
+    return 1;
+  }
+
+  ObjMesh mesh;
+  if (!ReadObj(config.s_input_path, mesh)) {
+    return 1;
+  }
+  std::vector<MeshLod> v_lods = BuildLods(config, mesh);
+
+  const uint32_t un_vertex_count = static_cast<uint32_t>(mesh.v_positions.size());
+  for (size_t i = 0; i < v_lods.size(); i++) {
+    uint32_t* p_indices = mesh.v_indices.data() + v_lods[i].un_first_index;
+    std::cout << "lod " << i << ": " << v_lods[i].un_index_count / 3 << " triangles, error " << v_lods[i].f_error
+              << ", ACMR " << SimulateAcmr(p_indices, v_lods[i].un_index_count, un_vertex_count);
+    if (config.b_optimize) {
+      OptimizeVertexCache(p_indices, v_lods[i].un_index_count, un_vertex_count);
+      OptimizeOverdraw(mesh, p_indices, v_lods[i].un_index_count);
+      std::cout << " -> " << SimulateAcmr(p_indices, v_lods[i].un_index_count, un_vertex_count);
+    }
+    std::cout << std::endl;
+  }
+  if (config.b_optimize) {
+    OptimizeVertexFetch(mesh);
+  }
+
+  std::vector<MeshMeshlet> v_meshlets;
+  for (MeshLod& lod : v_lods) {
+    lod.un_first_meshlet = static_cast<uint32_t>(v_meshlets.size());
+    BuildMeshlets(mesh, lod.un_first_index, lod.un_index_count, v_meshlets);
+    lod.un_meshlet_count = static_cast<uint32_t>(v_meshlets.size()) - lod.un_first_meshlet;
+  }
+
+  return WriteMesh(config, mesh, v_lods, v_meshlets) ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//a completed range on one track, timestamps in nanoseconds of std::chrono::steady_clock
+struct TraceEvent {
+  const char* p_name;  //must outlive the tracer, in practice a string literal
+  uint64_t un_begin_ns;
+  uint64_t un_end_ns;
+};
+
+//p_string as a quoted JSON string. names can come from outside the program, such as a device name, so quotes,
+//backslashes and control characters are escaped
+inline void WriteJsonString(std::ostream& out, const char* p_string) {
+  out << '"';
+  for (const char* p = p_string; *p != '\0'; p++) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      out << '\\' << *p;
+    } else if (c < 0x20) {
+      const char* p_hex = "0123456789abcdef";
+      out << "\\u00" << p_hex[c >> 4] << p_hex[c & 0xf];
+    } else {
+      out << *p;
+    }
+  }
+  out << '"';
+}
+
+//collects CPU scopes and GPU ranges and writes them as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+//every thread writes into its own ring buffer, so recording an event takes no lock. a full ring keeps the most
+//recent events. WriteChromeTrace reads every ring, so only call it once the threads that record have stopped
+class Tracer {
+ public:
+  static constexpr size_t TRACK_CAPACITY = 1 << 16;
+
+  static Tracer& Get() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  //events recorded while disabled are dropped, so TRACE_SCOPE costs one relaxed load when tracing is off
+  void Enable(bool b_enabled) { m_benabled.store(b_enabled, std::memory_order_relaxed); }
+  bool IsEnabled() const { return m_benabled.load(std::memory_order_relaxed); }
+
+  static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  //a named timeline, one per thread plus the ones created for GPU queues
+  struct Track {
+    Track(const char* p_track_name, uint32_t un_track_id) : p_name(p_track_name), un_id(un_track_id) {}
+
+    const char* p_name;
+    uint32_t un_id;
+    std::vector<TraceEvent> v_events = std::vector<TraceEvent>(TRACK_CAPACITY);
+    std::atomic<uint64_t> un_written{0};  //only the owning thread writes, so a plain load/store pair suffices
+  };
+
+  //names the calling thread's track, the name must outlive the tracer. only has an effect once tracing is enabled
+  void SetThreadName(const char* p_name) {
+    if (IsEnabled()) {
+      GetThreadTrack().p_name = p_name;
+    }
+  }
+
+  void Record(const char* p_name, uint64_t un_begin_ns, uint64_t un_end_ns) {
+    if (IsEnabled()) {
+      Push(GetThreadTrack(), {p_name, un_begin_ns, un_end_ns});
+    }
+  }
+
+  //GPU ranges are not tied to a thread, each queue gets its own track. the track lives as long as the tracer
+  Track& CreateTrack(const char* p_name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    mv_tracks.push_back(std::make_unique<Track>(p_name, static_cast<uint32_t>(mv_tracks.size())));
+    return *mv_tracks.back();
+  }
+
+  //only call from one thread per track
+  void Record(Track& track, const char* p_name, uint64_t un_begin_ns, uint64_t un_end_ns) {
+    if (IsEnabled()) {
+      Push(track, {p_name, un_begin_ns, un_end_ns});
+    }
+  }
+
+  bool WriteChromeTrace(const std::string& s_path) {
+    std::ofstream file(s_path, std::ios::trunc);
+    if (!file.is_open()) {
+      std::cerr << "[Tracer] Could not open " << s_path << std::endl;
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    //chrome traces use microseconds, relative to the earliest event keeps the numbers readable
+    uint64_t un_origin_ns = UINT64_MAX;
+    for (const auto& p_track : mv_tracks) {
+      ForEachEvent(*p_track, [&](const TraceEvent& event) {
+        un_origin_ns = std::min(un_origin_ns, event.un_begin_ns);
+      });
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool b_first = true;
+    for (const auto& p_track : mv_tracks) {
+      file << (b_first ? "" : ",\n") << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": "
+           << p_track->un_id << ", \"args\": {\"name\": ";
+      WriteJsonString(file, p_track->p_name);
+      file << "}}";
+      b_first = false;
+
+      ForEachEvent(*p_track, [&](const TraceEvent& event) {
+        file << ",\n{\"ph\": \"X\", \"name\": ";
+        WriteJsonString(file, event.p_name);
+        file << ", \"pid\": 1, \"tid\": " << p_track->un_id
+             << ", \"ts\": " << (event.un_begin_ns - un_origin_ns) / 1000.0
+             << ", \"dur\": " << (event.un_end_ns - event.un_begin_ns) / 1000.0 << "}";
+      });
+
+      if (p_track->un_written.load(std::memory_order_acquire) > p_track->v_events.size()) {
+        std::cout << "[Tracer] Track " << p_track->p_name << " overflowed, only its last " << p_track->v_events.size()
+                  << " events were kept" << std::endl;
+      }
+    }
+    file << "\n]}" << std::endl;
+
+    return file.good();
+  }
+
+ private:
+  Tracer() = default;
+
+  Track& GetThreadTrack() {
+    thread_local Track* p_track = nullptr;
+    if (p_track == nullptr) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      mv_tracks.push_back(std::make_unique<Track>("Thread", static_cast<uint32_t>(mv_tracks.size())));
+      p_track = mv_tracks.back().get();
+    }
+    return *p_track;
+  }
+
+  static void Push(Track& track, const TraceEvent& event) {
+    uint64_t un_written = track.un_written.load(std::memory_order_relaxed);
+    track.v_events[un_written % TRACK_CAPACITY] = event;
+    track.un_written.store(un_written + 1, std::memory_order_release);
+  }
+
+  template <typename Fn>
+  static void ForEachEvent(const Track& track, Fn&& fn) {
+    uint64_t un_written = track.un_written.load(std::memory_order_acquire);
+    uint64_t un_first = un_written > TRACK_CAPACITY ? un_written - TRACK_CAPACITY : 0;
+    for (uint64_t i = un_first; i < un_written; i++) {
+      fn(track.v_events[i % TRACK_CAPACITY]);
+    }
+  }
+
+  std::atomic<bool> m_benabled{false};
+
+  std::mutex m_mutex;  //guards mv_tracks, only taken the first time a thread records
+  std::vector<std::unique_ptr<Track>> mv_tracks;
+};
+
+//records the enclosing scope on the calling thread's track
+class TraceScope {
+ public:
+  explicit TraceScope(const char* p_name)
+      : mp_name(p_name), m_unbegin_ns(Tracer::Get().IsEnabled() ? Tracer::NowNs() : 0) {}
+
+  ~TraceScope() {
+    if (m_unbegin_ns != 0) {
+      Tracer::Get().Record(mp_name, m_unbegin_ns, Tracer::NowNs());
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* mp_name;
+  uint64_t m_unbegin_ns;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "memory_arena.h"
+#include "trace.h"
+#include "vk_dispatch.h"
+#include "vk_qualify.h"
+#include "vulkan/vulkan.h"
+
+//streams buffer uploads through a persistently mapped staging ring on the transfer queue.
+//every submission signals the next value of a timeline semaphore, so the render loop never waits on an upload: it
+//polls the counter, and only once an upload has landed does it acquire the buffer and wait on that (already reached)
+//value. when the transfer queue is in a different family from graphics, the buffer's ownership is released on the
+//transfer queue and acquired on the graphics queue.
+class TransferUploader : VkDeviceDispatch {
+ public:
+  static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 16ull * 1024 * 1024;
+
+  bool Init(VkDevice vkdevice, const VkDeviceDispatch& dispatch, DeviceMemoryArena& memory_arena,
+            VkQueue vktransfer_queue, uint32_t un_transfer_family, uint32_t un_graphics_family,
+            VkDeviceSize staging_size = DEFAULT_STAGING_SIZE) {
+    m_vkdevice = vkdevice;
+    SetDeviceDispatch(dispatch);
+    mp_memory_arena = &memory_arena;
+    m_vktransfer_queue = vktransfer_queue;
+    m_untransfer_family = un_transfer_family;
+    m_ungraphics_family = un_graphics_family;
+
+    {  //staging ring
+      VkBufferCreateInfo buffer_create_info = {
+          .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .size = staging_size,
+          .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 0,
+          .pQueueFamilyIndices = nullptr,
+      };
+      if (!memory_arena.CreateBuffer(buffer_create_info, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_vkstaging_buffer, m_staging_allocation)) {
+        return false;
+      }
+      m_staging_size = staging_size;
+    }
+
+    {  //command pool on the transfer family
+      VkCommandPoolCreateInfo cmd_pool_create_info = {
+          .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+          .queueFamilyIndex = un_transfer_family,
+      };
+      b_qualify_vk(vkCreateCommandPool(m_vkdevice, &cmd_pool_create_info, nullptr, &m_vkcommand_pool));
+    }
+
+    {  //timeline semaphore
+      VkSemaphoreTypeCreateInfo semaphore_type_create_info = {
+          .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+          .pNext = nullptr,
+          .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+          .initialValue = 0,
+      };
+      VkSemaphoreCreateInfo semaphore_create_info = {
+          .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+          .pNext = &semaphore_type_create_info,
+          .flags = 0,
+      };
+      b_qualify_vk(vkCreateSemaphore(m_vkdevice, &semaphore_create_info, nullptr, &m_vktimeline));
+    }
+
+    return true;
+  }
+
+  void Destroy() {
+    if (m_vkdevice == VK_NULL_HANDLE) {
+      return;
+    }
+
+    WaitIdle();
+
+    vkDestroySemaphore(m_vkdevice, m_vktimeline, nullptr);
+    vkDestroyCommandPool(m_vkdevice, m_vkcommand_pool, nullptr);
+    mp_memory_arena->DestroyBuffer(m_vkstaging_buffer, m_staging_allocation);
+    m_vkdevice = VK_NULL_HANDLE;
+  }
+
+  //copies p_data into dst_buffer at dst_offset, returns the timeline value that signals once the copy has landed.
+  //dst_stages and dst_access describe how the graphics queue will first use the data.
+  //uploads larger than the staging ring are split into several submissions, blocking only when the ring is full.
+  bool Upload(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* p_data, VkDeviceSize size,
+              VkPipelineStageFlags dst_stages, VkAccessFlags dst_access, uint64_t& out_value) {
+    TRACE_SCOPE("Upload");
+    const VkDeviceSize max_chunk_size = m_staging_size / 4;
+
+    for (VkDeviceSize done = 0; done < size;) {
+      VkDeviceSize chunk_size = std::min(size - done, max_chunk_size);
+      bool b_last = done + chunk_size == size;
+
+      VkDeviceSize staging_offset;
+      if (!ReserveStaging(chunk_size, staging_offset)) {
+        return false;
+      }
+      memcpy(static_cast<char*>(m_staging_allocation.p_mapped) + staging_offset,
+             static_cast<const char*>(p_data) + done, chunk_size);
+      if (!mp_memory_arena->Flush(m_staging_allocation, staging_offset, chunk_size)) {
+        return false;
+      }
+
+      VkCommandBuffer command_buffer;
+      if (!AcquireCommandBuffer(command_buffer)) {
+        return false;
+      }
+
+      VkCommandBufferBeginInfo begin_info = {
+          .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+          .pNext = nullptr,
+          .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+          .pInheritanceInfo = nullptr,
+      };
+      b_qualify_vk(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+      VkBufferCopy buffer_copy = {
+          .srcOffset = staging_offset,
+          .dstOffset = dst_offset + done,
+          .size = chunk_size,
+      };
+      vkCmdCopyBuffer(command_buffer, m_vkstaging_buffer, dst_buffer, 1, &buffer_copy);
+
+      //earlier chunks precede this barrier in submission order on the same queue, so one release covers them all
+      if (b_last && IsOwnershipTransferNeeded()) {
+        VkBufferMemoryBarrier release_barrier = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = 0,
+            .srcQueueFamilyIndex = m_untransfer_family,
+            .dstQueueFamilyIndex = m_ungraphics_family,
+            .buffer = dst_buffer,
+            .offset = dst_offset,
+            .size = size,
+        };
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                             nullptr, 1, &release_barrier, 0, nullptr);
+      }
+
+      b_qualify_vk(vkEndCommandBuffer(command_buffer));
+
+      uint64_t un_signal_value = m_unnext_value++;
+      VkTimelineSemaphoreSubmitInfo timeline_submit_info = {
+          .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+          .pNext = nullptr,
+          .waitSemaphoreValueCount = 0,
+          .pWaitSemaphoreValues = nullptr,
+          .signalSemaphoreValueCount = 1,
+          .pSignalSemaphoreValues = &un_signal_value,
+      };
+      VkSubmitInfo submit_info = {
+          .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+          .pNext = &timeline_submit_info,
+          .waitSemaphoreCount = 0,
+          .pWaitSemaphores = nullptr,
+          .pWaitDstStageMask = nullptr,
+          .commandBufferCount = 1,
+          .pCommandBuffers = &command_buffer,
+          .signalSemaphoreCount = 1,
+          .pSignalSemaphores = &m_vktimeline,
+      };
+      b_qualify_vk(vkQueueSubmit(m_vktransfer_queue, 1, &submit_info, VK_NULL_HANDLE));
+
+      mdq_in_flight.push_back({
+          .un_value = un_signal_value,
+          .vkcommand_buffer = command_buffer,
+          .staging_end = staging_offset + chunk_size,
+      });
+
+      done += chunk_size;
+      out_value = un_signal_value;
+    }
+
+    mv_pending_acquires.push_back({
+        .vkbuffer = dst_buffer,
+        .offset = dst_offset,
+        .size = size,
+        .dst_stages = dst_stages,
+        .dst_access = dst_access,
+        .un_value = out_value,
+    });
+
+    return true;
+  }
+
+  //latest timeline value the transfer queue has reached, uploads up to and including it have landed
+  uint64_t GetCompletedValue() {
+    uint64_t un_value = 0;
+    if (vkGetSemaphoreCounterValue(m_vkdevice, m_vktimeline, &un_value) != VK_SUCCESS) {
+      return 0;
+    }
+    return un_value;
+  }
+
+  bool Wait(uint64_t un_value) {
+    VkSemaphoreWaitInfo semaphore_wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_vktimeline,
+        .pValues = &un_value,
+    };
+    b_qualify_vk(vkWaitSemaphores(m_vkdevice, &semaphore_wait_info, UINT64_MAX));
+    return true;
+  }
+
+  bool WaitIdle() { return m_unnext_value == 1 || Wait(m_unnext_value - 1); }
+
+  //records the graphics-side acquire for every upload that has completed since the last call, so the frame never
+  //depends on an upload still in flight. must be recorded outside a render pass.
+  //out_wait_value is the timeline value the graphics submit must wait on at out_wait_stages, 0 when there is none.
+  void RecordAcquireBarriers(VkCommandBuffer command_buffer, uint64_t& out_wait_value,
+                             VkPipelineStageFlags& out_wait_stages) {
+    out_wait_value = 0;
+    out_wait_stages = 0;
+    if (mv_pending_acquires.empty()) {
+      return;
+    }
+
+    uint64_t un_completed_value = GetCompletedValue();
+    RetireCompleted(un_completed_value);
+
+    std::vector<VkBufferMemoryBarrier> v_acquire_barriers{};
+    auto IsAcquired = [&](const PendingAcquire& pending) {
+      if (pending.un_value > un_completed_value) {
+        return false;
+      }
+
+      out_wait_value = std::max(out_wait_value, pending.un_value);
+      out_wait_stages |= pending.dst_stages;
+
+      if (IsOwnershipTransferNeeded()) {
+        v_acquire_barriers.push_back({
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = 0,
+            .dstAccessMask = pending.dst_access,
+            .srcQueueFamilyIndex = m_untransfer_family,
+            .dstQueueFamilyIndex = m_ungraphics_family,
+            .buffer = pending.vkbuffer,
+            .offset = pending.offset,
+            .size = pending.size,
+        });
+      }
+      return true;
+    };
+    mv_pending_acquires.erase(std::remove_if(mv_pending_acquires.begin(), mv_pending_acquires.end(), IsAcquired),
+                              mv_pending_acquires.end());
+    m_unacquired_value = std::max(m_unacquired_value, out_wait_value);
+
+    //the semaphore wait makes the transfer writes visible at out_wait_stages, the acquire chains off that stage
+    if (!v_acquire_barriers.empty()) {
+      vkCmdPipelineBarrier(command_buffer, out_wait_stages, out_wait_stages, 0, 0, nullptr,
+                           static_cast<uint32_t>(v_acquire_barriers.size()), v_acquire_barriers.data(), 0, nullptr);
+    }
+  }
+
+  //every upload with a value up to this one has landed and been acquired by a recorded graphics command buffer
+  uint64_t GetAcquiredValue() const { return m_unacquired_value; }
+
+  VkSemaphore GetTimelineSemaphore() const { return m_vktimeline; }
+
+  bool IsDedicatedQueue() const { return m_untransfer_family != m_ungraphics_family; }
+
+ private:
+  struct InFlight {
+    uint64_t un_value;
+    VkCommandBuffer vkcommand_buffer;
+    VkDeviceSize staging_end;  //ring space up to here is free once un_value is reached
+  };
+
+  struct PendingAcquire {
+    VkBuffer vkbuffer;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkPipelineStageFlags dst_stages;
+    VkAccessFlags dst_access;
+    uint64_t un_value;
+  };
+
+  bool IsOwnershipTransferNeeded() const { return m_untransfer_family != m_ungraphics_family; }
+
+  //hands completed submissions' command buffers back and advances the ring tail past their staging space
+  void RetireCompleted(uint64_t un_completed_value) {
+    while (!mdq_in_flight.empty() && mdq_in_flight.front().un_value <= un_completed_value) {
+      mv_free_command_buffers.push_back(mdq_in_flight.front().vkcommand_buffer);
+      m_staging_tail = mdq_in_flight.front().staging_end;
+      mdq_in_flight.pop_front();
+    }
+
+    if (mdq_in_flight.empty()) {
+      m_staging_head = 0;
+      m_staging_tail = 0;
+    }
+  }
+
+  bool AcquireCommandBuffer(VkCommandBuffer& out_command_buffer) {
+    if (mv_free_command_buffers.empty()) {
+      RetireCompleted(GetCompletedValue());
+    }
+
+    if (!mv_free_command_buffers.empty()) {
+      out_command_buffer = mv_free_command_buffers.back();
+      mv_free_command_buffers.pop_back();
+      b_qualify_vk(vkResetCommandBuffer(out_command_buffer, 0));
+      return true;
+    }
+
+    VkCommandBufferAllocateInfo cmd_buffer_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = m_vkcommand_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    b_qualify_vk(vkAllocateCommandBuffers(m_vkdevice, &cmd_buffer_allocate_info, &out_command_buffer));
+    return true;
+  }
+
+  //ring allocation of [out_offset, out_offset + size), waiting on the oldest submission only when the ring is full
+  bool ReserveStaging(VkDeviceSize size, VkDeviceSize& out_offset) {
+    //keep copy sources 16-byte aligned, which also satisfies any texel block size an image upload might need later
+    const VkDeviceSize alignment = 16;
+
+    while (true) {
+      RetireCompleted(GetCompletedValue());
+
+      VkDeviceSize head = (m_staging_head + alignment - 1) / alignment * alignment;
+      bool b_wrapped = m_staging_head < m_staging_tail;
+
+      if (!b_wrapped && head + size <= m_staging_size) {
+        out_offset = head;
+        m_staging_head = head + size;
+        return true;
+      }
+      if (!b_wrapped && size < m_staging_tail) {
+        out_offset = 0;
+        m_staging_head = size;
+        return true;
+      }
+      if (b_wrapped && head + size < m_staging_tail) {
+        out_offset = head;
+        m_staging_head = head + size;
+        return true;
+      }
+
+      if (mdq_in_flight.empty()) {
+        std::cout << "[TransferUploader] Upload chunk of " << size << " bytes does not fit the staging ring"
+                  << std::endl;
+        return false;
+      }
+      if (!Wait(mdq_in_flight.front().un_value)) {
+        return false;
+      }
+    }
+  }
+
+  VkDevice m_vkdevice = VK_NULL_HANDLE;
+  DeviceMemoryArena* mp_memory_arena = nullptr;
+
+  VkQueue m_vktransfer_queue = VK_NULL_HANDLE;
+  uint32_t m_untransfer_family = 0;
+  uint32_t m_ungraphics_family = 0;
+
+  VkBuffer m_vkstaging_buffer = VK_NULL_HANDLE;
+  MemoryAllocation m_staging_allocation{};
+  VkDeviceSize m_staging_size = 0;
+  VkDeviceSize m_staging_head = 0;  //next write position
+  VkDeviceSize m_staging_tail = 0;  //start of the oldest region the GPU may still be reading
+
+  VkCommandPool m_vkcommand_pool = VK_NULL_HANDLE;
+  std::vector<VkCommandBuffer> mv_free_command_buffers;
+
+  VkSemaphore m_vktimeline = VK_NULL_HANDLE;
+  uint64_t m_unnext_value = 1;
+  uint64_t m_unacquired_value = 0;
+
+  std::deque<InFlight> mdq_in_flight;
+  std::vector<PendingAcquire> mv_pending_acquires;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <iostream>
+
+#include "vulkan/vulkan.h"
+
+//core device-level commands used by the renderer, all required
+#define VK_DEVICE_FUNCTIONS(X)          \
+  X(vkDestroyDevice)                    \
+  X(vkGetDeviceQueue)                   \
+  X(vkDeviceWaitIdle)                   \
+  X(vkQueueSubmit)                      \
+  X(vkAllocateMemory)                   \
+  X(vkFreeMemory)                       \
+  X(vkMapMemory)                        \
+  X(vkFlushMappedMemoryRanges)          \
+  X(vkInvalidateMappedMemoryRanges)     \
+  X(vkBindBufferMemory)                 \
+  X(vkBindImageMemory)                  \
+  X(vkGetBufferMemoryRequirements)      \
+  X(vkGetImageMemoryRequirements)       \
+  X(vkCreateBuffer)                     \
+  X(vkDestroyBuffer)                    \
+  X(vkCreateImage)                      \
+  X(vkDestroyImage)                     \
+  X(vkCreateImageView)                  \
+  X(vkDestroyImageView)                 \
+  X(vkCreateShaderModule)               \
+  X(vkDestroyShaderModule)              \
+  X(vkCreatePipelineCache)              \
+  X(vkDestroyPipelineCache)             \
+  X(vkGetPipelineCacheData)             \
+  X(vkCreateGraphicsPipelines)          \
+  X(vkCreateComputePipelines)           \
+  X(vkDestroyPipeline)                  \
+  X(vkCreatePipelineLayout)             \
+  X(vkDestroyPipelineLayout)            \
+  X(vkCreateDescriptorSetLayout)        \
+  X(vkDestroyDescriptorSetLayout)       \
+  X(vkCreateDescriptorPool)             \
+  X(vkDestroyDescriptorPool)            \
+  X(vkAllocateDescriptorSets)           \
+  X(vkUpdateDescriptorSets)             \
+  X(vkCreateFramebuffer)                \
+  X(vkDestroyFramebuffer)               \
+  X(vkCreateRenderPass)                 \
+  X(vkDestroyRenderPass)                \
+  X(vkCreateCommandPool)                \
+  X(vkDestroyCommandPool)               \
+  X(vkResetCommandPool)                 \
+  X(vkAllocateCommandBuffers)           \
+  X(vkFreeCommandBuffers)               \
+  X(vkBeginCommandBuffer)               \
+  X(vkEndCommandBuffer)                 \
+  X(vkResetCommandBuffer)               \
+  X(vkCreateFence)                      \
+  X(vkDestroyFence)                     \
+  X(vkResetFences)                      \
+  X(vkWaitForFences)                    \
+  X(vkCreateSemaphore)                  \
+  X(vkDestroySemaphore)                 \
+  X(vkGetSemaphoreCounterValue)         \
+  X(vkWaitSemaphores)                   \
+  X(vkCreateQueryPool)                  \
+  X(vkDestroyQueryPool)                 \
+  X(vkGetQueryPoolResults)              \
+  X(vkCmdBindPipeline)                  \
+  X(vkCmdBindDescriptorSets)            \
+  X(vkCmdSetViewport)                   \
+  X(vkCmdSetScissor)                    \
+  X(vkCmdBindIndexBuffer)               \
+  X(vkCmdBindVertexBuffers)             \
+  X(vkCmdPushConstants)                 \
+  X(vkCmdDraw)                          \
+  X(vkCmdDrawIndexed)                   \
+  X(vkCmdDrawIndexedIndirectCount)      \
+  X(vkCmdDispatch)                      \
+  X(vkCmdFillBuffer)                    \
+  X(vkCmdCopyBuffer)                    \
+  X(vkCmdCopyImageToBuffer)             \
+  X(vkCmdPipelineBarrier)               \
+  X(vkCmdResetQueryPool)                \
+  X(vkCmdWriteTimestamp)                \
+  X(vkCmdBeginRenderPass)               \
+  X(vkCmdEndRenderPass)                 \
+  X(vkCmdExecuteCommands)
+
+//device-level commands of extensions, null when the extension was not enabled
+#define VK_DEVICE_EXTENSION_FUNCTIONS(X) \
+  X(vkCreateSwapchainKHR)                \
+  X(vkDestroySwapchainKHR)               \
+  X(vkGetSwapchainImagesKHR)             \
+  X(vkAcquireNextImageKHR)               \
+  X(vkQueuePresentKHR)                   \
+  X(vkWaitForPresentKHR)                 \
+  X(vkGetCalibratedTimestampsEXT)        \
+  X(vkCmdPipelineBarrier2)               \
+  X(vkQueueSubmit2)                      \
+  X(vkCmdBeginRendering)                 \
+  X(vkCmdEndRendering)
+
+//Vulkan 1.3 commands that were extensions before, tried under the extension name when the core one is missing
+#define VK_DEVICE_PROMOTED_FUNCTIONS(X)              \
+  X(vkCmdPipelineBarrier2, vkCmdPipelineBarrier2KHR) \
+  X(vkQueueSubmit2, vkQueueSubmit2KHR)               \
+  X(vkCmdBeginRendering, vkCmdBeginRenderingKHR)     \
+  X(vkCmdEndRendering, vkCmdEndRenderingKHR)
+
+//device-level commands fetched with vkGetDeviceProcAddr. the loader's exported vk* symbols are trampolines that look
+//up the dispatch table of the handle on every call, these point straight at the driver (or the first layer).
+//classes that call Vulkan inherit this table, so an unqualified vkCmdDraw in a member function resolves to the
+//member and goes through the table with no change at the call site
+struct VkDeviceDispatch {
+#define X(name) PFN_##name name = nullptr;
+  VK_DEVICE_FUNCTIONS(X)
+  VK_DEVICE_EXTENSION_FUNCTIONS(X)
+#undef X
+
+  //call right after vkCreateDevice
+  bool LoadDeviceDispatch(VkDevice vkdevice) {
+    bool b_complete = true;
+#define X(name)                                                       \
+  name = (PFN_##name)vkGetDeviceProcAddr(vkdevice, #name);            \
+  if (name == nullptr) {                                              \
+    std::cerr << "[VkDeviceDispatch] Missing " << #name << std::endl; \
+    b_complete = false;                                               \
+  }
+    VK_DEVICE_FUNCTIONS(X)
+#undef X
+
+#define X(name) name = (PFN_##name)vkGetDeviceProcAddr(vkdevice, #name);
+    VK_DEVICE_EXTENSION_FUNCTIONS(X)
+#undef X
+
+#define X(name, extension_name)                                        \
+  if (name == nullptr) {                                               \
+    name = (PFN_##name)vkGetDeviceProcAddr(vkdevice, #extension_name); \
+  }
+    VK_DEVICE_PROMOTED_FUNCTIONS(X)
+#undef X
+
+    return b_complete;
+  }
+
+  //points every entry at the loader's exported trampolines instead, only used to measure the difference
+  void LoadLoaderDispatch() {
+#define X(name) name = ::name;
+    VK_DEVICE_FUNCTIONS(X)
+#undef X
+  }
+
+  //subsystems share the table the device was loaded into
+  void SetDeviceDispatch(const VkDeviceDispatch& dispatch) { static_cast<VkDeviceDispatch&>(*this) = dispatch; }
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iostream>
+
+#include "vulkan/vulkan.h"
+
+#define b_qualify_vk(x)                                                          \
+  do {                                                                           \
+    VkResult ret = x;                                                            \
+    if (ret != VK_SUCCESS) {                                                     \
+      std::cout << "[QualifyVK] " << #x << " failed with: " << ret << std::endl; \
+      return false;                                                              \
+    }                                                                            \
+  } while (0)
+
+#define v_qualify_vk(x)                                                          \
+  do {                                                                           \
+    VkResult ret = x;                                                            \
+    if (ret != VK_SUCCESS) {                                                     \
+      std::cout << "[QualifyVK] " << #x << " failed with: " << ret << std::endl; \
+      return;                                                                    \
+    }                                                                            \
+  } while (0)
+
+#define d_qualify_vk(x)                                                          \
+  do {                                                                           \
+    VkResult ret = x;                                                            \
+    if (ret != VK_SUCCESS) {                                                     \
+      std::cout << "[QualifyVK] " << #x << " failed with: " << ret << std::endl; \
+      return {};                                                                 \
+    }                                                                            \
+  } while (0)
+
+#define vk_get_proc(instance, name)                            \
+  do {                                                         \
+    name = (PFN_##name)vkGetInstanceProcAddr(instance, #name); \
+  } while (0)